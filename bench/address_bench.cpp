@@ -0,0 +1,67 @@
+#include "bench.h"
+
+#include "../include/sws/Address.h"
+#include "../include/sws/Handshake.h"
+
+#include <functional>
+
+namespace bench
+{
+	using sws::Address;
+	using sws::AddressFamily;
+
+	namespace
+	{
+		void family_benchmarks(Runner& runner, const char* family, const Address& address)
+		{
+			const std::string prefix = std::string("address/") + family;
+			const sockaddr_storage native = address.to_native();
+
+			runner.run(prefix + "/to_native", 0, [&]
+			{
+				keep(address.to_native());
+			});
+
+			runner.run(prefix + "/from_native", 0, [&]
+			{
+				keep(Address::from_native(reinterpret_cast<const sockaddr*>(&native)));
+			});
+
+			runner.run(prefix + "/to_string", 0, [&]
+			{
+				keep(address.to_string());
+			});
+
+			runner.run(prefix + "/hash", 0, [&]
+			{
+				keep(std::hash<Address>()(address));
+			});
+
+			runner.run(prefix + "/compare", 0, [&]
+			{
+				keep(address == address);
+			});
+
+			const sws::CookieHandshake handshake;
+			const auto now    = sws::CookieHandshake::clock::now();
+			const auto cookie = handshake.cookie(address, now);
+
+			runner.run(prefix + "/cookie_verify", 0, [&]
+			{
+				keep(handshake.verify(address, cookie, now));
+			});
+
+			// What every spoofed hello costs, clock included.
+			runner.run(prefix + "/cookie_reject", 0, [&]
+			{
+				keep(handshake.verify(address, cookie ^ 2));
+			});
+		}
+	}
+
+	void address_benchmarks(Runner& runner)
+	{
+		family_benchmarks(runner, "inet", Address("192.168.100.200", 27015, AddressFamily::inet));
+		family_benchmarks(runner, "inet6", Address("2001:db8::ff00:42:8329", 27015, AddressFamily::inet6));
+	}
+}
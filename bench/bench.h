@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../include/sws/Histogram.h"
+
+namespace bench
+{
+	using clock = std::chrono::steady_clock;
+
+	/**
+	 * \brief Keeps the compiler from optimizing away the computation of \p value
+	 */
+	template <typename T>
+	void keep(const T& value)
+	{
+		static volatile const void* sink;
+		sink = &value;
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+	}
+
+	struct Result
+	{
+		std::string name;
+
+		uint64_t iterations = 0;
+		double   seconds    = 0.0;
+
+		// Bytes moved per iteration, if the benchmark measures throughput.
+		uint64_t bytes_per_iteration = 0;
+
+		// Per-iteration latencies in nanoseconds, if the benchmark samples them.
+		sws::Histogram latency;
+	};
+
+	class Runner
+	{
+		std::vector<std::string> filters_;
+		std::chrono::nanoseconds min_time_;
+		std::vector<Result>      results_;
+
+	public:
+		Runner(std::vector<std::string> filters, std::chrono::nanoseconds min_time);
+
+		/**
+		 * \brief Checks if a benchmark was selected on the command line.
+		 */
+		[[nodiscard]] bool selected(std::string_view name) const;
+
+		/**
+		 * \brief Gets the minimum time each benchmark runs for.
+		 */
+		[[nodiscard]] std::chrono::nanoseconds min_time() const;
+
+		/**
+		 * \brief Runs \p operation in growing batches until the minimum time has passed.
+		 * \param name Name of the benchmark.
+		 * \param bytes_per_iteration Bytes processed by each call, or \c 0
+		 * \param operation Operation to time.
+		 */
+		template <typename F>
+		void run(std::string_view name, uint64_t bytes_per_iteration, F&& operation);
+
+		/**
+		 * \brief Times every call of \p operation individually until the minimum time has passed.
+		 * Use for operations which take microseconds or more, such as round trips.
+		 */
+		template <typename F>
+		void run_latency(std::string_view name, uint64_t bytes_per_iteration, F&& operation);
+
+		/**
+		 * \brief Records a result measured by the benchmark itself, e.g. across threads.
+		 */
+		void add(Result result);
+
+		[[nodiscard]] const std::vector<Result>& results() const;
+	};
+
+	template <typename F>
+	void Runner::run(std::string_view name, uint64_t bytes_per_iteration, F&& operation)
+	{
+		if (!selected(name))
+		{
+			return;
+		}
+
+		// Warm up caches and branch predictors.
+		for (int i = 0; i < 16; ++i)
+		{
+			operation();
+		}
+
+		Result result;
+		result.name = name;
+		result.bytes_per_iteration = bytes_per_iteration;
+
+		uint64_t batch = 1;
+		clock::duration elapsed {};
+
+		while (elapsed < min_time_)
+		{
+			const auto start = clock::now();
+
+			for (uint64_t i = 0; i < batch; ++i)
+			{
+				operation();
+			}
+
+			elapsed += clock::now() - start;
+			result.iterations += batch;
+			batch *= 2;
+		}
+
+		result.seconds = std::chrono::duration<double>(elapsed).count();
+		add(std::move(result));
+	}
+
+	template <typename F>
+	void Runner::run_latency(std::string_view name, uint64_t bytes_per_iteration, F&& operation)
+	{
+		if (!selected(name))
+		{
+			return;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			operation();
+		}
+
+		Result result;
+		result.name = name;
+		result.bytes_per_iteration = bytes_per_iteration;
+
+		clock::duration elapsed {};
+
+		while (elapsed < min_time_)
+		{
+			const auto start = clock::now();
+			operation();
+			const auto time = clock::now() - start;
+
+			elapsed += time;
+			++result.iterations;
+			result.latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count()));
+		}
+
+		result.seconds = std::chrono::duration<double>(elapsed).count();
+		add(std::move(result));
+	}
+
+	void packet_benchmarks(Runner& runner);
+	void address_benchmarks(Runner& runner);
+	void socket_benchmarks(Runner& runner);
+	void library_benchmarks(Runner& runner);
+}
@@ -0,0 +1,255 @@
+#include "bench.h"
+
+#include "../include/sws/Capture.h"
+#include "../include/sws/ConcurrentQueue.h"
+#include "../include/sws/Histogram.h"
+#include "../include/sws/IngressLimiter.h"
+#include "../include/sws/PcapWriter.h"
+#include "../include/sws/Socket.h"
+#include "../include/sws/Statistics.h"
+#include "../include/sws/TimerWheel.h"
+
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+
+namespace bench
+{
+	using namespace sws;
+
+	namespace
+	{
+		// Runs a fixed number of iterations, for operations which consume a bounded resource.
+		template <typename F>
+		void run_fixed(Runner& runner, std::string_view name, uint64_t iterations, uint64_t bytes_per_iteration, F&& operation)
+		{
+			if (!runner.selected(name))
+			{
+				return;
+			}
+
+			Result result;
+			result.name = name;
+			result.bytes_per_iteration = bytes_per_iteration;
+			result.iterations = iterations;
+
+			const auto start = clock::now();
+
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				operation();
+			}
+
+			result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+			runner.add(std::move(result));
+		}
+
+		void queue_benchmarks(Runner& runner)
+		{
+			SpscQueue<uint64_t> spsc(1024);
+			MpscQueue<uint64_t> mpsc(1024);
+
+			runner.run("queue/spsc/push_pop", 0, [&]
+			{
+				uint64_t value = 1;
+				spsc.try_push(std::move(value));
+				spsc.try_pop(value);
+				keep(value);
+			});
+
+			runner.run("queue/mpsc/push_pop", 0, [&]
+			{
+				uint64_t value = 1;
+				mpsc.try_push(std::move(value));
+				mpsc.try_pop(value);
+				keep(value);
+			});
+
+			if (!runner.selected("queue/spsc/threads"))
+			{
+				return;
+			}
+
+			constexpr uint64_t count = 10'000'000;
+			SpscQueue<uint64_t> queue(4096);
+
+			const auto start = clock::now();
+
+			std::thread producer([&]
+			{
+				for (uint64_t i = 0; i < count; ++i)
+				{
+					uint64_t value = i;
+
+					while (!queue.try_push(std::move(value)))
+					{
+						std::this_thread::yield();
+					}
+				}
+			});
+
+			uint64_t value = 0;
+
+			for (uint64_t i = 0; i < count; )
+			{
+				if (queue.try_pop(value))
+				{
+					++i;
+				}
+			}
+
+			producer.join();
+
+			Result result;
+			result.name       = "queue/spsc/threads";
+			result.iterations = count;
+			result.seconds    = std::chrono::duration<double>(clock::now() - start).count();
+			runner.add(std::move(result));
+		}
+
+		void instrumentation_benchmarks(Runner& runner)
+		{
+			SocketStatistics statistics;
+
+			runner.run("statistics/add", 0, [&]
+			{
+				statistics.add(Counter::bytes_sent, 64);
+			});
+
+			runner.run("statistics/global_snapshot", 0, [&]
+			{
+				keep(global_statistics());
+			});
+
+			runner.run("latency/record", 0, [&]
+			{
+				LatencyRecorder::record(LatencyMetric::round_trip, 12345);
+			});
+
+			runner.run("latency/timer", 0, [&]
+			{
+				const LatencyTimer timer(LatencyMetric::round_trip);
+			});
+
+			Histogram histogram;
+
+			runner.run("histogram/record", 0, [&]
+			{
+				histogram.record(12345);
+			});
+
+			TimerWheel wheel;
+
+			runner.run("timer_wheel/schedule_cancel", 0, [&]
+			{
+				const TimerId id = wheel.schedule(std::chrono::milliseconds(50), [] {});
+				wheel.cancel(id);
+			});
+
+			// A timer which reschedules and then cancels itself from its callback must be released once,
+			// or the next two timers scheduled share a node.
+			TimerWheel::clock::time_point now = TimerWheel::clock::now();
+			TimerWheel manual(std::chrono::milliseconds(1), now);
+
+			runner.run("timer_wheel/reschedule_cancel_in_callback", 0, [&]
+			{
+				TimerId self;
+
+				self = manual.schedule_at(now + std::chrono::milliseconds(1), [&]
+				{
+					manual.reschedule_at(self, now + std::chrono::milliseconds(2));
+					manual.cancel(self);
+				});
+
+				now += std::chrono::milliseconds(1);
+				manual.advance(now);
+
+				const TimerId first  = manual.schedule_at(now + std::chrono::milliseconds(1), [] {});
+				const TimerId second = manual.schedule_at(now + std::chrono::milliseconds(1), [] {});
+
+				manual.cancel(first);
+
+				if (!manual.cancel(second) || !manual.empty())
+				{
+					throw std::runtime_error("bench: timer released twice");
+				}
+			});
+		}
+
+		void ingress_benchmarks(Runner& runner)
+		{
+			const Address address("192.168.100.200", 27015, AddressFamily::inet);
+
+			// Limits high enough that every packet is admitted, then low enough that every packet is dropped.
+			IngressLimiter generous(IngressLimits { 1e9, 0, 1e12, 0 }, IngressLimits { 1e9, 0, 1e12, 0 });
+			IngressLimiter strict(IngressLimits { 1, 1, 0, 0 }, IngressLimits { 1, 1, 0, 0 });
+
+			IngressState state {};
+
+			runner.run("ingress/admit_state", 0, [&]
+			{
+				keep(generous.admit(state, 64));
+			});
+
+			runner.run("ingress/admit_address", 0, [&]
+			{
+				keep(generous.admit(address, 64));
+			});
+
+			runner.run("ingress/drop_address", 0, [&]
+			{
+				keep(strict.admit(address, 64));
+			});
+		}
+
+		void capture_benchmarks(Runner& runner)
+		{
+			const std::vector<uint8_t> data(64, 0xCC);
+			const Address local("127.0.0.1", 27015, AddressFamily::inet);
+			const Address remote("127.0.0.1", 50000, AddressFamily::inet);
+
+			const auto directory = std::filesystem::temp_directory_path();
+
+			if (runner.selected("capture/log/append"))
+			{
+				const auto path = directory / "sws-bench.cap";
+
+				{
+					CaptureLog log(path);
+
+					run_fixed(runner, "capture/log/append", 1'000'000, data.size(), [&]
+					{
+						log.append(CaptureDirection::sent, remote, data);
+					});
+				}
+
+				std::filesystem::remove(path);
+			}
+
+			if (runner.selected("capture/pcap/capture"))
+			{
+				const auto path = directory / "sws-bench.pcapng";
+
+				{
+					// Room for every packet, so none are dropped while the writer catches up.
+					PcapWriter pcap(path, 0, size_t(256) << 20);
+
+					run_fixed(runner, "capture/pcap/capture", 1'000'000, data.size(), [&]
+					{
+						pcap.capture(Protocol::tcp, CaptureDirection::sent, local, remote, data);
+					});
+				}
+
+				std::filesystem::remove(path);
+			}
+		}
+	}
+
+	void library_benchmarks(Runner& runner)
+	{
+		queue_benchmarks(runner);
+		instrumentation_benchmarks(runner);
+		ingress_benchmarks(runner);
+		capture_benchmarks(runner);
+	}
+}
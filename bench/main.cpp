@@ -0,0 +1,195 @@
+#include "bench.h"
+
+#include "../include/sws/Socket.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace bench
+{
+	Runner::Runner(std::vector<std::string> filters, std::chrono::nanoseconds min_time)
+		: filters_(std::move(filters)),
+		  min_time_(min_time)
+	{
+	}
+
+	bool Runner::selected(std::string_view name) const
+	{
+		if (filters_.empty())
+		{
+			return true;
+		}
+
+		for (const auto& filter : filters_)
+		{
+			if (name.find(filter) != std::string_view::npos)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	std::chrono::nanoseconds Runner::min_time() const
+	{
+		return min_time_;
+	}
+
+	void Runner::add(Result result)
+	{
+		const double ns_per_op = result.iterations ? result.seconds * 1e9 / static_cast<double>(result.iterations) : 0.0;
+
+		std::fprintf(stderr, "%-48s %12llu iterations %12.1f ns/op", result.name.c_str(),
+		             static_cast<unsigned long long>(result.iterations), ns_per_op);
+
+		if (result.bytes_per_iteration && result.seconds > 0.0)
+		{
+			const double bytes = static_cast<double>(result.bytes_per_iteration * result.iterations);
+			std::fprintf(stderr, " %10.1f MiB/s", bytes / result.seconds / (1024.0 * 1024.0));
+		}
+
+		if (!result.latency.empty())
+		{
+			std::fprintf(stderr, " p50 %llu ns p99 %llu ns",
+			             static_cast<unsigned long long>(result.latency.percentile(50.0)),
+			             static_cast<unsigned long long>(result.latency.percentile(99.0)));
+		}
+
+		std::fprintf(stderr, "\n");
+
+		results_.push_back(std::move(result));
+	}
+
+	const std::vector<Result>& Runner::results() const
+	{
+		return results_;
+	}
+
+	namespace
+	{
+		std::string to_json(const std::vector<Result>& results)
+		{
+			std::ostringstream stream;
+			stream.precision(17);
+
+#ifdef _DEBUG
+			stream << "{\n  \"build\": \"debug\",\n  \"results\": [";
+#else
+			stream << "{\n  \"build\": \"release\",\n  \"results\": [";
+#endif
+
+			for (size_t i = 0; i < results.size(); ++i)
+			{
+				const Result& result = results[i];
+				const double iterations = static_cast<double>(result.iterations);
+
+				// Names are plain identifiers, so they need no escaping.
+				stream << (i ? ",\n" : "\n")
+				       << "    {\"name\": \"" << result.name << "\""
+				       << ", \"iterations\": " << result.iterations
+				       << ", \"seconds\": " << result.seconds
+				       << ", \"ns_per_op\": " << (iterations ? result.seconds * 1e9 / iterations : 0.0)
+				       << ", \"ops_per_second\": " << (result.seconds > 0.0 ? iterations / result.seconds : 0.0);
+
+				if (result.bytes_per_iteration)
+				{
+					stream << ", \"bytes_per_second\": "
+					       << (result.seconds > 0.0 ? static_cast<double>(result.bytes_per_iteration) * iterations / result.seconds : 0.0);
+				}
+
+				if (!result.latency.empty())
+				{
+					stream << ", \"latency_ns\": {"
+					       << "\"min\": " << result.latency.min()
+					       << ", \"mean\": " << result.latency.mean()
+					       << ", \"p50\": " << result.latency.percentile(50.0)
+					       << ", \"p90\": " << result.latency.percentile(90.0)
+					       << ", \"p99\": " << result.latency.percentile(99.0)
+					       << ", \"p999\": " << result.latency.percentile(99.9)
+					       << ", \"max\": " << result.latency.max() << "}";
+				}
+
+				stream << "}";
+			}
+
+			stream << "\n  ]\n}\n";
+			return stream.str();
+		}
+
+		void usage()
+		{
+			std::fprintf(stderr,
+			             "usage: bench [--json <path|->] [--min-time <milliseconds>] [filter...]\n"
+			             "  Runs every benchmark whose name contains one of the filters (all if none).\n"
+			             "  Results are printed to stderr; --json also writes them as JSON, '-' meaning stdout.\n");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> filters;
+	std::string json_path;
+	long min_time_ms = 250;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view argument = argv[i];
+
+		if (argument == "--json" && i + 1 < argc)
+		{
+			json_path = argv[++i];
+		}
+		else if (argument == "--min-time" && i + 1 < argc)
+		{
+			min_time_ms = std::strtol(argv[++i], nullptr, 10);
+		}
+		else if (argument == "--help" || argument == "-h")
+		{
+			bench::usage();
+			return 0;
+		}
+		else
+		{
+			filters.emplace_back(argument);
+		}
+	}
+
+	sws::Socket::initialize();
+
+	bench::Runner runner(std::move(filters), std::chrono::milliseconds(min_time_ms));
+
+	bench::packet_benchmarks(runner);
+	bench::address_benchmarks(runner);
+	bench::library_benchmarks(runner);
+	bench::socket_benchmarks(runner);
+
+	sws::Socket::cleanup();
+
+	if (json_path.empty())
+	{
+		return 0;
+	}
+
+	const std::string json = bench::to_json(runner.results());
+
+	if (json_path == "-")
+	{
+		std::cout << json;
+		return 0;
+	}
+
+	std::ofstream file(json_path, std::ios::binary | std::ios::trunc);
+
+	if (!file || !(file << json))
+	{
+		std::fprintf(stderr, "failed to write %s\n", json_path.c_str());
+		return 1;
+	}
+
+	return 0;
+}
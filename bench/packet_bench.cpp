@@ -0,0 +1,366 @@
+#include "bench.h"
+
+#include "../include/sws/Compressor.h"
+#include "../include/sws/Crc32c.h"
+#include "../include/sws/Delta.h"
+#include "../include/sws/Dispatcher.h"
+#include "../include/sws/Packet.h"
+
+#include <cstdio>
+#include <random>
+
+namespace bench
+{
+	using sws::Packet;
+	using sws::packetlen_t;
+	using sws::SeekCursor;
+	using sws::SeekType;
+
+	namespace
+	{
+		constexpr int values_per_iteration = 64;
+
+		template <typename T>
+		void type_benchmarks(Runner& runner, const char* type)
+		{
+			const auto value = static_cast<T>(42);
+			const uint64_t bytes = sizeof(T) * values_per_iteration;
+
+			Packet packet;
+
+			runner.run(std::string("packet/write/") + type, bytes, [&]
+			{
+				packet.clear();
+
+				for (int i = 0; i < values_per_iteration; ++i)
+				{
+					packet << value;
+				}
+
+				keep(packet);
+			});
+
+			packet.clear();
+
+			for (int i = 0; i < values_per_iteration; ++i)
+			{
+				packet << value;
+			}
+
+			runner.run(std::string("packet/read/") + type, bytes, [&]
+			{
+				packet.seek(SeekCursor::read, SeekType::from_start, 0);
+
+				T result {};
+
+				for (int i = 0; i < values_per_iteration; ++i)
+				{
+					packet >> result;
+				}
+
+				keep(result);
+			});
+		}
+
+		struct Move
+		{
+			static constexpr uint8_t opcode = 0;
+
+			float x = 0.0f;
+			float y = 0.0f;
+
+			bool read(Packet& packet)
+			{
+				return packet.read(x) && packet.read(y);
+			}
+		};
+
+		struct Chat
+		{
+			static constexpr uint8_t opcode = 1;
+		};
+
+		struct Ping
+		{
+			static constexpr uint8_t opcode = 2;
+
+			uint64_t time = 0;
+
+			bool read(Packet& packet)
+			{
+				return packet.read(time);
+			}
+		};
+
+		struct DispatchHandler
+		{
+			uint64_t sum = 0;
+
+			void operator()(const Move& move)
+			{
+				sum += static_cast<uint64_t>(move.x + move.y);
+			}
+
+			void operator()(Chat, Packet& packet)
+			{
+				sum += packet.work_size();
+			}
+
+			void operator()(const Ping& ping)
+			{
+				sum += ping.time;
+			}
+		};
+
+		void dispatch_benchmarks(Runner& runner)
+		{
+			std::vector<uint8_t> stream;
+
+			for (int i = 0; i < values_per_iteration; ++i)
+			{
+				Packet packet;
+
+				switch (i % 3)
+				{
+					case 0:
+						packet << Move::opcode << 1.0f << 2.0f;
+						break;
+
+					case 1:
+						packet << Chat::opcode << std::string("hello");
+						break;
+
+					default:
+						packet << Ping::opcode << static_cast<uint64_t>(i);
+						break;
+				}
+
+				const packetlen_t size = static_cast<packetlen_t>(packet.work_size());
+				const auto* header = reinterpret_cast<const uint8_t*>(&size);
+
+				stream.insert(stream.end(), header, header + sizeof(size));
+				stream.insert(stream.end(), packet.data().begin() + sizeof(size), packet.data().end());
+			}
+
+			sws::Dispatcher<uint8_t, DispatchHandler, Move, Chat, Ping> dispatcher;
+
+			runner.run("packet/dispatch/stream", stream.size(), [&]
+			{
+				size_t consumed = 0;
+				keep(dispatcher.dispatch_all(stream, consumed));
+			});
+
+			dispatcher.timing(true);
+
+			runner.run("packet/dispatch/stream_timed", stream.size(), [&]
+			{
+				size_t consumed = 0;
+				keep(dispatcher.dispatch_all(stream, consumed));
+			});
+
+			keep(dispatcher.handler().sum);
+		}
+
+		// A small, repetitive message typical of game and telemetry traffic.
+		Packet sample_message(std::mt19937& random)
+		{
+			const std::string text = "{\"type\":\"player_update\",\"id\":" + std::to_string(random() % 10000) +
+			                         ",\"x\":" + std::to_string(random() % 4096) + ",\"y\":" + std::to_string(random() % 4096) +
+			                         ",\"state\":\"running\",\"team\":\"blue\",\"health\":" + std::to_string(random() % 100) + "}";
+
+			Packet packet;
+			packet.write_data(text.data(), text.size(), true);
+			return packet;
+		}
+
+		void compression_benchmarks(Runner& runner, const std::string& name, const Packet& payload, sws::Compressor& compressor)
+		{
+			Packet compressed;
+			Packet decompressed;
+
+			runner.run("packet/compress/" + name, payload.work_size(), [&]
+			{
+				keep(compressor.compress(payload, compressed));
+			});
+
+			runner.run("packet/decompress/" + name, payload.work_size(), [&]
+			{
+				keep(compressor.decompress(compressed, decompressed));
+			});
+
+			if (runner.selected("packet/compress/" + name))
+			{
+				std::fprintf(stderr, "packet/compress/%s ratio %.3f\n", name.c_str(),
+				             static_cast<double>(compressed.work_size()) / static_cast<double>(payload.work_size()));
+			}
+		}
+
+		void compression_benchmarks(Runner& runner)
+		{
+			std::mt19937 random(42);
+
+			Packet stream;
+
+			while (stream.work_size() < 16 * 1024)
+			{
+				stream << sample_message(random);
+			}
+
+			std::vector<Packet> samples;
+
+			for (int i = 0; i < 1000; ++i)
+			{
+				samples.push_back(sample_message(random));
+			}
+
+			const Packet message = sample_message(random);
+
+			sws::Compressor plain;
+			sws::Compressor trained(sws::Compressor::train(samples));
+
+			compression_benchmarks(runner, "stream16k", stream, plain);
+			compression_benchmarks(runner, "message", message, plain);
+			compression_benchmarks(runner, "message_dictionary", message, trained);
+		}
+
+		void delta_benchmarks(Runner& runner)
+		{
+			constexpr size_t snapshot_size = 60 * 1024;
+
+			std::mt19937 random(42);
+			std::vector<uint8_t> state(snapshot_size);
+
+			for (auto& value : state)
+			{
+				value = static_cast<uint8_t>(random());
+			}
+
+			Packet baseline;
+			baseline.write_data(state.data(), state.size(), true);
+
+			// About 1% of the snapshot changes from one tick to the next.
+			for (size_t i = 0; i < snapshot_size / 100; ++i)
+			{
+				state[random() % state.size()] ^= 1;
+			}
+
+			Packet current;
+			current.write_data(state.data(), state.size(), true);
+
+			Packet delta;
+
+			runner.run("packet/delta/encode60k", snapshot_size, [&]
+			{
+				delta.clear();
+				keep(sws::delta_encode(baseline, current, delta));
+			});
+
+			Packet result;
+
+			runner.run("packet/delta/apply60k", snapshot_size, [&]
+			{
+				delta.seek(SeekCursor::read, SeekType::from_start, 0);
+				keep(sws::delta_apply(baseline, delta, result));
+			});
+		}
+
+		void checksum_benchmarks(Runner& runner)
+		{
+			std::mt19937 random(42);
+			std::vector<uint8_t> data(64 * 1024);
+
+			for (auto& value : data)
+			{
+				value = static_cast<uint8_t>(random());
+			}
+
+			// A small message, a datagram that fits a typical MTU, and the largest datagram.
+			for (const size_t size : { size_t { 64 }, size_t { 1400 }, data.size() })
+			{
+				const std::span<const uint8_t> input(data.data(), size);
+
+				runner.run("packet/crc32c/" + std::to_string(size), size, [&]
+				{
+					keep(sws::crc32c(input));
+				});
+			}
+
+			if (runner.selected("packet/crc32c/"))
+			{
+				std::fprintf(stderr, "packet/crc32c hardware acceleration: %s\n", sws::crc32c_accelerated() ? "yes" : "no");
+			}
+		}
+
+		void string_benchmarks(Runner& runner, size_t length)
+		{
+			const std::string value(length, 's');
+			const std::string suffix = std::to_string(length);
+
+			Packet packet;
+
+			runner.run("packet/write/string" + suffix, length, [&]
+			{
+				packet.clear();
+				packet << value;
+				keep(packet);
+			});
+
+			std::string result;
+
+			runner.run("packet/read/string" + suffix, length, [&]
+			{
+				packet.seek(SeekCursor::read, SeekType::from_start, 0);
+				packet >> result;
+				keep(result);
+			});
+		}
+	}
+
+	void packet_benchmarks(Runner& runner)
+	{
+		type_benchmarks<bool>(runner, "bool");
+		type_benchmarks<uint8_t>(runner, "uint8");
+		type_benchmarks<uint16_t>(runner, "uint16");
+		type_benchmarks<uint32_t>(runner, "uint32");
+		type_benchmarks<uint64_t>(runner, "uint64");
+		type_benchmarks<float>(runner, "float");
+		type_benchmarks<double>(runner, "double");
+
+		string_benchmarks(runner, 16);
+		string_benchmarks(runner, 1024);
+
+		Packet inner;
+
+		for (int i = 0; i < 64; ++i)
+		{
+			inner << static_cast<uint32_t>(i);
+		}
+
+		Packet outer;
+
+		runner.run("packet/write/packet", inner.work_size(), [&]
+		{
+			outer.clear();
+			outer << inner;
+			keep(outer);
+		});
+
+		runner.run("packet/copy", inner.data().size(), [&]
+		{
+			Packet copy(inner);
+			keep(copy);
+		});
+
+		runner.run("packet/construct", 0, [&]
+		{
+			Packet packet;
+			packet << static_cast<uint32_t>(1);
+			keep(packet);
+		});
+
+		dispatch_benchmarks(runner);
+		compression_benchmarks(runner);
+		delta_benchmarks(runner);
+		checksum_benchmarks(runner);
+	}
+}
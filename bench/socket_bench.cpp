@@ -0,0 +1,437 @@
+#include "bench.h"
+
+#include "../include/sws/Broadcast.h"
+#include "../include/sws/FileTransfer.h"
+#include "../include/sws/Packet.h"
+#include "../include/sws/SocketOptions.h"
+#include "../include/sws/TcpSocket.h"
+#include "../include/sws/UdpSocket.h"
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace bench
+{
+	using namespace sws;
+
+	namespace
+	{
+		const Address loopback("127.0.0.1", 0, AddressFamily::inet);
+
+		void check(SocketState state, const char* what)
+		{
+			if (state != SocketState::done)
+			{
+				throw std::runtime_error(std::string("bench: ") + what + " failed");
+			}
+		}
+
+		Packet make_packet(size_t size)
+		{
+			const std::vector<uint8_t> payload(size, 0xAB);
+
+			Packet packet(sizeof(packetlen_t) + size);
+			packet.write_data(payload, true);
+			return packet;
+		}
+
+		/**
+		 * \brief A connected pair of blocking TCP sockets on the loopback interface.
+		 */
+		struct TcpPair
+		{
+			TcpSocket client;
+			TcpSocket server;
+
+			explicit TcpPair(const SocketOptions& options = {})
+			{
+				TcpSocket listener;
+				check(listener.bind(loopback), "bind");
+				check(listener.listen(1), "listen");
+
+				check(client.connect(listener.local_address()), "connect");
+				check(listener.accept(server), "accept");
+
+				check(client.options(options), "options");
+				check(server.options(options), "options");
+			}
+		};
+
+		/**
+		 * \brief Reads and discards everything \p socket receives until the peer closes it.
+		 */
+		std::thread drain(Socket& socket)
+		{
+			return std::thread([&socket]
+			{
+				std::array<uint8_t, 64 * 1024> buffer {};
+
+				while (socket.receive(buffer) > 0)
+				{
+				}
+			});
+		}
+
+		/**
+		 * \brief Sends every packet \p socket receives straight back until the peer closes it.
+		 */
+		std::thread echo(Socket& socket)
+		{
+			return std::thread([&socket]
+			{
+				Packet packet;
+
+				while (socket.receive(packet) == SocketState::done)
+				{
+					if (socket.send(packet) != SocketState::done)
+					{
+						break;
+					}
+				}
+			});
+		}
+
+		void tcp_throughput(Runner& runner, const std::string& name, size_t size, const SocketOptions& options = {})
+		{
+			if (!runner.selected(name))
+			{
+				return;
+			}
+
+			TcpPair pair(options);
+			std::thread receiver = drain(pair.server);
+			Packet packet = make_packet(size);
+
+			runner.run(name, packet.data().size(), [&]
+			{
+				pair.client.send(packet);
+			});
+
+			pair.client.close();
+			receiver.join();
+		}
+
+		void tcp_round_trip(Runner& runner, const std::string& name, size_t size, const SocketOptions& options = {})
+		{
+			if (!runner.selected(name))
+			{
+				return;
+			}
+
+			TcpPair pair(options);
+			std::thread responder = echo(pair.server);
+			Packet request = make_packet(size);
+			Packet response;
+
+			runner.run_latency(name, request.data().size(), [&]
+			{
+				pair.client.send(request);
+				pair.client.receive(response);
+			});
+
+			pair.client.close();
+			responder.join();
+		}
+
+		void tcp_benchmarks(Runner& runner)
+		{
+			for (const size_t size : { 64, 1024, 16384 })
+			{
+				tcp_throughput(runner, "tcp/throughput/" + std::to_string(size), size);
+			}
+
+			tcp_round_trip(runner, "tcp/round_trip/64", 64);
+
+			// Options presets, measured where each is meant to matter.
+			tcp_round_trip(runner, "tcp/preset/low_latency/round_trip/64", 64, SocketOptions::low_latency());
+			tcp_round_trip(runner, "tcp/preset/high_throughput/round_trip/64", 64, SocketOptions::high_throughput());
+			tcp_throughput(runner, "tcp/preset/low_latency/throughput/16384", 16384, SocketOptions::low_latency());
+			tcp_throughput(runner, "tcp/preset/high_throughput/throughput/16384", 16384, SocketOptions::high_throughput());
+		}
+
+		void cork_benchmarks(Runner& runner)
+		{
+			constexpr int packets_per_iteration = 64;
+
+			for (const bool corked : { false, true })
+			{
+				const std::string name = corked ? "tcp/cork/auto_cork/64" : "tcp/cork/plain/64";
+
+				if (!runner.selected(name))
+				{
+					continue;
+				}
+
+				TcpPair pair;
+				std::thread receiver = drain(pair.server);
+				Packet packet = make_packet(64);
+
+				if (corked)
+				{
+					check(pair.client.auto_cork(16 * 1024), "auto_cork");
+				}
+
+				runner.run(name, packet.data().size() * packets_per_iteration, [&]
+				{
+					for (int i = 0; i < packets_per_iteration; ++i)
+					{
+						pair.client.send(packet);
+					}
+
+					pair.client.flush();
+				});
+
+				pair.client.close();
+				receiver.join();
+			}
+		}
+
+		void zero_copy_benchmarks(Runner& runner)
+		{
+			// Close to the largest payload a packet can hold.
+			constexpr size_t size = 60000;
+
+			for (const bool zero_copy : { false, true })
+			{
+				const std::string name = zero_copy ? "tcp/zero_copy/60000" : "tcp/copy/60000";
+
+				if (!runner.selected(name))
+				{
+					continue;
+				}
+
+				TcpPair pair;
+				std::thread receiver = drain(pair.server);
+				Packet packet = make_packet(size);
+
+				if (zero_copy)
+				{
+					check(pair.client.zero_copy(32 * 1024), "zero_copy");
+				}
+
+				runner.run(name, packet.data().size(), [&]
+				{
+					pair.client.send(packet);
+				});
+
+				pair.client.close();
+				receiver.join();
+			}
+		}
+
+		void broadcast_benchmarks(Runner& runner)
+		{
+			constexpr size_t audience = 64;
+			constexpr size_t size     = 256;
+
+			for (const bool shared : { false, true })
+			{
+				const std::string name = shared ? "tcp/broadcast/shared/64x256" : "tcp/broadcast/copy/64x256";
+
+				if (!runner.selected(name))
+				{
+					continue;
+				}
+
+				std::vector<std::unique_ptr<TcpPair>> pairs;
+				std::vector<std::thread> receivers;
+				std::vector<TcpSocket*> sockets;
+
+				for (size_t i = 0; i < audience; ++i)
+				{
+					pairs.push_back(std::make_unique<TcpPair>());
+					receivers.push_back(drain(pairs.back()->server));
+					sockets.push_back(&pairs.back()->client);
+				}
+
+				const Packet packet = make_packet(size);
+
+				runner.run(name, packet.data().size() * audience, [&]
+				{
+					if (shared)
+					{
+						broadcast(packet, sockets);
+						return;
+					}
+
+					// What broadcasting looks like without shared packets.
+					for (TcpSocket* socket : sockets)
+					{
+						Packet copy(packet);
+						socket->send(copy);
+					}
+				});
+
+				for (size_t i = 0; i < audience; ++i)
+				{
+					pairs[i]->client.close();
+					receivers[i].join();
+				}
+			}
+		}
+
+		void send_file_benchmarks(Runner& runner)
+		{
+			constexpr size_t size = 64 * 1024 * 1024;
+			const std::string name = "tcp/send_file/64MiB";
+
+			if (!runner.selected(name))
+			{
+				return;
+			}
+
+			const auto path = std::filesystem::temp_directory_path() / "sws-bench.bin";
+
+			{
+				const std::vector<char> chunk(1024 * 1024, 'f');
+				std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+				for (size_t i = 0; i < size; i += chunk.size())
+				{
+					file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+				}
+			}
+
+			{
+				TcpPair pair;
+				std::thread receiver = drain(pair.server);
+
+				runner.run(name, size, [&]
+				{
+					FileTransfer file(path);
+					pair.client.send_file(file);
+				});
+
+				pair.client.close();
+				receiver.join();
+			}
+
+			std::filesystem::remove(path);
+		}
+
+		/**
+		 * \brief A blocking UDP socket connected to one serviced by a background thread.
+		 */
+		struct UdpPair
+		{
+			UdpSocket client;
+			UdpSocket server;
+
+			std::thread       thread;
+			std::atomic<bool> stopping = false;
+			std::atomic<bool> stopped  = false;
+
+			UdpPair()
+			{
+				check(server.bind(loopback), "bind");
+				check(client.connect(server.local_address()), "connect");
+			}
+
+			template <typename F>
+			void start(F&& service)
+			{
+				thread = std::thread([this, service]
+				{
+					while (!stopping.load(std::memory_order_acquire))
+					{
+						service();
+					}
+
+					stopped.store(true, std::memory_order_release);
+				});
+			}
+
+			// Datagrams may be dropped, so the server is woken until it notices.
+			void stop()
+			{
+				stopping.store(true, std::memory_order_release);
+
+				Packet wake = make_packet(1);
+
+				while (!stopped.load(std::memory_order_acquire))
+				{
+					client.send(wake);
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+
+				thread.join();
+			}
+		};
+
+		void udp_benchmarks(Runner& runner)
+		{
+			for (const size_t size : { 64, 1024 })
+			{
+				const std::string name = "udp/throughput/" + std::to_string(size);
+
+				if (!runner.selected(name))
+				{
+					continue;
+				}
+
+				UdpPair pair;
+				std::array<uint8_t, 64 * 1024> buffer {};
+
+				pair.start([&]
+				{
+					pair.server.receive(buffer);
+				});
+
+				Packet packet = make_packet(size);
+
+				// Datagrams the receiver cannot keep up with are dropped, so this measures the sender.
+				runner.run(name, packet.data().size(), [&]
+				{
+					pair.client.send(packet);
+				});
+
+				pair.stop();
+			}
+
+			const std::string name = "udp/round_trip/64";
+
+			if (!runner.selected(name))
+			{
+				return;
+			}
+
+			UdpPair pair;
+			Packet request_echo;
+			Address address;
+
+			pair.start([&]
+			{
+				if (pair.server.receive_from(request_echo, address) == SocketState::done)
+				{
+					pair.server.send_to(request_echo, address);
+				}
+			});
+
+			Packet request = make_packet(64);
+			Packet response;
+
+			runner.run_latency(name, request.data().size(), [&]
+			{
+				pair.client.send(request);
+				pair.client.receive(response);
+			});
+
+			pair.stop();
+		}
+	}
+
+	void socket_benchmarks(Runner& runner)
+	{
+		tcp_benchmarks(runner);
+		cork_benchmarks(runner);
+		zero_copy_benchmarks(runner);
+		broadcast_benchmarks(runner);
+		send_file_benchmarks(runner);
+		udp_benchmarks(runner);
+	}
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#include "EventLoop.h"
+#include "Packet.h"
+#include "TcpSocket.h"
+
+namespace sws
+{
+	/**
+	 * \brief Return type of a detached coroutine driven by a \c sws::EventLoop
+	 * Starts running immediately and destroys itself when it finishes.
+	 *
+	 * \code
+	 * sws::Task serve(sws::EventLoop& loop, sws::TcpSocket socket)
+	 * {
+	 *     sws::Packet packet;
+	 *
+	 *     while (co_await sws::async_receive(loop, socket, packet) == sws::SocketState::done)
+	 *     {
+	 *         co_await sws::async_send(loop, socket, packet);
+	 *     }
+	 *
+	 *     loop.remove(socket);
+	 * }
+	 * \endcode
+	 *
+	 * \remark Nothing owns a detached coroutine to receive its exceptions, and rethrowing into
+	 * whoever resumed it would leave its frame alive but unreachable. So, as with \c std::thread,
+	 * an exception escaping the coroutine calls \c std::terminate
+	 */
+	class Task
+	{
+	public:
+		struct promise_type
+		{
+			Task get_return_object() noexcept
+			{
+				return {};
+			}
+
+			std::suspend_never initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			std::suspend_never final_suspend() noexcept
+			{
+				return {};
+			}
+
+			void return_void() noexcept
+			{
+			}
+
+			void unhandled_exception() noexcept
+			{
+				std::terminate();
+			}
+		};
+	};
+
+	/**
+	 * \brief Base of the socket awaitables. The operation is attempted immediately
+	 * and the coroutine is only suspended if it would block. While suspended, the
+	 * operation is retried on readiness until it no longer returns
+	 * \c sws::SocketState::in_progress, and only then is the coroutine resumed.
+	 *
+	 * If a timeout is given and expires first, the operation is abandoned and the
+	 * awaitable yields \c sws::SocketState::closed with a native error of
+	 * \c sws::SocketError::timed_out. A partially sent or received packet is left
+	 * in an unspecified state, so the connection should be closed.
+	 *
+	 * \remark Awaiting does not allocate once the socket is registered with the loop.
+	 * The socket must be non-blocking and must be passed to \c sws::EventLoop::remove
+	 * before it is closed.
+	 */
+	template <typename Derived>
+	class AsyncOperation
+	{
+	public:
+		using duration = TimerWheel::clock::duration;
+
+	protected:
+		EventLoop& loop_;
+		Socket&    socket_;
+		duration   timeout_;
+
+		SocketState             state_ = SocketState::in_progress;
+		std::coroutine_handle<> handle_;
+		TimerId                 timer_;
+
+		AsyncOperation(EventLoop& loop, Socket& socket, duration timeout);
+
+	public:
+		AsyncOperation(const AsyncOperation&) = delete;
+		AsyncOperation& operator=(const AsyncOperation&) = delete;
+
+		bool await_ready();
+		void await_suspend(std::coroutine_handle<> handle);
+		[[nodiscard]] SocketState await_resume() const;
+
+	protected:
+		static void on_ready(void* context, PollEvents events);
+		void on_timeout();
+	};
+
+	class ReceiveAwaiter : public AsyncOperation<ReceiveAwaiter>
+	{
+		friend class AsyncOperation<ReceiveAwaiter>;
+		static constexpr PollEvents wait_events = PollEvents::read;
+
+		Packet& packet_;
+
+	public:
+		ReceiveAwaiter(EventLoop& loop, Socket& socket, Packet& packet, duration timeout);
+
+	protected:
+		SocketState attempt(PollEvents events);
+	};
+
+	class SendAwaiter : public AsyncOperation<SendAwaiter>
+	{
+		friend class AsyncOperation<SendAwaiter>;
+		static constexpr PollEvents wait_events = PollEvents::write;
+
+		Packet& packet_;
+
+	public:
+		SendAwaiter(EventLoop& loop, Socket& socket, Packet& packet, duration timeout);
+
+	protected:
+		SocketState attempt(PollEvents events);
+	};
+
+	class AcceptAwaiter : public AsyncOperation<AcceptAwaiter>
+	{
+		friend class AsyncOperation<AcceptAwaiter>;
+		static constexpr PollEvents wait_events = PollEvents::read;
+
+		TcpSocket& accepted_;
+
+	public:
+		AcceptAwaiter(EventLoop& loop, TcpSocket& listener, TcpSocket& accepted, duration timeout);
+
+	protected:
+		SocketState attempt(PollEvents events);
+	};
+
+	class ConnectAwaiter : public AsyncOperation<ConnectAwaiter>
+	{
+		friend class AsyncOperation<ConnectAwaiter>;
+		static constexpr PollEvents wait_events = PollEvents::write;
+
+		const Address& address_;
+
+	public:
+		ConnectAwaiter(EventLoop& loop, Socket& socket, const Address& address, duration timeout);
+
+	protected:
+		SocketState attempt(PollEvents events);
+	};
+
+	/**
+	 * \brief Suspends a coroutine until a timer on the loop fires.
+	 */
+	class SleepAwaiter
+	{
+		EventLoop& loop_;
+		TimerWheel::clock::duration delay_;
+
+	public:
+		SleepAwaiter(EventLoop& loop, TimerWheel::clock::duration delay);
+
+		SleepAwaiter(const SleepAwaiter&) = delete;
+		SleepAwaiter& operator=(const SleepAwaiter&) = delete;
+
+		[[nodiscard]] bool await_ready() const;
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const;
+	};
+
+	/**
+	 * \brief Receives a \c sws::Packet from a connected peer without blocking the thread.
+	 * \param timeout Maximum time to wait for the whole packet. Zero waits indefinitely;
+	 * awaiting each packet with a timeout implements an idle disconnect.
+	 * \return An awaitable yielding \c sws::SocketState::done once \p packet is complete.
+	 * \see sws::Socket::receive(Packet&)
+	 */
+	[[nodiscard]] ReceiveAwaiter async_receive(EventLoop& loop, Socket& socket, Packet& packet,
+	                                           TimerWheel::clock::duration timeout = {});
+
+	/**
+	 * \brief Sends a \c sws::Packet to a connected peer without blocking the thread.
+	 * \param timeout Maximum time to wait for the whole packet to be sent. Zero waits indefinitely.
+	 * \return An awaitable yielding \c sws::SocketState::done once all of \p packet has been sent.
+	 * \see sws::Socket::send(Packet&)
+	 */
+	[[nodiscard]] SendAwaiter async_send(EventLoop& loop, Socket& socket, Packet& packet,
+	                                     TimerWheel::clock::duration timeout = {});
+
+	/**
+	 * \brief Accepts an incoming connection without blocking the thread.
+	 * \param loop Event loop to wait on.
+	 * \param listener Listening socket.
+	 * \param accepted [out] Accepted connection.
+	 * \param timeout Maximum time to wait for a connection. Zero waits indefinitely.
+	 * \return An awaitable yielding \c sws::SocketState::done once a connection has been accepted.
+	 * \see sws::TcpSocket::accept
+	 */
+	[[nodiscard]] AcceptAwaiter async_accept(EventLoop& loop, TcpSocket& listener, TcpSocket& accepted,
+	                                         TimerWheel::clock::duration timeout = {});
+
+	/**
+	 * \brief Connects a socket without blocking the thread.
+	 * \param timeout Maximum time to wait for the connection. Zero waits indefinitely.
+	 * \return An awaitable yielding \c sws::SocketState::done once connected.
+	 * \remark \p address must outlive the awaitable.
+	 * \see sws::Socket::connect
+	 */
+	[[nodiscard]] ConnectAwaiter async_connect(EventLoop& loop, Socket& socket, const Address& address,
+	                                           TimerWheel::clock::duration timeout = {});
+
+	/**
+	 * \brief Suspends a coroutine for a while without blocking the thread; useful for keepalives.
+	 * \param loop Event loop whose timers resume the coroutine.
+	 * \param delay Time to sleep for.
+	 */
+	[[nodiscard]] SleepAwaiter async_sleep(EventLoop& loop, TimerWheel::clock::duration delay);
+
+	template <typename Derived>
+	AsyncOperation<Derived>::AsyncOperation(EventLoop& loop, Socket& socket, duration timeout)
+		: loop_(loop),
+		  socket_(socket),
+		  timeout_(timeout)
+	{
+		enforce(!socket.blocking(), "Asynchronous operations require a non-blocking socket.");
+	}
+
+	template <typename Derived>
+	bool AsyncOperation<Derived>::await_ready()
+	{
+		state_ = static_cast<Derived*>(this)->attempt(PollEvents::none);
+		return state_ != SocketState::in_progress;
+	}
+
+	template <typename Derived>
+	void AsyncOperation<Derived>::await_suspend(std::coroutine_handle<> handle)
+	{
+		handle_ = handle;
+		loop_.wait(socket_, Derived::wait_events, &AsyncOperation::on_ready, static_cast<Derived*>(this));
+
+		if (timeout_ > duration::zero())
+		{
+			timer_ = loop_.timers().schedule(timeout_, [this]
+			{
+				on_timeout();
+			});
+		}
+	}
+
+	template <typename Derived>
+	SocketState AsyncOperation<Derived>::await_resume() const
+	{
+		return state_;
+	}
+
+	template <typename Derived>
+	void AsyncOperation<Derived>::on_ready(void* context, PollEvents events)
+	{
+		auto self = static_cast<Derived*>(context);
+
+		self->state_ = self->attempt(events);
+
+		if (self->state_ == SocketState::in_progress)
+		{
+			self->loop_.wait(self->socket_, Derived::wait_events, &AsyncOperation::on_ready, self);
+			return;
+		}
+
+		self->loop_.timers().cancel(std::exchange(self->timer_, {}));
+		self->handle_.resume();
+	}
+
+	template <typename Derived>
+	void AsyncOperation<Derived>::on_timeout()
+	{
+		timer_ = {};
+		loop_.cancel_wait(socket_, Derived::wait_events);
+
+		socket_.native_error_ = SocketError::timed_out;
+		state_ = to_state(SocketError::timed_out);
+
+		handle_.resume();
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "SharedPacket.h"
+
+namespace sws
+{
+	class Packet;
+	class TcpSocket;
+
+	/**
+	 * \brief Outcome of a \c sws::broadcast, counted per socket.
+	 */
+	struct BroadcastResult
+	{
+		/** Sockets which sent the whole packet, along with anything queued before it. */
+		size_t sent = 0;
+		/** Sockets which queued some of the packet because they would block. */
+		size_t queued = 0;
+		/** Sockets which are closed or failed; their queues were discarded. */
+		size_t failed = 0;
+
+		BroadcastResult& operator+=(const BroadcastResult& rhs);
+	};
+
+	/**
+	 * \brief Minimum number of sockets each worker thread of \c sws::broadcast is given.
+	 * Below this, waking a thread costs more than the sends it would take over.
+	 */
+	inline constexpr size_t broadcast_sockets_per_thread = 256;
+
+	/**
+	 * \brief Sends one packet to many connected TCP sockets.
+	 *
+	 * Every socket shares the same sealed buffer, so the payload and its length
+	 * header are prepared once however many sockets there are. Each socket sends
+	 * the packet together with anything already queued on it in one native call;
+	 * whatever does not fit is left in the socket's queue, to be sent by
+	 * \c Socket::flush or its next send.
+	 *
+	 * \param packet Packet to send.
+	 * \param sockets Sockets to send to. Null entries are skipped.
+	 * \param threads Maximum number of threads to split the sockets across, including
+	 * the calling thread. Each is given at least \c broadcast_sockets_per_thread sockets.
+	 * \return Number of sockets which sent, queued or failed to send the packet.
+	 * \remark No other thread may use any of \p sockets during the call. Worker threads
+	 * are kept in a process-wide pool and reused; a broadcast made while another is
+	 * using the pool sends from the calling thread alone.
+	 * \see Socket::send(const SharedPacket&)
+	 */
+	BroadcastResult broadcast(const SharedPacket& packet, std::span<TcpSocket* const> sockets, size_t threads = 1);
+
+	/**
+	 * \copydoc broadcast(const SharedPacket&, std::span<TcpSocket* const>, size_t)
+	 */
+	BroadcastResult broadcast(const SharedPacket& packet, std::span<TcpSocket> sockets, size_t threads = 1);
+
+	/**
+	 * \brief Seals a copy of \p packet once and sends it to many connected TCP sockets.
+	 * \see broadcast(const SharedPacket&, std::span<TcpSocket* const>, size_t)
+	 */
+	BroadcastResult broadcast(const Packet& packet, std::span<TcpSocket* const> sockets, size_t threads = 1);
+}
@@ -0,0 +1,271 @@
+#pragma once
+#include <WinSock2.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "Address.h"
+
+namespace sws
+{
+	class Packet;
+	enum class Protocol;
+
+	/**
+	 * \brief Direction of a captured packet, relative to the capturing socket.
+	 */
+	enum class CaptureDirection : uint8_t
+	{
+		sent = 1,
+		received
+	};
+
+	/**
+	 * \brief Receives the packets sent and received by capturing sockets.
+	 * \see sws::Socket::capture
+	 */
+	class CaptureSink
+	{
+	public:
+		virtual ~CaptureSink() = default;
+
+		/**
+		 * \brief Records a packet sent or received by a socket.
+		 * \param protocol Protocol of the socket.
+		 * \param direction Whether the packet was sent or received.
+		 * \param local Local address of the socket.
+		 * \param remote Address the packet was sent to or received from.
+		 * \param data The packet as it is on the wire.
+		 * \return \c false if the packet was dropped.
+		 * \remark Called on the I/O path of every capturing socket, possibly from
+		 * several threads at once; implementations must be thread-safe and should not block.
+		 */
+		virtual bool capture(Protocol protocol, CaptureDirection direction, const Address& local, const Address& remote,
+		                     std::span<const uint8_t> data) noexcept = 0;
+	};
+
+	/**
+	 * \brief A packet read back from a capture log.
+	 */
+	struct CaptureRecord
+	{
+		/**
+		 * \brief Value of \c sws::timestamp_now when the packet was captured.
+		 */
+		uint64_t timestamp = 0;
+
+		CaptureDirection direction = CaptureDirection::sent;
+
+		/**
+		 * \brief Address the packet was sent to or received from.
+		 */
+		Address address;
+
+		/**
+		 * \brief The packet as it was on the wire, including its size header.
+		 */
+		std::vector<uint8_t> data;
+
+		/**
+		 * \brief Reconstructs the captured packet.
+		 */
+		[[nodiscard]] Packet packet() const;
+	};
+
+	/**
+	 * \brief An append-only log of captured packets, backed by a memory-mapped file.
+	 *
+	 * The file grows in preallocated segments which are mapped into memory. Appending
+	 * reserves space with a single atomic add and copies the record into the mapping,
+	 * so any number of threads can append without taking a lock. A lock is only taken
+	 * to map a new segment, and the next segment is mapped ahead of time once half of
+	 * the current one is reserved.
+	 *
+	 * Records are written directly into the system file cache, so they survive the
+	 * process crashing.
+	 *
+	 * \see sws::Socket::capture
+	 * \see sws::CaptureReader
+	 */
+	class CaptureLog : public CaptureSink
+	{
+	public:
+		/**
+		 * \brief Default size of each mapped segment.
+		 */
+		static constexpr size_t default_segment_size = 16 * 1024 * 1024;
+
+		/**
+		 * \brief Default maximum number of segments, for a total of 1 GiB with the default segment size.
+		 */
+		static constexpr size_t default_max_segments = 64;
+
+	protected:
+		struct Segment
+		{
+			HANDLE                mapping = nullptr;
+			std::atomic<uint8_t*> view    = nullptr;
+		};
+
+		HANDLE file_ = INVALID_HANDLE_VALUE;
+
+		size_t segment_size_ = 0;
+		size_t max_segments_ = 0;
+
+		std::unique_ptr<Segment[]> segments_;
+		std::mutex                 map_lock_;
+
+		std::atomic<uint64_t> tail_    = 0;
+		std::atomic<uint64_t> dropped_ = 0;
+
+	public:
+		/**
+		 * \brief Creates a capture log, replacing any existing file.
+		 * \param path Path of the log file.
+		 * \param segment_size Size of each mapped segment. Must be a multiple of 64 KiB.
+		 * \param max_segments Maximum number of segments. Packets beyond the capacity are dropped.
+		 * \throws std::system_error if the file cannot be created or mapped.
+		 */
+		explicit CaptureLog(const std::filesystem::path& path,
+		                    size_t segment_size = default_segment_size,
+		                    size_t max_segments = default_max_segments);
+
+		CaptureLog(const CaptureLog&) = delete;
+		CaptureLog(CaptureLog&&) = delete;
+
+		~CaptureLog() override;
+
+		CaptureLog& operator=(const CaptureLog&) = delete;
+		CaptureLog& operator=(CaptureLog&&) = delete;
+
+		/**
+		 * \brief Appends a packet to the log.
+		 * \param direction Whether the packet was sent or received.
+		 * \param address Address the packet was sent to or received from.
+		 * \param data The packet as it is on the wire.
+		 * \return \c true on success, \c false if the packet was dropped because
+		 * the log is full, closed, a segment could not be mapped, or \p address could not be converted.
+		 * \remark This method is thread-safe and lock-free.
+		 */
+		bool append(CaptureDirection direction, const Address& address, std::span<const uint8_t> data) noexcept;
+
+		/**
+		 * \brief Appends a packet captured by a socket. Only \p remote is logged.
+		 * \see sws::CaptureLog::append
+		 */
+		bool capture(Protocol protocol, CaptureDirection direction, const Address& local, const Address& remote,
+		             std::span<const uint8_t> data) noexcept override;
+
+		/**
+		 * \brief Unmaps the log and truncates the file to its contents.
+		 * \remark Must not be called while other threads may be appending.
+		 */
+		void close() noexcept;
+
+		/**
+		 * \brief Checks if the log is open.
+		 */
+		[[nodiscard]] bool is_open() const;
+
+		/**
+		 * \brief Gets the number of bytes reserved in the file so far.
+		 */
+		[[nodiscard]] uint64_t size() const;
+
+		/**
+		 * \brief Gets the number of packets which could not be appended.
+		 */
+		[[nodiscard]] uint64_t dropped() const;
+
+	protected:
+		uint8_t* segment(size_t index) noexcept;
+	};
+
+	/**
+	 * \brief Reads the records of a capture log in the order they were appended.
+	 */
+	class CaptureReader
+	{
+	protected:
+		std::ifstream file_;
+
+		uint64_t start_time_      = 0;
+		uint64_t start_timestamp_ = 0;
+
+	public:
+		/**
+		 * \brief Opens a capture log.
+		 * \param path Path of the log file.
+		 * \throws std::runtime_error if the file cannot be opened or is not a capture log.
+		 */
+		explicit CaptureReader(const std::filesystem::path& path);
+
+		/**
+		 * \brief Reads the next record.
+		 * \param record [out] The record read.
+		 * \return \c false at the end of the log.
+		 */
+		bool next(CaptureRecord& record);
+
+		/**
+		 * \brief Gets the wall clock time the log was created at, in nanoseconds since the UNIX epoch.
+		 */
+		[[nodiscard]] uint64_t start_time() const;
+
+		/**
+		 * \brief Gets the value of \c sws::timestamp_now when the log was created.
+		 * Together with \c CaptureReader::start_time, this converts record timestamps to wall clock time.
+		 */
+		[[nodiscard]] uint64_t start_timestamp() const;
+	};
+
+	/**
+	 * \brief Defines how fast \c sws::replay feeds records to its handler.
+	 */
+	enum class ReplayPace
+	{
+		/**
+		 * \brief Feed records as fast as the handler accepts them.
+		 */
+		as_fast_as_possible,
+
+		/**
+		 * \brief Feed records with the same spacing in time as they were captured.
+		 */
+		recorded
+	};
+
+	/**
+	 * \brief Feeds the records of a capture log to a handler.
+	 *
+	 * To replay through a socket pair, send the reconstructed packets from the handler:
+	 * \code
+	 * sws::CaptureReader reader("session.cap");
+	 *
+	 * sws::replay(reader, [&](const sws::CaptureRecord& record)
+	 * {
+	 *     if (record.direction == sws::CaptureDirection::received)
+	 *     {
+	 *         sws::Packet packet = record.packet();
+	 *         return client.send(packet) == sws::SocketState::done;
+	 *     }
+	 *
+	 *     return true;
+	 * }, sws::ReplayPace::recorded);
+	 * \endcode
+	 *
+	 * \param reader Log to read records from.
+	 * \param handler Called with each record. Returning \c false stops the replay.
+	 * \param pace How fast to feed records.
+	 * \return Number of records fed to \p handler
+	 */
+	size_t replay(CaptureReader& reader, const std::function<bool(const CaptureRecord&)>& handler,
+	              ReplayPace pace = ReplayPace::as_fast_as_possible);
+}
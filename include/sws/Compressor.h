@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace sws
+{
+	class Packet;
+
+	/**
+	 * \brief Flags in the first byte of a payload produced by \c sws::Compressor
+	 */
+	enum class CompressionFlags : uint8_t
+	{
+		none = 0,
+
+		/**
+		 * \brief The payload is compressed. Otherwise it is stored as is.
+		 */
+		compressed = 1 << 0,
+
+		/**
+		 * \brief The payload was compressed against a dictionary, which the receiver must also have.
+		 */
+		dictionary = 1 << 1
+	};
+
+	constexpr CompressionFlags operator|(CompressionFlags lhs, CompressionFlags rhs)
+	{
+		return static_cast<CompressionFlags>(static_cast<uint8_t>(lhs) | static_cast<uint8_t>(rhs));
+	}
+
+	constexpr CompressionFlags operator&(CompressionFlags lhs, CompressionFlags rhs)
+	{
+		return static_cast<CompressionFlags>(static_cast<uint8_t>(lhs) & static_cast<uint8_t>(rhs));
+	}
+
+	constexpr bool any(CompressionFlags flags)
+	{
+		return flags != CompressionFlags::none;
+	}
+
+	/**
+	 * \brief Fast LZ77 compression of \c sws::Packet payloads.
+	 *
+	 * Payloads are encoded in the LZ4 block format by a greedy single-pass matcher,
+	 * trading ratio for speed. Each encoded payload starts with a \c sws::CompressionFlags
+	 * byte. Payloads smaller than the threshold, and those which do not shrink, are
+	 * stored as is behind a flag byte of \c CompressionFlags::none
+	 *
+	 * Small messages rarely repeat themselves, but usually repeat each other. A
+	 * dictionary of typical content, e.g. built by \c Compressor::train from captured
+	 * traffic, lets matches refer to it as if it preceded every payload. Both peers
+	 * must use the same dictionary.
+	 *
+	 * \remark \c Compressor::compress uses scratch space in the instance, so each thread
+	 * needs its own compressor. \c Compressor::decompress may be called concurrently.
+	 */
+	class Compressor
+	{
+	public:
+		/**
+		 * \brief Default size of a payload below which it is not compressed.
+		 */
+		static constexpr size_t default_threshold = 64;
+
+		/**
+		 * \brief Maximum size of a dictionary. Matches can only refer 64 KiB back.
+		 */
+		static constexpr size_t max_dictionary_size = 65535;
+
+		/**
+		 * \brief Default size of a dictionary built by \c Compressor::train
+		 */
+		static constexpr size_t default_dictionary_size = 16 * 1024;
+
+	protected:
+		size_t threshold_ = default_threshold;
+
+		std::vector<uint8_t> dictionary_;
+
+		// Last position of each hashed sequence of the dictionary; built once when it is set.
+		std::unique_ptr<uint32_t[]> dictionary_table_;
+
+		// Last position of each hashed sequence of the payload being compressed.
+		std::unique_ptr<uint32_t[]> table_;
+
+	public:
+		/**
+		 * \brief Constructs a compressor without a dictionary.
+		 * \param threshold Size of a payload below which it is not compressed.
+		 */
+		explicit Compressor(size_t threshold = default_threshold);
+
+		/**
+		 * \brief Constructs a compressor with a dictionary.
+		 * \param dictionary Dictionary shared with the peer. Only the last \c max_dictionary_size bytes are used.
+		 * \param threshold Size of a payload below which it is not compressed.
+		 */
+		explicit Compressor(std::span<const uint8_t> dictionary, size_t threshold = default_threshold);
+
+		Compressor(const Compressor& other);
+		Compressor(Compressor&& other) noexcept = default;
+		~Compressor();
+
+		Compressor& operator=(const Compressor& other);
+		Compressor& operator=(Compressor&& other) noexcept = default;
+
+		/**
+		 * \brief Gets the size of a payload below which it is not compressed.
+		 */
+		[[nodiscard]] size_t threshold() const;
+
+		/**
+		 * \brief Sets the size of a payload below which it is not compressed.
+		 */
+		void threshold(size_t value);
+
+		/**
+		 * \brief Gets the dictionary, or an empty span if there is none.
+		 */
+		[[nodiscard]] std::span<const uint8_t> dictionary() const;
+
+		/**
+		 * \brief Sets the dictionary. Only the last \c max_dictionary_size bytes are used.
+		 * \param value Dictionary shared with the peer, or an empty span to remove it.
+		 */
+		void dictionary(std::span<const uint8_t> value);
+
+		/**
+		 * \brief Encodes the payload of a packet.
+		 * \param source Packet to encode. Its cursors are not used or changed.
+		 * \param destination [out] Receives the encoded payload, with its read cursor at the start.
+		 * \return \c true if the payload was compressed, \c false if it was stored as is.
+		 * \throws std::logic_error if \p source and \p destination are the same packet,
+		 * or if \p source is full, leaving no room for the flag byte.
+		 */
+		bool compress(const Packet& source, Packet& destination);
+
+		/**
+		 * \brief Decodes a payload produced by \c Compressor::compress directly into a packet.
+		 * \param source Packet to decode. Its cursors are not used or changed.
+		 * \param destination [out] Receives the original payload, with its read cursor at the start.
+		 * \return \c false if \p source is malformed or needs a dictionary this compressor does
+		 * not have, in which case \p destination is left empty.
+		 * \throws std::logic_error if \p source and \p destination are the same packet.
+		 */
+		[[nodiscard]] bool decompress(const Packet& source, Packet& destination) const;
+
+		/**
+		 * \brief Checks if a payload produced by \c Compressor::compress is compressed.
+		 */
+		[[nodiscard]] static bool is_compressed(const Packet& packet);
+
+		/**
+		 * \brief Builds a dictionary from sample payloads, e.g. reconstructed from a \c sws::CaptureLog
+		 *
+		 * Segments of the samples are chosen greedily by how many of their 8-byte sequences
+		 * occur in other samples and are not yet covered by an earlier segment. The most
+		 * common segments are placed last, closest to the payloads that refer to them.
+		 *
+		 * \param samples Typical payloads.
+		 * \param size Maximum size of the dictionary.
+		 * \return The dictionary, which may be smaller than \p size if the samples have little in common.
+		 */
+		[[nodiscard]] static std::vector<uint8_t> train(std::span<const Packet> samples, size_t size = default_dictionary_size);
+	};
+}
@@ -0,0 +1,521 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "enforce.h"
+
+namespace sws
+{
+	/**
+	 * \brief Assumed size of a cache line, used to keep producer and consumer
+	 * state of the queues below from sharing a line (false sharing).
+	 */
+	inline constexpr size_t cache_line_size = 64;
+
+	/**
+	 * \brief A bounded, lock-free, single-producer single-consumer ring queue.
+	 * Suitable for handing \c sws::Packet objects from one I/O thread to one worker thread.
+	 * \tparam T Element type. Must be nothrow move constructible.
+	 */
+	template <typename T>
+	class SpscQueue
+	{
+		static_assert(std::is_nothrow_move_constructible_v<T>, "T must be nothrow move constructible");
+
+		struct Slot
+		{
+			alignas(T) std::byte storage[sizeof(T)];
+
+			T* get() noexcept
+			{
+				return std::launder(reinterpret_cast<T*>(storage));
+			}
+		};
+
+		const size_t            mask_;
+		std::unique_ptr<Slot[]> slots_;
+
+		// producer-owned
+		alignas(cache_line_size) std::atomic<size_t> tail_ = 0;
+		size_t cached_head_ = 0;
+
+		// consumer-owned
+		alignas(cache_line_size) std::atomic<size_t> head_ = 0;
+		size_t cached_tail_ = 0;
+
+	public:
+		/**
+		 * \brief Constructs a queue.
+		 * \param capacity Minimum number of elements the queue can hold. Rounded up to a power of two.
+		 */
+		explicit SpscQueue(size_t capacity);
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+		~SpscQueue();
+
+		/**
+		 * \brief Attempts to enqueue an element. Producer only.
+		 * \return \c false if the queue is full, in which case \p value is left untouched.
+		 */
+		bool try_push(T&& value);
+
+		/**
+		 * \brief Attempts to enqueue a copy of an element. Producer only.
+		 * \return \c false if the queue is full.
+		 */
+		bool try_push(const T& value);
+
+		/**
+		 * \brief Enqueues as many elements as fit, moving them out of \p values. Producer only.
+		 * \param values Pointer to the first element to enqueue.
+		 * \param count Number of elements in \p values
+		 * \return Number of elements enqueued (from the start of \p values).
+		 */
+		size_t try_push(T* values, size_t count);
+
+		/**
+		 * \brief Attempts to dequeue an element. Consumer only.
+		 * \return \c false if the queue is empty.
+		 */
+		bool try_pop(T& value);
+
+		/**
+		 * \brief Dequeues up to \p count elements. Consumer only.
+		 * \param values Destination array.
+		 * \param count Maximum number of elements to dequeue.
+		 * \return Number of elements dequeued.
+		 */
+		size_t try_pop(T* values, size_t count);
+
+		/**
+		 * \brief Gets the capacity of the queue.
+		 */
+		[[nodiscard]] size_t capacity() const;
+
+		/**
+		 * \brief Gets an approximation of the number of elements in the queue.
+		 */
+		[[nodiscard]] size_t size() const;
+
+		/**
+		 * \brief Checks if the queue is (approximately) empty.
+		 */
+		[[nodiscard]] bool empty() const;
+
+	protected:
+		size_t writable(size_t tail);
+		size_t readable(size_t head);
+	};
+
+	/**
+	 * \brief A bounded, lock-free, multi-producer single-consumer ring queue.
+	 * Suitable for handing \c sws::Packet objects from many I/O threads to one worker thread.
+	 * \tparam T Element type. Must be nothrow move constructible.
+	 */
+	template <typename T>
+	class MpscQueue
+	{
+		static_assert(std::is_nothrow_move_constructible_v<T>, "T must be nothrow move constructible");
+
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			alignas(T) std::byte storage[sizeof(T)];
+
+			T* get() noexcept
+			{
+				return std::launder(reinterpret_cast<T*>(storage));
+			}
+		};
+
+		const size_t            mask_;
+		std::unique_ptr<Slot[]> slots_;
+
+		// shared by producers
+		alignas(cache_line_size) std::atomic<size_t> tail_ = 0;
+
+		// consumer-owned
+		alignas(cache_line_size) std::atomic<size_t> head_ = 0;
+
+	public:
+		/**
+		 * \brief Constructs a queue.
+		 * \param capacity Minimum number of elements the queue can hold. Rounded up to a power of two.
+		 */
+		explicit MpscQueue(size_t capacity);
+
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+		~MpscQueue();
+
+		/**
+		 * \brief Attempts to enqueue an element. Thread-safe.
+		 * \return \c false if the queue is full, in which case \p value is left untouched.
+		 */
+		bool try_push(T&& value);
+
+		/**
+		 * \brief Attempts to enqueue a copy of an element. Thread-safe.
+		 * \return \c false if the queue is full.
+		 */
+		bool try_push(const T& value);
+
+		/**
+		 * \brief Enqueues as many elements as fit with a single reservation, moving them out of \p values. Thread-safe.
+		 * \param values Pointer to the first element to enqueue.
+		 * \param count Number of elements in \p values
+		 * \return Number of elements enqueued (from the start of \p values).
+		 */
+		size_t try_push(T* values, size_t count);
+
+		/**
+		 * \brief Attempts to dequeue an element. Consumer only.
+		 * \return \c false if the queue is empty.
+		 */
+		bool try_pop(T& value);
+
+		/**
+		 * \brief Dequeues up to \p count elements. Consumer only.
+		 * \param values Destination array.
+		 * \param count Maximum number of elements to dequeue.
+		 * \return Number of elements dequeued.
+		 */
+		size_t try_pop(T* values, size_t count);
+
+		/**
+		 * \brief Gets the capacity of the queue.
+		 */
+		[[nodiscard]] size_t capacity() const;
+
+		/**
+		 * \brief Gets an approximation of the number of elements in the queue.
+		 */
+		[[nodiscard]] size_t size() const;
+
+		/**
+		 * \brief Checks if the queue is (approximately) empty.
+		 */
+		[[nodiscard]] bool empty() const;
+
+	protected:
+		size_t reserve(size_t& count);
+	};
+
+	template <typename T>
+	SpscQueue<T>::SpscQueue(size_t capacity)
+		: mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+		  slots_(std::make_unique<Slot[]>(mask_ + 1))
+	{
+	}
+
+	template <typename T>
+	SpscQueue<T>::~SpscQueue()
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+
+		for (size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i)
+		{
+			slots_[i & mask_].get()->~T();
+		}
+	}
+
+	template <typename T>
+	bool SpscQueue<T>::try_push(T&& value)
+	{
+		return try_push(&value, 1) == 1;
+	}
+
+	template <typename T>
+	bool SpscQueue<T>::try_push(const T& value)
+	{
+		T copy(value);
+		return try_push(std::move(copy));
+	}
+
+	template <typename T>
+	size_t SpscQueue<T>::try_push(T* values, size_t count)
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		count = std::min(count, writable(tail));
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			new (slots_[(tail + i) & mask_].storage) T(std::move(values[i]));
+		}
+
+		if (count)
+		{
+			tail_.store(tail + count, std::memory_order_release);
+		}
+
+		return count;
+	}
+
+	template <typename T>
+	bool SpscQueue<T>::try_pop(T& value)
+	{
+		return try_pop(&value, 1) == 1;
+	}
+
+	template <typename T>
+	size_t SpscQueue<T>::try_pop(T* values, size_t count)
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+		count = std::min(count, readable(head));
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			T* element = slots_[(head + i) & mask_].get();
+
+			values[i] = std::move(*element);
+			element->~T();
+		}
+
+		if (count)
+		{
+			head_.store(head + count, std::memory_order_release);
+		}
+
+		return count;
+	}
+
+	template <typename T>
+	size_t SpscQueue<T>::capacity() const
+	{
+		return mask_ + 1;
+	}
+
+	template <typename T>
+	size_t SpscQueue<T>::size() const
+	{
+		const size_t head = head_.load(std::memory_order_acquire);
+		const size_t tail = tail_.load(std::memory_order_acquire);
+
+		return tail - head;
+	}
+
+	template <typename T>
+	bool SpscQueue<T>::empty() const
+	{
+		return !size();
+	}
+
+	template <typename T>
+	size_t SpscQueue<T>::writable(size_t tail)
+	{
+		// Only re-read the consumer's index when the cached one says we're full,
+		// which keeps the consumer's cache line out of the producer's way.
+		size_t free = capacity() - (tail - cached_head_);
+
+		if (!free)
+		{
+			cached_head_ = head_.load(std::memory_order_acquire);
+			free = capacity() - (tail - cached_head_);
+		}
+
+		return free;
+	}
+
+	template <typename T>
+	size_t SpscQueue<T>::readable(size_t head)
+	{
+		size_t available = cached_tail_ - head;
+
+		if (!available)
+		{
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			available = cached_tail_ - head;
+		}
+
+		return available;
+	}
+
+	template <typename T>
+	MpscQueue<T>::MpscQueue(size_t capacity)
+		: mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+		  slots_(std::make_unique<Slot[]>(mask_ + 1))
+	{
+		// Each slot's sequence is the position it can next be written at.
+		// After a write it becomes position + 1, which marks it readable.
+		for (size_t i = 0; i <= mask_; ++i)
+		{
+			slots_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	template <typename T>
+	MpscQueue<T>::~MpscQueue()
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+
+		for (size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i)
+		{
+			Slot& slot = slots_[i & mask_];
+
+			if (slot.sequence.load(std::memory_order_relaxed) == i + 1)
+			{
+				slot.get()->~T();
+			}
+		}
+	}
+
+	template <typename T>
+	bool MpscQueue<T>::try_push(T&& value)
+	{
+		return try_push(&value, 1) == 1;
+	}
+
+	template <typename T>
+	bool MpscQueue<T>::try_push(const T& value)
+	{
+		T copy(value);
+		return try_push(std::move(copy));
+	}
+
+	template <typename T>
+	size_t MpscQueue<T>::try_push(T* values, size_t count)
+	{
+		if (!count)
+		{
+			return 0;
+		}
+
+		const size_t position = reserve(count);
+
+		if (!count)
+		{
+			return 0;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			Slot& slot = slots_[(position + i) & mask_];
+
+			new (slot.storage) T(std::move(values[i]));
+			slot.sequence.store(position + i + 1, std::memory_order_release);
+		}
+
+		return count;
+	}
+
+	template <typename T>
+	bool MpscQueue<T>::try_pop(T& value)
+	{
+		return try_pop(&value, 1) == 1;
+	}
+
+	template <typename T>
+	size_t MpscQueue<T>::try_pop(T* values, size_t count)
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+		size_t popped = 0;
+
+		for (; popped < count; ++popped)
+		{
+			const size_t position = head + popped;
+			Slot& slot = slots_[position & mask_];
+
+			// Stops at the first slot that hasn't been published yet, even if
+			// later producers have already finished, to preserve order.
+			if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+			{
+				break;
+			}
+
+			T* element = slot.get();
+
+			values[popped] = std::move(*element);
+			element->~T();
+
+			slot.sequence.store(position + capacity(), std::memory_order_release);
+		}
+
+		if (popped)
+		{
+			head_.store(head + popped, std::memory_order_release);
+		}
+
+		return popped;
+	}
+
+	template <typename T>
+	size_t MpscQueue<T>::capacity() const
+	{
+		return mask_ + 1;
+	}
+
+	template <typename T>
+	size_t MpscQueue<T>::size() const
+	{
+		const size_t head = head_.load(std::memory_order_acquire);
+		const size_t tail = tail_.load(std::memory_order_acquire);
+
+		return tail > head ? tail - head : 0;
+	}
+
+	template <typename T>
+	bool MpscQueue<T>::empty() const
+	{
+		return !size();
+	}
+
+	template <typename T>
+	size_t MpscQueue<T>::reserve(size_t& count)
+	{
+		size_t position = tail_.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			const size_t used = position - head_.load(std::memory_order_acquire);
+
+			// The tail is stale if the consumer has since popped past it,
+			// which would otherwise underflow and look like a full queue.
+			if (used > capacity())
+			{
+				position = tail_.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			const size_t batch = std::min(count, capacity() - used);
+
+			if (!batch)
+			{
+				count = 0;
+				return position;
+			}
+
+			// The consumer frees slots in order, so if the last slot of the
+			// batch is free for this lap, every slot before it is too.
+			const size_t last = position + batch - 1;
+			const size_t sequence = slots_[last & mask_].sequence.load(std::memory_order_acquire);
+
+			if (sequence == last)
+			{
+				if (tail_.compare_exchange_weak(position, position + batch, std::memory_order_relaxed))
+				{
+					count = batch;
+					return position;
+				}
+			}
+			else if (sequence < last)
+			{
+				// The consumer hasn't released the slot yet; the queue is full.
+				count = 0;
+				return position;
+			}
+			else
+			{
+				position = tail_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace sws
+{
+	/**
+	 * \brief Computes the CRC32C (Castagnoli) checksum of a buffer.
+	 *
+	 * Uses the SSE4.2 \c crc32 instruction on three interleaved streams, combined with
+	 * PCLMULQDQ, when the processor supports them; otherwise a portable slicing-by-8
+	 * table implementation. Both give the same result.
+	 *
+	 * \param data Buffer to checksum.
+	 * \param crc Checksum of the preceding data, to checksum a buffer in pieces.
+	 * \return The checksum, e.g. \c 0xE3069283 for the ASCII string \c "123456789"
+	 */
+	[[nodiscard]] uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc = 0);
+
+	/**
+	 * \brief Checks if \c sws::crc32c uses hardware instructions on this processor.
+	 */
+	[[nodiscard]] bool crc32c_accelerated();
+}
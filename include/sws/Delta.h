@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Packet.h"
+
+namespace sws
+{
+	/**
+	 * \brief Appends the difference between two payloads to a packet.
+	 *
+	 * The delta is a sequence of runs: a number of bytes to keep from \p baseline,
+	 * then a number of bytes taken from \p current, each as a variable-length integer.
+	 * Unchanged spans are found 64 bytes at a time with SIMD compares, so encoding
+	 * mostly unchanged snapshots costs little more than reading them.
+	 *
+	 * \param baseline Payload the receiver already has.
+	 * \param current Payload to encode.
+	 * \param delta [out] Packet to append the delta to, at its write cursor.
+	 * \return \c false if the delta did not fit in \p delta
+	 * \see delta_apply
+	 */
+	bool delta_encode(const Packet& baseline, const Packet& current, Packet& delta);
+
+	/**
+	 * \brief Reconstructs a payload from its baseline and a delta produced by \c sws::delta_encode
+	 * \param baseline Payload the delta was encoded against.
+	 * \param delta Packet containing the delta from its read cursor to its end. The read cursor is advanced past it.
+	 * \param result [out] Receives the reconstructed payload, with its read cursor at the start.
+	 * \return \c false if \p delta is malformed or does not match \p baseline, in which case \p result is left empty.
+	 */
+	bool delta_apply(const Packet& baseline, Packet& delta, Packet& result);
+
+	/**
+	 * \brief Sending side of a stream of snapshots delta encoded against the latest one the peer acknowledged.
+	 *
+	 * Each snapshot is given a sequence number and kept in a history. Until the peer
+	 * acknowledges one which is still in the history, snapshots are sent whole.
+	 * Encoded snapshots start with a header of the sequence number (\c uint32_t) and the
+	 * sequence number of the baseline (\c uint32_t), which equals the sequence number
+	 * for a whole snapshot.
+	 *
+	 * Use one encoder per peer, paired with a \c sws::DeltaDecoder with the same history size.
+	 */
+	class DeltaEncoder
+	{
+	public:
+		/**
+		 * \brief Default number of snapshots kept as potential baselines.
+		 */
+		static constexpr size_t default_history = 32;
+
+	protected:
+		struct Snapshot
+		{
+			uint32_t sequence = 0;
+			bool     valid    = false;
+			Packet   packet;
+		};
+
+		std::vector<Snapshot> history_;
+
+		uint32_t                next_sequence_ = 0;
+		std::optional<uint32_t> acknowledged_;
+
+		// Reused to encode each delta before deciding if it beats the whole snapshot.
+		Packet delta_;
+
+	public:
+		/**
+		 * \brief Constructs an encoder.
+		 * \param history Number of snapshots kept as potential baselines.
+		 * An acknowledgement older than this many snapshots is of no use.
+		 */
+		explicit DeltaEncoder(size_t history = default_history);
+
+		/**
+		 * \brief Encodes the next snapshot.
+		 * \param snapshot Snapshot payload. A copy is kept in the history.
+		 * \param output [out] Receives the header and the delta, or the whole snapshot if that is smaller.
+		 * \return Sequence number given to the snapshot.
+		 * \throws std::logic_error if the whole snapshot and header do not fit in a packet.
+		 */
+		uint32_t encode(const Packet& snapshot, Packet& output);
+
+		/**
+		 * \brief Records that the peer has received a snapshot.
+		 * Acknowledgements of snapshots older than the current baseline, or no longer in the history, are ignored.
+		 * \param sequence Sequence number returned by \c DeltaDecoder::decode
+		 */
+		void acknowledge(uint32_t sequence);
+
+		/**
+		 * \brief Gets the sequence number of the snapshot the next one will be encoded against, if any.
+		 */
+		[[nodiscard]] std::optional<uint32_t> baseline() const;
+
+		/**
+		 * \brief Forgets every snapshot and acknowledgement, e.g. when the peer reconnects.
+		 * Sequence numbers continue from where they were.
+		 */
+		void reset();
+
+	protected:
+		[[nodiscard]] const Snapshot* find(uint32_t sequence) const;
+	};
+
+	/**
+	 * \brief Receiving side of a stream of snapshots encoded by a \c sws::DeltaEncoder
+	 *
+	 * Decoded snapshots are kept as baselines for later deltas. Snapshots may arrive
+	 * out of order or not at all, as long as the baseline of each is still in the history.
+	 */
+	class DeltaDecoder
+	{
+	protected:
+		struct Snapshot
+		{
+			uint32_t sequence = 0;
+			bool     valid    = false;
+			Packet   packet;
+		};
+
+		std::vector<Snapshot> history_;
+
+	public:
+		/**
+		 * \brief Constructs a decoder.
+		 * \param history Number of decoded snapshots kept. Must match that of the \c sws::DeltaEncoder
+		 */
+		explicit DeltaDecoder(size_t history = DeltaEncoder::default_history);
+
+		/**
+		 * \brief Decodes a snapshot.
+		 * \param input Packet produced by \c DeltaEncoder::encode, read from its read cursor.
+		 * \param snapshot [out] Receives the snapshot payload.
+		 * \param sequence [out] Sequence number of the snapshot, to be acknowledged to the encoder.
+		 * \return \c false if \p input is malformed or its baseline is no longer available.
+		 */
+		bool decode(Packet& input, Packet& snapshot, uint32_t& sequence);
+
+		/**
+		 * \brief Forgets every snapshot.
+		 */
+		void reset();
+	};
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "Histogram.h"
+#include "Packet.h"
+#include "typedefs.h"
+
+namespace sws
+{
+	/**
+	 * \brief A message type known to a \c sws::Dispatcher
+	 * It names its opcode with a \c static \c constexpr member \c opcode
+	 */
+	template <typename T>
+	concept Message = std::is_default_constructible_v<T> && requires
+	{
+		{ T::opcode } -> std::convertible_to<size_t>;
+	};
+
+	/**
+	 * \brief A message which decodes itself from a \c sws::Packet with <tt>bool read(Packet&)</tt>
+	 * Handlers receive the decoded message. Other messages are tags, and their
+	 * handlers receive the packet positioned past the opcode instead.
+	 */
+	template <typename T>
+	concept DecodableMessage = Message<T> && requires(T& message, Packet& packet)
+	{
+		{ message.read(packet) } -> std::convertible_to<bool>;
+	};
+
+	/**
+	 * \brief Outcome of dispatching one message.
+	 */
+	enum class DispatchResult
+	{
+		/** A handler was called. */
+		handled,
+		/** No message type has the opcode. */
+		unknown_opcode,
+		/** The opcode could not be read, or the message failed to decode. */
+		malformed
+	};
+
+	/**
+	 * \brief Counters of one opcode of a \c sws::Dispatcher
+	 */
+	struct OpcodeStatistics
+	{
+		uint64_t messages = 0;
+		uint64_t bytes    = 0;
+		/** Time spent in handlers, if \c Dispatcher::timing is enabled. */
+		uint64_t nanoseconds = 0;
+	};
+
+	/**
+	 * \brief Routes packets to typed handlers by a leading opcode.
+	 *
+	 * The opcode table is built at compile time from \p Messages, and is indexed
+	 * directly by opcode, so dispatching is a bounds check and an indirect call
+	 * regardless of the number of message types. Opcodes should therefore be dense.
+	 *
+	 * \p Handler is called as <tt>handler(message)</tt> for a \c sws::DecodableMessage and as
+	 * <tt>handler(Message {}, packet)</tt> for any other message. It may optionally provide
+	 * <tt>on_unknown(Opcode, Packet&)</tt>, called for opcodes without a message type, and
+	 * <tt>on_timing(Opcode, uint64_t nanoseconds)</tt>, called after each handler while
+	 * timing is enabled.
+	 *
+	 * \tparam Opcode Type of the opcode at the start of each packet: \c uint8_t, \c uint16_t or \c uint32_t
+	 * \tparam Handler Type of the handler, typically a class or a set of overloaded lambdas.
+	 * \tparam Messages Message types to dispatch.
+	 */
+	template <typename Opcode, typename Handler, Message... Messages>
+	class Dispatcher
+	{
+		static_assert(std::same_as<Opcode, uint8_t> || std::same_as<Opcode, uint16_t> || std::same_as<Opcode, uint32_t>,
+		              "Opcode must be an unsigned integer type supported by sws::Packet");
+		static_assert(sizeof...(Messages) > 0, "A dispatcher needs at least one message type.");
+
+		static consteval size_t max_opcode()
+		{
+			size_t result = 0;
+			((result = std::max(result, static_cast<size_t>(Messages::opcode))), ...);
+			return result;
+		}
+
+		static consteval bool unique_opcodes()
+		{
+			const std::array<size_t, sizeof...(Messages)> opcodes { static_cast<size_t>(Messages::opcode)... };
+
+			for (size_t i = 0; i < opcodes.size(); ++i)
+			{
+				for (size_t j = i + 1; j < opcodes.size(); ++j)
+				{
+					if (opcodes[i] == opcodes[j])
+					{
+						return false;
+					}
+				}
+			}
+
+			return true;
+		}
+
+	public:
+		/**
+		 * \brief Number of entries in the opcode table.
+		 */
+		static constexpr size_t table_size = max_opcode() + 1;
+
+		static_assert(unique_opcodes(), "Two message types share an opcode.");
+		static_assert(table_size <= 65536, "Opcodes must be dense; the table has an entry for every value up to the largest.");
+
+	protected:
+		using Entry = DispatchResult (*)(Handler&, Packet&);
+
+		template <typename M>
+		static DispatchResult invoke(Handler& handler, Packet& packet)
+		{
+			if constexpr (DecodableMessage<M>)
+			{
+				static_assert(std::invocable<Handler&, M&>, "Handler cannot be called with this decoded message type.");
+
+				M message {};
+
+				if (!message.read(packet))
+				{
+					return DispatchResult::malformed;
+				}
+
+				handler(message);
+			}
+			else
+			{
+				static_assert(std::invocable<Handler&, M, Packet&>, "Handler cannot be called with this message tag and a Packet.");
+				handler(M {}, packet);
+			}
+
+			return DispatchResult::handled;
+		}
+
+		static consteval std::array<Entry, table_size> make_table()
+		{
+			std::array<Entry, table_size> table {};
+			((table[static_cast<size_t>(Messages::opcode)] = &invoke<Messages>), ...);
+			return table;
+		}
+
+		static constexpr std::array<Entry, table_size> table_ = make_table();
+
+		Handler handler_;
+
+		std::array<OpcodeStatistics, table_size> statistics_ {};
+		uint64_t unknown_   = 0;
+		uint64_t malformed_ = 0;
+		bool     timing_    = false;
+
+		// Reused for each frame of a batch, so that small frames never allocate.
+		Packet frame_;
+
+	public:
+		explicit Dispatcher(Handler handler = {})
+			: handler_(std::move(handler))
+		{
+		}
+
+		/**
+		 * \brief Gets the handler.
+		 */
+		[[nodiscard]] Handler& handler()
+		{
+			return handler_;
+		}
+
+		/**
+		 * \brief Reads the opcode at the read position of \p packet and calls its handler.
+		 * \param packet Packet to dispatch, e.g. as returned by \c Socket::receive(Packet&)
+		 * \return \c sws::DispatchResult::handled if a handler was called.
+		 * \remark Exceptions thrown by handlers or by reading the message propagate to the caller.
+		 */
+		DispatchResult dispatch(Packet& packet)
+		{
+			Opcode opcode {};
+
+			if (!packet.read(opcode))
+			{
+				++malformed_;
+				return DispatchResult::malformed;
+			}
+
+			const auto index = static_cast<size_t>(opcode);
+
+			if (index >= table_size || !table_[index])
+			{
+				++unknown_;
+
+				if constexpr (requires { handler_.on_unknown(opcode, packet); })
+				{
+					handler_.on_unknown(opcode, packet);
+				}
+
+				return DispatchResult::unknown_opcode;
+			}
+
+			OpcodeStatistics& statistics = statistics_[index];
+			++statistics.messages;
+			statistics.bytes += packet.work_size();
+
+			DispatchResult result;
+
+			if (!timing_)
+			{
+				result = table_[index](handler_, packet);
+			}
+			else
+			{
+				const uint64_t start = timestamp_now();
+				result = table_[index](handler_, packet);
+				const uint64_t elapsed = timestamp_now() - start;
+
+				statistics.nanoseconds += elapsed;
+
+				if constexpr (requires { handler_.on_timing(opcode, elapsed); })
+				{
+					handler_.on_timing(opcode, elapsed);
+				}
+			}
+
+			if (result == DispatchResult::malformed)
+			{
+				++malformed_;
+			}
+
+			return result;
+		}
+
+		/**
+		 * \brief Dispatches every complete frame in a buffer of received stream data.
+		 * Frames are laid out as sent by \c Socket::send(Packet&): a \c packetlen_t size, then the payload.
+		 * \param buffer Received bytes, starting at a frame boundary.
+		 * \param consumed [out] Number of bytes of complete frames. Any remaining bytes are the
+		 * start of a frame which has not been fully received yet.
+		 * \return Number of frames dispatched.
+		 */
+		size_t dispatch_all(std::span<const uint8_t> buffer, size_t& consumed)
+		{
+			size_t count = 0;
+			consumed = 0;
+
+			while (buffer.size() - consumed >= sizeof(packetlen_t))
+			{
+				packetlen_t size = 0;
+				memcpy(&size, buffer.data() + consumed, sizeof(size));
+
+				if (buffer.size() - consumed - sizeof(packetlen_t) < size)
+				{
+					break;
+				}
+
+				frame_.clear();
+				frame_.write_data(buffer.data() + consumed + sizeof(packetlen_t), size, true);
+				consumed += sizeof(packetlen_t) + size;
+
+				dispatch(frame_);
+				++count;
+			}
+
+			return count;
+		}
+
+		/**
+		 * \brief Dispatches a batch of packets.
+		 * \return Number of packets for which a handler was called.
+		 */
+		size_t dispatch_all(std::span<Packet> packets)
+		{
+			size_t handled = 0;
+
+			for (Packet& packet : packets)
+			{
+				handled += dispatch(packet) == DispatchResult::handled;
+			}
+
+			return handled;
+		}
+
+		/**
+		 * \brief Checks if the time spent in handlers is measured.
+		 */
+		[[nodiscard]] bool timing() const
+		{
+			return timing_;
+		}
+
+		/**
+		 * \brief Enables or disables measuring the time spent in handlers. Disabled by default.
+		 */
+		void timing(bool value)
+		{
+			timing_ = value;
+		}
+
+		/**
+		 * \brief Gets the counters of an opcode. Opcodes without a message type have no counters.
+		 */
+		[[nodiscard]] OpcodeStatistics statistics(Opcode opcode) const
+		{
+			const auto index = static_cast<size_t>(opcode);
+			return index < table_size ? statistics_[index] : OpcodeStatistics {};
+		}
+
+		/**
+		 * \brief Gets the number of packets with an opcode without a message type.
+		 */
+		[[nodiscard]] uint64_t unknown() const
+		{
+			return unknown_;
+		}
+
+		/**
+		 * \brief Gets the number of packets without an opcode, or which failed to decode.
+		 */
+		[[nodiscard]] uint64_t malformed() const
+		{
+			return malformed_;
+		}
+
+		/**
+		 * \brief Resets every counter.
+		 */
+		void reset_statistics()
+		{
+			statistics_ = {};
+			unknown_    = 0;
+			malformed_  = 0;
+		}
+	};
+}
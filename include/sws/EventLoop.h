@@ -0,0 +1,215 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Socket.h"
+#include "TimerWheel.h"
+#include "UdpSocket.h"
+
+namespace sws
+{
+	/**
+	 * \brief Readiness events a socket can be watched for. May be combined.
+	 */
+	enum class PollEvents : uint8_t
+	{
+		none  = 0,
+
+		/**
+		 * \brief The socket can be read from (or accepted on) without blocking.
+		 */
+		read  = 1 << 0,
+
+		/**
+		 * \brief The socket can be written to without blocking.
+		 */
+		write = 1 << 1,
+
+		/**
+		 * \brief The socket has an error or has been closed. Always reported.
+		 */
+		error = 1 << 2
+	};
+
+	constexpr PollEvents operator|(PollEvents lhs, PollEvents rhs)
+	{
+		return static_cast<PollEvents>(static_cast<uint8_t>(lhs) | static_cast<uint8_t>(rhs));
+	}
+
+	constexpr PollEvents operator&(PollEvents lhs, PollEvents rhs)
+	{
+		return static_cast<PollEvents>(static_cast<uint8_t>(lhs) & static_cast<uint8_t>(rhs));
+	}
+
+	constexpr bool any(PollEvents events)
+	{
+		return events != PollEvents::none;
+	}
+
+	/**
+	 * \brief A single-threaded readiness loop over any number of sockets.
+	 * Handlers are invoked on the thread calling \c EventLoop::poll or \c EventLoop::run
+	 *
+	 * \remark Sockets are tracked by their native handle; moving a \c sws::Socket
+	 * does not affect its registration, but closing it requires calling
+	 * \c EventLoop::remove first.
+	 */
+	class EventLoop
+	{
+		friend class Socket;
+
+	public:
+		/**
+		 * \brief Callback invoked with the events a socket is ready for.
+		 */
+		using Handler = std::function<void(PollEvents events)>;
+
+		/**
+		 * \brief One-shot callback used by \c EventLoop::wait
+		 */
+		using WaitCallback = void (*)(void* context, PollEvents events);
+
+	protected:
+		struct Waiter
+		{
+			WaitCallback callback = nullptr;
+			void*        context  = nullptr;
+		};
+
+		struct Entry
+		{
+			NativeSocket socket  = INVALID_SOCKET;
+			Handler      handler;
+			Waiter       reader;
+			Waiter       writer;
+			bool         removed = false;
+		};
+
+		std::vector<WSAPOLLFD>              descriptors_;
+		std::vector<std::unique_ptr<Entry>> entries_;
+
+		std::unordered_map<NativeSocket, size_t> indices_;
+
+		bool dispatching_ = false;
+
+		std::atomic<bool> stopping_ = false;
+
+		UdpSocket  waker_;
+		TimerWheel timers_;
+
+		// auto-corked sockets with buffered data, flushed at the end of each poll
+		std::vector<Socket::Cork*> corked_;
+		std::vector<Socket::Cork*> flushing_;
+
+	public:
+		EventLoop();
+		EventLoop(const EventLoop&) = delete;
+		EventLoop& operator=(const EventLoop&) = delete;
+		~EventLoop() = default;
+
+		/**
+		 * \brief Starts watching a socket.
+		 * \param socket Socket to watch. Must be open.
+		 * \param events Events to watch for.
+		 * \param handler Callback invoked when the socket is ready.
+		 */
+		void add(const Socket& socket, PollEvents events, Handler handler);
+
+		/**
+		 * \brief Changes the events a socket is watched for.
+		 * \param socket A socket previously passed to \c EventLoop::add
+		 * \param events Events to watch for.
+		 */
+		void modify(const Socket& socket, PollEvents events);
+
+		/**
+		 * \brief Stops watching a socket. Safe to call from within a handler.
+		 * \param socket A socket previously passed to \c EventLoop::add
+		 */
+		void remove(const Socket& socket);
+
+		/**
+		 * \brief Waits once for a socket to become readable or writable.
+		 * The socket stays registered afterwards so that waiting again does not allocate.
+		 * \param socket Socket to wait on. Must be open and not have a \c Handler
+		 * \param events Either \c PollEvents::read or \c PollEvents::write
+		 * \param callback Invoked once when the socket is ready or has an error.
+		 * \param context Passed to \p callback
+		 * \remark Used to implement the awaitables in \c Async.h. A socket must be
+		 * passed to \c EventLoop::remove before it is closed.
+		 */
+		void wait(const Socket& socket, PollEvents events, WaitCallback callback, void* context);
+
+		/**
+		 * \brief Cancels a pending \c EventLoop::wait without invoking its callback.
+		 * \param socket Socket being waited on.
+		 * \param events Waits to cancel (\c PollEvents::read and/or \c PollEvents::write).
+		 */
+		void cancel_wait(const Socket& socket, PollEvents events);
+
+		/**
+		 * \brief Checks if a socket is being watched.
+		 */
+		[[nodiscard]] bool contains(const Socket& socket) const;
+
+		/**
+		 * \brief Gets the timers serviced by this loop.
+		 * Timer callbacks run on the polling thread after socket handlers, so an
+		 * idle disconnect is a timer that is pushed back on every receive:
+		 *
+		 * \code
+		 * const sws::TimerId idle = loop.timers().schedule(30s, [&] { disconnect(); });
+		 * // ...then, whenever data arrives:
+		 * loop.timers().reschedule(idle, 30s);
+		 * \endcode
+		 */
+		[[nodiscard]] TimerWheel& timers();
+
+		/**
+		 * \brief Waits for readiness and dispatches handlers once, then fires any due timers
+		 * and flushes sockets which are auto-corked on this loop.
+		 * \param timeout Maximum time to wait. Negative values wait indefinitely.
+		 * The wait is shortened so that the next timer is not missed, and so that
+		 * corked data which could not be sent is retried on the next tick.
+		 * \return Number of handlers and timers invoked.
+		 */
+		size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+		/**
+		 * \brief Calls \c EventLoop::poll until \c EventLoop::stop is called.
+		 */
+		void run();
+
+		/**
+		 * \brief Makes \c EventLoop::run return after the current iteration.
+		 * \remark This method is thread-safe.
+		 */
+		void stop();
+
+		/**
+		 * \brief Interrupts a blocking \c EventLoop::poll
+		 * \remark This method is thread-safe.
+		 */
+		void wake();
+
+	protected:
+		size_t add_native(NativeSocket socket, PollEvents events, Handler handler);
+		size_t dispatch();
+
+		void schedule_flush(Socket::Cork& cork);
+		void cancel_flush(Socket::Cork& cork);
+		void flush_corked();
+		void dispatch_waiters(size_t index, PollEvents events);
+		void update_waits(size_t index);
+		void compact();
+		void drain_waker();
+
+		static short to_native(PollEvents events);
+		static PollEvents from_native(short events);
+	};
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <WinSock2.h>
+
+#include <cstdint>
+#include <filesystem>
+
+namespace sws
+{
+	/**
+	 * \brief A range of a file being sent with \c sws::TcpSocket::send_file
+	 *
+	 * Like a \c sws::Packet being sent on a non-blocking socket, the transfer keeps
+	 * track of its own progress: when \c sws::TcpSocket::send_file returns
+	 * \c sws::SocketState::in_progress, call it again with the same transfer to resume.
+	 */
+	class FileTransfer
+	{
+		friend class TcpSocket;
+
+	public:
+		/**
+		 * \brief Length meaning "up to the end of the file".
+		 */
+		static constexpr uint64_t to_end = UINT64_MAX;
+
+	protected:
+		HANDLE file_       = INVALID_HANDLE_VALUE;
+		bool   owns_file_  = false;
+
+		uint64_t position_  = 0;
+		uint64_t remaining_ = 0;
+
+		// Window of the file mapped for non-blocking sends.
+		HANDLE         mapping_     = nullptr;
+		const uint8_t* view_        = nullptr;
+		uint64_t       view_offset_ = 0;
+		size_t         view_size_   = 0;
+
+	public:
+		/**
+		 * \brief Constructs an empty transfer.
+		 */
+		FileTransfer() = default;
+
+		/**
+		 * \brief Opens a file for reading and selects a range of it to send.
+		 * \param path Path of the file.
+		 * \param offset Offset of the first byte to send.
+		 * \param length Number of bytes to send. Clamped to the end of the file.
+		 * \throws std::system_error if the file cannot be opened.
+		 */
+		explicit FileTransfer(const std::filesystem::path& path, uint64_t offset = 0, uint64_t length = to_end);
+
+		/**
+		 * \brief Selects a range of an already open file to send.
+		 * \param file Handle of the file, opened for reading. It is not closed by the transfer.
+		 * \param offset Offset of the first byte to send.
+		 * \param length Number of bytes to send. Clamped to the end of the file.
+		 * \throws std::system_error if the size of the file cannot be determined.
+		 */
+		FileTransfer(HANDLE file, uint64_t offset, uint64_t length = to_end);
+
+		FileTransfer(const FileTransfer&) = delete;
+		FileTransfer(FileTransfer&& rhs) noexcept;
+
+		~FileTransfer();
+
+		FileTransfer& operator=(const FileTransfer&) = delete;
+		FileTransfer& operator=(FileTransfer&& rhs) noexcept;
+
+		/**
+		 * \brief Closes the file (if owned) and releases any mapped view of it.
+		 */
+		void close() noexcept;
+
+		/**
+		 * \brief Checks if a file is open.
+		 */
+		[[nodiscard]] bool is_open() const;
+
+		/**
+		 * \brief Gets the offset in the file of the next byte to send.
+		 */
+		[[nodiscard]] uint64_t position() const;
+
+		/**
+		 * \brief Gets the number of bytes left to send.
+		 */
+		[[nodiscard]] uint64_t remaining() const;
+
+		/**
+		 * \brief Checks if the whole range has been sent.
+		 */
+		[[nodiscard]] bool done() const;
+
+	protected:
+		void select(uint64_t offset, uint64_t length);
+		void advance(uint64_t sent);
+		void unmap() noexcept;
+		bool map();
+	};
+}
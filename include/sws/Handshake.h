@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+
+#include "Address.h"
+
+namespace sws
+{
+	class Packet;
+	class UdpSocket;
+
+	/**
+	 * \brief Computes the SipHash-2-4 keyed hash of a buffer.
+	 * \param key 128-bit secret key.
+	 * \param data Buffer to hash.
+	 * \return The 64-bit hash.
+	 */
+	[[nodiscard]] uint64_t siphash24(const std::array<uint8_t, 16>& key, std::span<const uint8_t> data);
+
+	/**
+	 * \brief Outcome of \c CookieHandshake::admit
+	 */
+	enum class HandshakeResult
+	{
+		/**
+		 * \brief The hello carried a valid cookie. The peer's address is verified,
+		 * and the packet's read cursor is past the hello.
+		 */
+		accepted,
+
+		/**
+		 * \brief The hello had no valid cookie, so a challenge with a fresh one was sent back.
+		 */
+		challenged,
+
+		/**
+		 * \brief The packet was not a hello. Nothing was sent.
+		 */
+		rejected
+	};
+
+	/**
+	 * \brief Stateless cookie exchange which verifies a UDP peer's address before any state is kept for it.
+	 *
+	 * A client sends a hello (\c CookieHandshake::write_hello). The server answers a hello
+	 * without a valid cookie with a challenge carrying a cookie: a keyed SipHash of the
+	 * client's address and the current time slot. The client repeats the hello with that
+	 * cookie, which the server recomputes to accept it. The server stores nothing per
+	 * client until then, so spoofed floods cost it one hash and one small reply per
+	 * datagram. Challenges are never larger than the hello they answer, so the server
+	 * cannot be used to amplify a flood at a spoofed victim.
+	 *
+	 * Cookies stay valid for between one and two lifetimes.
+	 *
+	 * Hello: \c hello_magic (\c uint32_t), cookie (\c uint64_t, \c 0 for none), then any application data.
+	 * Challenge: \c challenge_magic (\c uint32_t), cookie (\c uint64_t).
+	 */
+	class CookieHandshake
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+		using Key   = std::array<uint8_t, 16>;
+
+		static constexpr uint32_t hello_magic     = 0x534C4548; // "HELS"
+		static constexpr uint32_t challenge_magic = 0x4B4F4F43; // "COOK"
+
+		/**
+		 * \brief Default time a cookie is issued for.
+		 */
+		static constexpr std::chrono::seconds default_lifetime { 10 };
+
+	protected:
+		Key             key_ {};
+		clock::duration lifetime_;
+
+		uint64_t accepted_   = 0;
+		uint64_t challenged_ = 0;
+		uint64_t rejected_   = 0;
+
+	public:
+		/**
+		 * \brief Constructs a handshake with a random key.
+		 * \param lifetime Time a cookie is issued for.
+		 */
+		explicit CookieHandshake(clock::duration lifetime = default_lifetime);
+
+		/**
+		 * \brief Constructs a handshake with the given key, e.g. one shared by several servers behind one address.
+		 * \param key Secret key.
+		 * \param lifetime Time a cookie is issued for.
+		 */
+		explicit CookieHandshake(const Key& key, clock::duration lifetime = default_lifetime);
+
+		/**
+		 * \brief Computes the cookie for an address.
+		 * \param address Address of the peer, as received.
+		 * \param now Current time.
+		 */
+		[[nodiscard]] uint64_t cookie(const Address& address, clock::time_point now = clock::now()) const;
+
+		/**
+		 * \brief Checks a cookie echoed by a peer.
+		 * \param address Address of the peer, as received.
+		 * \param cookie Cookie echoed by the peer.
+		 * \param now Current time.
+		 * \return \c true if \p cookie was issued to \p address within the last two time slots.
+		 */
+		[[nodiscard]] bool verify(const Address& address, uint64_t cookie, clock::time_point now = clock::now()) const;
+
+		/**
+		 * \brief Handles a packet from an address the server has no state for.
+		 *
+		 * Accepts a hello with a valid cookie, answers any other hello with a challenge
+		 * and ignores everything else.
+		 *
+		 * \param socket Socket \p packet was received on, used to send the challenge.
+		 * \param packet Packet received, read from its read cursor.
+		 * \param address Address \p packet was received from.
+		 * \return The outcome. Only on \c sws::HandshakeResult::accepted should state be created for \p address
+		 */
+		HandshakeResult admit(UdpSocket& socket, Packet& packet, const Address& address);
+
+		/**
+		 * \brief Replaces the key with a new random one, invalidating every cookie issued so far.
+		 */
+		void rekey();
+
+		/**
+		 * \brief Gets the number of hellos accepted.
+		 */
+		[[nodiscard]] uint64_t accepted() const;
+
+		/**
+		 * \brief Gets the number of challenges sent.
+		 */
+		[[nodiscard]] uint64_t challenged() const;
+
+		/**
+		 * \brief Gets the number of packets rejected for not being a hello.
+		 */
+		[[nodiscard]] uint64_t rejected() const;
+
+		/**
+		 * \brief Writes a hello to a packet, to be followed by any application data.
+		 * \param packet Packet to write to.
+		 * \param cookie Cookie from the server's last challenge, or \c 0 for none.
+		 */
+		static void write_hello(Packet& packet, uint64_t cookie = 0);
+
+		/**
+		 * \brief Reads a challenge sent by the server.
+		 * \param packet Packet received from the server, read from its read cursor.
+		 * \param cookie [out] Cookie to send in the next hello.
+		 * \return \c false if \p packet is not a challenge, in which case its read cursor is unchanged.
+		 */
+		static bool read_challenge(Packet& packet, uint64_t& cookie);
+
+	protected:
+		[[nodiscard]] uint64_t compute(const Address& address, uint64_t slot) const;
+		[[nodiscard]] uint64_t slot(clock::time_point now) const;
+	};
+}
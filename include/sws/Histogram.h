@@ -0,0 +1,196 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace sws
+{
+	/**
+	 * \brief A log-linear (HDR-style) histogram of unsigned values.
+	 *
+	 * Values below 128 are counted exactly. Above that, each power of two is
+	 * split into 64 equal sub-buckets, so any recorded value is reported within
+	 * about 1.6% of its true value across the full 64-bit range.
+	 */
+	class Histogram
+	{
+	public:
+		/**
+		 * \brief Number of bits of precision kept for each value.
+		 */
+		static constexpr size_t precision_bits = 7;
+
+		/**
+		 * \brief Number of buckets needed to cover every 64-bit value.
+		 */
+		static constexpr size_t bucket_count = (64 - precision_bits + 2) << (precision_bits - 1);
+
+	protected:
+		std::vector<uint64_t> counts_;
+
+		uint64_t total_ = 0;
+		uint64_t sum_   = 0;
+		uint64_t min_   = UINT64_MAX;
+		uint64_t max_   = 0;
+
+		friend class LatencyRecorder;
+
+	public:
+		Histogram();
+
+		/**
+		 * \brief Records a value.
+		 * \param value Value to record.
+		 * \param count Number of times to record \p value
+		 */
+		void record(uint64_t value, uint64_t count = 1);
+
+		/**
+		 * \brief Adds every value recorded in \p rhs to this histogram.
+		 */
+		Histogram& operator+=(const Histogram& rhs);
+
+		/**
+		 * \brief Removes all recorded values.
+		 */
+		void reset();
+
+		/**
+		 * \brief Gets the number of recorded values.
+		 */
+		[[nodiscard]] uint64_t count() const;
+
+		/**
+		 * \brief Checks if no values have been recorded.
+		 */
+		[[nodiscard]] bool empty() const;
+
+		/**
+		 * \brief Gets the smallest recorded value, or \c 0 if empty.
+		 */
+		[[nodiscard]] uint64_t min() const;
+
+		/**
+		 * \brief Gets the largest recorded value, or \c 0 if empty.
+		 */
+		[[nodiscard]] uint64_t max() const;
+
+		/**
+		 * \brief Gets the mean of the recorded values, or \c 0 if empty.
+		 */
+		[[nodiscard]] double mean() const;
+
+		/**
+		 * \brief Gets the value below which a given percentage of recorded values fall.
+		 * \param percentile Percentage in [0, 100], e.g. \c 99.9
+		 * \return The highest value equivalent to the bucket containing the percentile,
+		 * clamped to \c Histogram::max, or \c 0 if empty.
+		 */
+		[[nodiscard]] uint64_t percentile(double percentile) const;
+
+		/**
+		 * \brief Gets the index of the bucket counting \p value
+		 */
+		[[nodiscard]] static size_t bucket_index(uint64_t value);
+
+		/**
+		 * \brief Gets the smallest value counted by a bucket.
+		 */
+		[[nodiscard]] static uint64_t bucket_lowest(size_t index);
+
+		/**
+		 * \brief Gets the largest value counted by a bucket.
+		 */
+		[[nodiscard]] static uint64_t bucket_highest(size_t index);
+	};
+
+	/**
+	 * \brief Latencies recorded by the library, in nanoseconds.
+	 */
+	enum class LatencyMetric : uint8_t
+	{
+		/** Time spent in \c sws::Socket::send(Packet&) and \c sws::UdpSocket::send_to(const Packet&, const Address&) */
+		send_call,
+		/** Time spent in \c sws::Socket::receive(Packet&) and \c sws::UdpSocket::receive_from(Packet&, Address&) */
+		receive_call,
+		/** Time from the first attempt to send a stream \c sws::Packet until all of it was sent. */
+		send_queue,
+		/** Round trips reported through \c sws::record_round_trip */
+		round_trip,
+
+		count
+	};
+
+	inline constexpr size_t latency_metric_count = static_cast<size_t>(LatencyMetric::count);
+
+	/**
+	 * \brief Records latencies into per-thread shards and merges them on demand.
+	 * Recording is lock-free; only snapshots take a lock. A thread's shard is only
+	 * created once it records, and is folded into a shared total when the thread exits.
+	 */
+	class LatencyRecorder
+	{
+	public:
+		/**
+		 * \brief Records a latency on the calling thread's shard.
+		 * \param metric Metric to record into.
+		 * \param nanoseconds Latency to record.
+		 */
+		static void record(LatencyMetric metric, uint64_t nanoseconds);
+
+		/**
+		 * \brief Merges every thread's recordings of a metric.
+		 */
+		[[nodiscard]] static Histogram snapshot(LatencyMetric metric);
+
+		/**
+		 * \brief Checks if the library records latencies. Enabled by default.
+		 */
+		[[nodiscard]] static bool enabled();
+
+		/**
+		 * \brief Enables or disables latency recording by the library.
+		 * \remark This method is thread-safe.
+		 */
+		static void enabled(bool value);
+	};
+
+	/**
+	 * \brief Records the time between its construction and destruction into a latency metric.
+	 * Does nothing if \c LatencyRecorder::enabled was \c false on construction.
+	 */
+	class LatencyTimer
+	{
+		LatencyMetric metric_;
+		uint64_t      start_;
+
+	public:
+		explicit LatencyTimer(LatencyMetric metric);
+		~LatencyTimer();
+
+		LatencyTimer(const LatencyTimer&) = delete;
+		LatencyTimer& operator=(const LatencyTimer&) = delete;
+	};
+
+	/**
+	 * \brief Gets a monotonic timestamp in nanoseconds, suitable for writing into a \c sws::Packet
+	 * \remark Only comparable with timestamps taken on the same machine.
+	 */
+	[[nodiscard]] uint64_t timestamp_now();
+
+	/**
+	 * \brief Records a round trip into \c LatencyMetric::round_trip
+	 * \param sent Value of \c sws::timestamp_now when the request was sent,
+	 * typically echoed back by the peer.
+	 *
+	 * \code
+	 * request << sws::timestamp_now();
+	 * // ...peer echoes the timestamp back in its response...
+	 * uint64_t sent;
+	 * response >> sent;
+	 * sws::record_round_trip(sent);
+	 * \endcode
+	 */
+	void record_round_trip(uint64_t sent);
+}
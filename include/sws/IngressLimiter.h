@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "Address.h"
+
+namespace sws
+{
+	/**
+	 * \brief Rates incoming traffic is limited to. A rate of \c 0 is unlimited.
+	 */
+	struct IngressLimits
+	{
+		double packets_per_second = 0.0;
+
+		/**
+		 * \brief Packets that may arrive at once. \c 0 allows one second's worth.
+		 */
+		double packet_burst = 0.0;
+
+		double bytes_per_second = 0.0;
+
+		/**
+		 * \brief Bytes that may arrive at once. \c 0 allows one second's worth.
+		 */
+		double byte_burst = 0.0;
+	};
+
+	/**
+	 * \brief Token buckets of one peer, compact enough to keep in each entry of a peer or connection table.
+	 * A zero-initialized state is a pair of full buckets.
+	 */
+	struct IngressState
+	{
+		float    packets = 0.0f;
+		float    bytes   = 0.0f;
+		uint64_t last    = 0;
+	};
+
+	/**
+	 * \brief Drops incoming packets beyond per-peer and global rates, so that one peer
+	 * cannot starve the others sharing an I/O thread.
+	 *
+	 * Each peer and the limiter as a whole have a packet bucket and a byte bucket,
+	 * refilled continuously as with \c sws::TokenBucket, but sharing their limits so that
+	 * the state of a peer takes 16 bytes. A packet is admitted only if all four buckets allow
+	 * it, and only then are tokens taken. Checks are O(1) and never allocate.
+	 *
+	 * Peers can be tracked either by keeping an \c sws::IngressState in each entry of a
+	 * peer table, or by address in a fixed-size table owned by the limiter. In the latter,
+	 * peers whose addresses hash to the same entry share one set of buckets, so the table
+	 * should be several times larger than the number of peers expected. A flood from many
+	 * spoofed addresses spreads over the whole table; the global limit contains it.
+	 *
+	 * \remark Thread-safe: the global buckets and the address table are guarded by a lock,
+	 * so one limiter may be shared by sockets on several threads, such as the connections
+	 * of a \c sws::TcpServer. Each \c sws::IngressState must only be used by one thread at a time.
+	 * \see Socket::ingress_limiter
+	 */
+	class IngressLimiter
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		/**
+		 * \brief Default number of entries in the table of peers tracked by address.
+		 */
+		static constexpr size_t default_table_size = 4096;
+
+	protected:
+		IngressLimits peer_limits_;
+		IngressLimits global_limits_;
+
+		// Guards global_ and table_.
+		std::mutex   mutex_;
+		IngressState global_ {};
+
+		std::vector<IngressState> table_;
+		size_t                    mask_ = 0;
+
+		std::atomic<uint64_t> dropped_packets_ { 0 };
+		std::atomic<uint64_t> dropped_bytes_ { 0 };
+
+	public:
+		/**
+		 * \brief Constructs a limiter.
+		 * \param peer_limits Limits of each peer.
+		 * \param global_limits Limits of all peers together.
+		 * \param table_size Number of entries in the table of peers tracked by address, rounded up to a power of two.
+		 * \throws std::logic_error if a limit is negative.
+		 */
+		explicit IngressLimiter(const IngressLimits& peer_limits, const IngressLimits& global_limits = {},
+		                        size_t table_size = default_table_size);
+
+		IngressLimiter(const IngressLimiter&) = delete;
+		IngressLimiter& operator=(const IngressLimiter&) = delete;
+
+		/**
+		 * \brief Checks if a packet from a peer is within limits, taking tokens if it is.
+		 * \param peer State of the peer, e.g. from an entry of a peer table.
+		 * \param bytes Size of the packet.
+		 * \param now Current time.
+		 * \return \c false if the packet should be dropped.
+		 */
+		bool admit(IngressState& peer, size_t bytes, clock::time_point now = clock::now());
+
+		/**
+		 * \brief Checks if a packet from an address is within limits, taking tokens if it is.
+		 * The state of the peer is kept in the limiter's table.
+		 * \param address Address the packet was received from.
+		 * \param bytes Size of the packet.
+		 * \param now Current time.
+		 * \return \c false if the packet should be dropped.
+		 */
+		bool admit(const Address& address, size_t bytes, clock::time_point now = clock::now());
+
+		/**
+		 * \brief Gets the limits of each peer.
+		 */
+		[[nodiscard]] const IngressLimits& peer_limits() const;
+
+		/**
+		 * \brief Gets the limits of all peers together.
+		 */
+		[[nodiscard]] const IngressLimits& global_limits() const;
+
+		/**
+		 * \brief Gets the number of packets dropped.
+		 */
+		[[nodiscard]] uint64_t dropped_packets() const;
+
+		/**
+		 * \brief Gets the number of bytes dropped.
+		 */
+		[[nodiscard]] uint64_t dropped_bytes() const;
+
+		/**
+		 * \brief Refills every bucket and resets the drop counters.
+		 * States kept outside the limiter are left as they are.
+		 */
+		void reset();
+
+	protected:
+		// Checks the peer without the lock, then takes `lock` if needed for the global buckets.
+		bool admit(IngressState& peer, size_t bytes, clock::time_point now, std::unique_lock<std::mutex>& lock);
+	};
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Address.h"
+#include "TokenBucket.h"
+#include "UdpSocket.h"
+
+namespace sws
+{
+	/**
+	 * \brief Defines the distribution used to pick the latency of each datagram.
+	 */
+	enum class LatencyDistribution
+	{
+		/**
+		 * \brief Every datagram is delayed by exactly \c LinkConditions::latency
+		 */
+		constant,
+
+		/**
+		 * \brief Uniformly distributed in \c latency +/- \c jitter
+		 */
+		uniform,
+
+		/**
+		 * \brief Normally distributed around \c latency with a standard deviation of \c jitter
+		 */
+		normal,
+
+		/**
+		 * \brief \c latency plus a heavy (Pareto) tail scaled by \c jitter
+		 */
+		pareto
+	};
+
+	/**
+	 * \brief Defines the direction of a simulated link.
+	 */
+	enum class LinkDirection
+	{
+		/**
+		 * \brief Traffic from clients to the target address.
+		 */
+		upstream,
+
+		/**
+		 * \brief Traffic from the target address back to clients.
+		 */
+		downstream
+	};
+
+	/**
+	 * \brief Network conditions applied to one direction of a simulated link.
+	 */
+	struct LinkConditions
+	{
+		/**
+		 * \brief Base one-way latency.
+		 */
+		std::chrono::microseconds latency {};
+
+		/**
+		 * \brief Latency variation. Its meaning depends on \c distribution
+		 */
+		std::chrono::microseconds jitter {};
+
+		LatencyDistribution distribution = LatencyDistribution::uniform;
+
+		/**
+		 * \brief Probability [0, 1] that a datagram is dropped.
+		 */
+		double loss = 0.0;
+
+		/**
+		 * \brief Probability [0, 1] that a datagram is delivered twice.
+		 */
+		double duplication = 0.0;
+
+		/**
+		 * \brief Probability [0, 1] that a datagram skips the latency queue,
+		 * overtaking datagrams that are still delayed.
+		 */
+		double reordering = 0.0;
+
+		/**
+		 * \brief Bandwidth cap in bytes per second. \c 0 for unlimited.
+		 */
+		double bandwidth = 0.0;
+
+		/**
+		 * \brief Token bucket size in bytes used with \c bandwidth
+		 */
+		size_t burst = Socket::datagram_size;
+
+		/**
+		 * \brief Maximum number of bytes waiting for bandwidth before datagrams are tail-dropped.
+		 */
+		size_t queue_limit = 1024 * 1024;
+	};
+
+	/**
+	 * \brief Counters for one direction of a simulated link.
+	 */
+	struct LinkStatistics
+	{
+		uint64_t received   = 0;
+		uint64_t forwarded  = 0;
+		uint64_t lost       = 0;
+		uint64_t duplicated = 0;
+		uint64_t reordered  = 0;
+		uint64_t overflowed = 0;
+	};
+
+	/**
+	 * \brief A local UDP proxy which forwards datagrams between clients and a
+	 * target address while injecting latency, loss, duplication, reordering
+	 * and bandwidth limits. Intended for loopback testing and benchmarking.
+	 *
+	 * Clients send to \c NetworkSimulator::local_address instead of the target.
+	 * Each client is given its own upstream socket so that replies from the
+	 * target can be routed back to the right client.
+	 *
+	 * \remark The simulator is driven by \c NetworkSimulator::update and never blocks.
+	 */
+	class NetworkSimulator
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+	protected:
+		struct Datagram
+		{
+			clock::time_point    release;
+			uint64_t             sequence = 0;
+			Address              client;
+			std::vector<uint8_t> data;
+
+			bool operator>(const Datagram& other) const;
+		};
+
+		struct Link
+		{
+			LinkConditions conditions;
+			LinkStatistics statistics;
+			TokenBucket    bucket;
+
+			std::priority_queue<Datagram, std::vector<Datagram>, std::greater<>> delayed;
+			std::deque<Datagram> throttled;
+			size_t throttled_bytes = 0;
+		};
+
+		UdpSocket listener_;
+		Address   target_;
+
+		std::unordered_map<Address, std::unique_ptr<UdpSocket>> upstream_sockets_;
+
+		Link upstream_;
+		Link downstream_;
+
+		std::mt19937_64 random_;
+		uint64_t        sequence_ = 0;
+
+		std::unique_ptr<std::array<uint8_t, Socket::datagram_size>> buffer_;
+
+	public:
+		/**
+		 * \brief Constructs a network simulator.
+		 * \param listen_address Local address clients should send to.
+		 * \param target_address Address datagrams are forwarded to.
+		 * \param seed Seed for the random number generator used for all simulated conditions.
+		 */
+		NetworkSimulator(const Address& listen_address, Address target_address, uint64_t seed = 0);
+
+		NetworkSimulator(const NetworkSimulator&) = delete;
+		NetworkSimulator& operator=(const NetworkSimulator&) = delete;
+
+		/**
+		 * \brief Gets the conditions applied to a direction of the link.
+		 */
+		[[nodiscard]] const LinkConditions& conditions(LinkDirection direction) const;
+
+		/**
+		 * \brief Sets the conditions applied to a direction of the link.
+		 * \param direction Direction of the link to configure.
+		 * \param conditions Conditions to apply.
+		 */
+		void conditions(LinkDirection direction, const LinkConditions& conditions);
+
+		/**
+		 * \brief Sets the conditions applied to both directions of the link.
+		 * \param conditions Conditions to apply.
+		 */
+		void conditions(const LinkConditions& conditions);
+
+		/**
+		 * \brief Gets the counters of a direction of the link.
+		 */
+		[[nodiscard]] const LinkStatistics& statistics(LinkDirection direction) const;
+
+		/**
+		 * \brief Gets the local address clients should send to.
+		 */
+		[[nodiscard]] const Address& local_address() const;
+
+		/**
+		 * \brief Receives all pending datagrams and forwards every datagram that is due.
+		 * \return \c sws::SocketState::done on success.
+		 */
+		SocketState update();
+
+		/**
+		 * \brief Gets the time at which the next queued datagram is due,
+		 * or \c clock::time_point::max() if nothing is queued.
+		 * \remark This is useful for sleeping between calls to \c NetworkSimulator::update
+		 */
+		[[nodiscard]] clock::time_point next_event() const;
+
+	protected:
+		Link& get_link(LinkDirection direction);
+		[[nodiscard]] const Link& get_link(LinkDirection direction) const;
+
+		UdpSocket& get_upstream_socket(const Address& client);
+
+		SocketState receive_upstream(clock::time_point now);
+		SocketState receive_downstream(clock::time_point now);
+
+		void enqueue(Link& link, const Address& client, const uint8_t* data, size_t length, clock::time_point now);
+		void forward(Link& link, LinkDirection direction, clock::time_point now);
+		void transmit(LinkDirection direction, const Datagram& datagram);
+
+		clock::duration pick_latency(const LinkConditions& conditions);
+		bool chance(double probability);
+	};
+}
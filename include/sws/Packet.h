@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "enforce.h"
+#include "PacketBuffer.h"
 #include "typedefs.h"
 
 // TODO: document <</>> operators
@@ -62,9 +63,14 @@ namespace sws
 	class Packet
 	{
 		friend class Socket;
+		friend class Compressor;
+		friend class SharedPacket;
+
+		friend bool delta_encode(const Packet& baseline, const Packet& current, Packet& delta);
+		friend bool delta_apply(const Packet& baseline, Packet& delta, Packet& result);
 
 	protected:
-		std::vector<uint8_t> data_;
+		PacketBuffer data_;
 
 		ptrdiff_t read_pos_  = sizeof(packetlen_t);
 		ptrdiff_t write_pos_ = sizeof(packetlen_t);
@@ -73,6 +79,9 @@ namespace sws
 		ptrdiff_t recv_pos_    = -1;
 		ptrdiff_t recv_target_ = -1;
 
+		// sws::timestamp_now() of the first attempt to send this packet, if latencies are recorded
+		uint64_t send_start_ = 0;
+
 	public:
 		Packet();
 		/**
@@ -382,6 +391,7 @@ namespace sws
 		/**
 		 * \brief Resizes the internal buffer.
 		 * \param size New size in bytes.
+		 * \remark Bytes added by growing the buffer are left uninitialized.
 		 */
 		void resize(size_t size);
 
@@ -390,7 +400,10 @@ namespace sws
 		 */
 		void shrink_to_fit();
 
-		[[nodiscard]] const std::vector<uint8_t>& data() const;
+		/**
+		 * \brief Gets the whole buffer, including the size header.
+		 */
+		[[nodiscard]] const PacketBuffer& data() const;
 
 	protected:
 		void update_size();
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace sws
+{
+	/**
+	 * \brief Byte storage for \c sws::Packet
+	 *
+	 * Buffers of up to \c inline_capacity bytes are stored inside the object,
+	 * so small packets never touch the heap. Unlike \c std::vector, growing the
+	 * buffer leaves the new bytes uninitialized; callers are expected to
+	 * overwrite them (e.g. with written or received data).
+	 */
+	class PacketBuffer
+	{
+	public:
+		/**
+		 * \brief Number of bytes stored without a heap allocation.
+		 */
+		static constexpr size_t inline_capacity = 128;
+
+	protected:
+		std::array<uint8_t, inline_capacity> inline_;
+		std::unique_ptr<uint8_t[]>           heap_;
+
+		// Points at either inline_ or heap_, so that element access does not branch.
+		uint8_t* data_ = inline_.data();
+
+		size_t size_     = 0;
+		size_t capacity_ = inline_capacity;
+
+	public:
+		PacketBuffer() = default;
+		PacketBuffer(const PacketBuffer& other);
+		PacketBuffer(PacketBuffer&& other) noexcept;
+		~PacketBuffer() = default;
+
+		PacketBuffer& operator=(const PacketBuffer& other);
+		PacketBuffer& operator=(PacketBuffer&& other) noexcept;
+
+		[[nodiscard]] uint8_t* data();
+		[[nodiscard]] const uint8_t* data() const;
+
+		[[nodiscard]] size_t size() const;
+		[[nodiscard]] size_t capacity() const;
+		[[nodiscard]] bool empty() const;
+
+		/**
+		 * \brief Checks if the buffer is stored inside the object rather than on the heap.
+		 */
+		[[nodiscard]] bool is_inline() const;
+
+		[[nodiscard]] uint8_t* begin();
+		[[nodiscard]] const uint8_t* begin() const;
+		[[nodiscard]] uint8_t* end();
+		[[nodiscard]] const uint8_t* end() const;
+
+		[[nodiscard]] uint8_t& operator[](size_t index);
+		[[nodiscard]] const uint8_t& operator[](size_t index) const;
+
+		/**
+		 * \brief Gets a byte with bounds checking.
+		 * \throws std::out_of_range if \p index is not less than \c size()
+		 */
+		[[nodiscard]] const uint8_t& at(size_t index) const;
+
+		/**
+		 * \brief Ensures the buffer can hold \p capacity bytes without reallocating.
+		 */
+		void reserve(size_t capacity);
+
+		/**
+		 * \brief Resizes the buffer. Bytes beyond the old size are left uninitialized.
+		 * \param size New size in bytes.
+		 */
+		void resize(size_t size);
+
+		void clear();
+
+		/**
+		 * \brief Releases unused heap capacity, moving the buffer inline if it fits.
+		 */
+		void shrink_to_fit();
+
+		void swap(PacketBuffer& other) noexcept;
+
+		operator std::span<const uint8_t>() const;
+
+	protected:
+		void reallocate(size_t capacity);
+		void grow(size_t size);
+	};
+
+	// Element access is on every Packet read and write, so it is kept inline.
+
+	inline uint8_t* PacketBuffer::data()
+	{
+		return data_;
+	}
+
+	inline const uint8_t* PacketBuffer::data() const
+	{
+		return data_;
+	}
+
+	inline size_t PacketBuffer::size() const
+	{
+		return size_;
+	}
+
+	inline size_t PacketBuffer::capacity() const
+	{
+		return capacity_;
+	}
+
+	inline bool PacketBuffer::empty() const
+	{
+		return !size_;
+	}
+
+	inline uint8_t* PacketBuffer::begin()
+	{
+		return data_;
+	}
+
+	inline const uint8_t* PacketBuffer::begin() const
+	{
+		return data_;
+	}
+
+	inline uint8_t* PacketBuffer::end()
+	{
+		return data_ + size_;
+	}
+
+	inline const uint8_t* PacketBuffer::end() const
+	{
+		return data_ + size_;
+	}
+
+	inline uint8_t& PacketBuffer::operator[](size_t index)
+	{
+		return data_[index];
+	}
+
+	inline const uint8_t& PacketBuffer::operator[](size_t index) const
+	{
+		return data_[index];
+	}
+
+	inline void PacketBuffer::resize(size_t size)
+	{
+		if (size > capacity_)
+		{
+			grow(size);
+		}
+
+		size_ = size;
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <WinSock2.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Capture.h"
+#include "ConcurrentQueue.h"
+
+namespace sws
+{
+	/**
+	 * \brief Writes captured traffic as pcapng, for opening in standard packet analyzers.
+	 *
+	 * Every captured \c sws::Packet becomes a raw IP packet with synthesized IPv4 or IPv6
+	 * and UDP or TCP headers built from the socket's local and remote addresses. TCP
+	 * sequence and acknowledgement numbers are tracked per connection, so analyzers can
+	 * follow the streams. No privileges or packet capture drivers are needed.
+	 *
+	 * Capturing only copies the packet and its addresses into a preallocated lock-free
+	 * ring buffer, without allocating. A background thread formats the buffered packets
+	 * and writes them out in large blocks.
+	 *
+	 * \code
+	 * sws::PcapWriter pcap("shard.pcapng", 256 * 1024 * 1024);
+	 * socket.capture(&pcap);
+	 * \endcode
+	 *
+	 * \see sws::Socket::capture
+	 */
+	class PcapWriter : public CaptureSink
+	{
+	public:
+		/**
+		 * \brief Default size in bytes of the buffer packets wait in for the background thread.
+		 */
+		static constexpr size_t default_buffer_size = 16 * 1024 * 1024;
+
+		/**
+		 * \brief Size of the blocks written to the file.
+		 */
+		static constexpr size_t block_size = 1024 * 1024;
+
+	protected:
+		// A packet read back from the buffer by the background thread.
+		struct Entry
+		{
+			uint64_t                 time      = 0;
+			Protocol                 protocol  = {};
+			CaptureDirection         direction = CaptureDirection::sent;
+			sockaddr_storage         local     = {};
+			sockaddr_storage         remote    = {};
+			std::span<const uint8_t> data;
+		};
+
+		std::filesystem::path path_;
+		uint64_t              rotate_size_ = 0;
+
+		// Records are reserved by advancing tail_ and released by advancing head_,
+		// as with sws::CaptureLog; the size of a record is written last to commit it.
+		std::unique_ptr<uint64_t[]> buffer_;
+		size_t                      buffer_size_ = 0;
+
+		alignas(cache_line_size) std::atomic<uint64_t> tail_ = 0;
+		alignas(cache_line_size) std::atomic<uint64_t> head_ = 0;
+
+		alignas(cache_line_size) std::atomic<uint64_t> dropped_ = 0;
+		std::atomic<bool> stop_ = false;
+
+		// Owned by the background thread.
+		std::ofstream        file_;
+		std::vector<uint8_t> block_;
+		std::vector<uint8_t> scratch_;
+		uint64_t             file_size_ = 0;
+		uint16_t             ip_id_     = 0;
+
+		// Next TCP sequence number of each direction of each connection.
+		std::unordered_map<std::string, uint32_t> sequences_;
+
+		std::atomic<size_t> file_index_ = 0;
+
+		std::thread thread_;
+
+	public:
+		/**
+		 * \brief Creates a pcapng file and starts the background writer.
+		 * \param path Path of the file. Rotated files are numbered, e.g. \c traffic.1.pcapng
+		 * \param rotate_size Maximum size of each file in bytes; a new file is started before it would be exceeded. \c 0 never rotates.
+		 * \param buffer_size Bytes of packets which can wait for the background thread before packets are dropped.
+		 * Rounded up to a power of two, and to at least enough for a few of the largest packets.
+		 * \throws std::system_error if the file cannot be created.
+		 */
+		explicit PcapWriter(std::filesystem::path path, uint64_t rotate_size = 0, size_t buffer_size = default_buffer_size);
+
+		PcapWriter(const PcapWriter&) = delete;
+		PcapWriter(PcapWriter&&) = delete;
+
+		/**
+		 * \brief Writes out every buffered packet and closes the file.
+		 */
+		~PcapWriter() override;
+
+		PcapWriter& operator=(const PcapWriter&) = delete;
+		PcapWriter& operator=(PcapWriter&&) = delete;
+
+		/**
+		 * \brief Buffers a packet captured by a socket.
+		 * \return \c false if the buffer was full and the packet was dropped.
+		 * \remark This method is thread-safe and lock-free, and does not allocate.
+		 */
+		bool capture(Protocol protocol, CaptureDirection direction, const Address& local, const Address& remote,
+		             std::span<const uint8_t> data) noexcept override;
+
+		/**
+		 * \brief Writes out every buffered packet, stops the background thread and closes the file.
+		 * \remark Sockets must have stopped capturing into this writer.
+		 */
+		void close();
+
+		/**
+		 * \brief Gets the number of packets dropped because the buffer was full.
+		 */
+		[[nodiscard]] uint64_t dropped() const;
+
+		/**
+		 * \brief Gets the path of the file being written, which changes on rotation.
+		 */
+		[[nodiscard]] std::filesystem::path current_path() const;
+
+	protected:
+		[[nodiscard]] uint8_t* buffer() const;
+
+		void run();
+		bool next(Entry& entry, uint64_t& head);
+		void open(size_t index);
+		void write(const Entry& entry);
+		void write_block();
+	};
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+
+#include "PacketBuffer.h"
+
+namespace sws
+{
+	class Packet;
+
+	/**
+	 * \brief An immutable, reference-counted \c sws::Packet payload.
+	 *
+	 * Sealing a packet moves its buffer into shared storage once; copies of the
+	 * \c SharedPacket only share that buffer. Unlike \c sws::Packet, it holds no send
+	 * progress, so the same instance can be passed to \c Socket::send(const SharedPacket&)
+	 * on any number of sockets. The buffer is freed when the last socket has sent it
+	 * and the last copy is destroyed.
+	 */
+	class SharedPacket
+	{
+	protected:
+		std::shared_ptr<const PacketBuffer> buffer_;
+
+	public:
+		/**
+		 * \brief Constructs an empty shared packet.
+		 */
+		SharedPacket() = default;
+
+		/**
+		 * \brief Seals a packet, taking over its buffer without copying it.
+		 * \param packet Packet to seal. It is left cleared.
+		 */
+		explicit SharedPacket(Packet&& packet);
+
+		/**
+		 * \brief Seals a copy of a packet.
+		 * \param packet Packet to copy.
+		 */
+		explicit SharedPacket(const Packet& packet);
+
+		/**
+		 * \brief Gets the whole packet, including the size header.
+		 */
+		[[nodiscard]] std::span<const uint8_t> data() const;
+
+		/**
+		 * \brief Gets the size of the packet in bytes, including the size header.
+		 */
+		[[nodiscard]] size_t size() const;
+
+		/**
+		 * \brief Checks if the packet has no payload.
+		 */
+		[[nodiscard]] bool empty() const;
+
+		/**
+		 * \brief Gets the number of \c SharedPacket instances (including those queued on sockets) sharing the buffer.
+		 */
+		[[nodiscard]] long use_count() const;
+	};
+}
@@ -2,15 +2,23 @@
 #include <WinSock2.h>
 
 #include <array>
+#include <deque>
 #include <memory>
 #include <span>
+#include <vector>
 
 #include "typedefs.h"
 #include "Address.h"
+#include "Capture.h"
+#include "IngressLimiter.h"
+#include "SharedPacket.h"
 #include "SocketError.h"
+#include "SocketOptions.h"
+#include "Statistics.h"
 
 namespace sws
 {
+	class EventLoop;
 	class Packet;
 	using NativeSocket = SOCKET;
 
@@ -26,6 +34,12 @@ namespace sws
 
 	class Socket
 	{
+		friend class EventLoop;
+		friend class ConnectAwaiter;
+
+		template <typename>
+		friend class AsyncOperation;
+
 		static bool is_initialized_;
 
 	public:
@@ -46,6 +60,16 @@ namespace sws
 		 */
 		static constexpr size_t datagram_size = 65536;
 
+		/**
+		 * \brief Size of the CRC32C trailer added to datagrams by \c UdpSocket::checksum
+		 */
+		static constexpr size_t checksum_size = sizeof(uint32_t);
+
+		/**
+		 * \brief Default limit of bytes awaiting completion with \c Socket::zero_copy
+		 */
+		static constexpr size_t default_zero_copy_in_flight = 8 * 1024 * 1024;
+
 	protected:
 		NativeSocket socket_ = INVALID_SOCKET;
 
@@ -55,10 +79,61 @@ namespace sws
 		bool     blocking_       = true;
 		bool     connected_      = false;
 
+		SocketOptions options_;
+
 		SocketError native_error_ = SocketError::none;
 
 		std::unique_ptr<std::array<uint8_t, datagram_size>> datagram_;
 
+		// Whether datagrams carry a CRC32C trailer; see UdpSocket::checksum.
+		bool checksum_ = false;
+
+		// Updated by the const raw send/receive methods.
+		mutable SocketStatistics statistics_;
+
+		CaptureSink* capture_ = nullptr;
+
+		IngressLimiter* ingress_limiter_ = nullptr;
+
+		// Buckets of the connection for a TCP socket's ingress limiter; UDP peers are tracked by the limiter.
+		IngressState ingress_ {};
+
+		/**
+		 * \brief Packets coalesced by \c Socket::auto_cork
+		 * Kept on the heap so that an \c sws::EventLoop can refer to it while the socket is moved.
+		 */
+		struct Cork
+		{
+			Socket*              owner     = nullptr;
+			EventLoop*           loop      = nullptr;
+			std::vector<uint8_t> buffer;
+			size_t               position  = 0;
+			size_t               threshold = 0;
+			uint64_t             start     = 0;
+			bool                 scheduled = false;
+
+			[[nodiscard]] size_t pending() const;
+		};
+
+		std::unique_ptr<Cork> cork_;
+
+		// Overlapped sends awaiting completion; defined in Socket.cpp.
+		struct ZeroCopy;
+		std::unique_ptr<ZeroCopy> zero_copy_;
+
+		/**
+		 * \brief A \c sws::SharedPacket waiting to be sent, and how much of it has been.
+		 */
+		struct QueuedSend
+		{
+			SharedPacket packet;
+			size_t       position = 0;
+			uint64_t     start    = 0;
+		};
+
+		std::deque<QueuedSend> send_queue_;
+		size_t                 queued_bytes_ = 0;
+
 		/**
 		 * \brief Construct a socket.
 		 * \param protocol The protocol of the socket.
@@ -176,6 +251,30 @@ namespace sws
 		 */
 		SocketState send(Packet& packet);
 
+		/**
+		 * \brief Sends a shared packet to a connected peer without copying it.
+		 *
+		 * The socket keeps its own reference to \p packet and tracks its progress, so
+		 * the same \c sws::SharedPacket can be sent on any number of sockets. Whatever
+		 * cannot be sent immediately is queued, and sent by later calls to this method,
+		 * \c Socket::send(Packet&) or \c Socket::flush, in order.
+		 *
+		 * \param packet Packet to send.
+		 * \return \c sws::SocketState::done if the packet and everything queued before it was sent.
+		 * \c sws::SocketState::in_progress if the packet was queued because the socket would block;
+		 * unlike with \c sws::Packet, do not send it again.
+		 * \remark Packets buffered by auto-corking are flushed first. On errors other than
+		 * would-block, the queue is discarded. As with any stream send, do not call this
+		 * while a \c sws::Packet is partially sent.
+		 */
+		SocketState send(const SharedPacket& packet);
+
+		/**
+		 * \brief Gets the number of bytes of queued shared packets not yet sent.
+		 * \see Socket::send(const SharedPacket&)
+		 */
+		[[nodiscard]] size_t queued_bytes() const;
+
 		/**
 		 * \brief Receives a \c sws::Packet from a connected peer.
 		 * \param packet \c sws::Packet to receive into.
@@ -186,8 +285,109 @@ namespace sws
 		 */
 		SocketState receive(Packet& packet);
 
+		/**
+		 * \brief Gets the auto-cork threshold in bytes, or \c 0 if auto-corking is disabled.
+		 */
+		[[nodiscard]] size_t auto_cork() const;
+
+		/**
+		 * \brief Enables or disables auto-corking of a TCP socket.
+		 *
+		 * While enabled, \c Socket::send(Packet&) copies packets into a per-socket buffer
+		 * instead of sending them. The buffer is sent in one native call when it reaches
+		 * \p threshold bytes, when \c Socket::flush is called, or at the end of the
+		 * current iteration of \p loop. This batches small writes like Nagle's algorithm
+		 * does, without waiting for acknowledgements, so it is best combined with
+		 * \c SocketOptions::no_delay
+		 *
+		 * \param threshold Number of buffered bytes which triggers a flush. \c 0 disables auto-corking.
+		 * \param loop Event loop which flushes the buffer at the end of each iteration.
+		 * May be \c nullptr, in which case \c Socket::flush must be called manually.
+		 * \return \c sws::SocketState::done on success. Disabling flushes the buffer first,
+		 * and returns its state if it could not be flushed completely.
+		 * \remark \p loop must outlive this socket while auto-corking is enabled.
+		 * If the buffer still holds \p threshold bytes which could not be sent,
+		 * \c Socket::send(Packet&) returns \c sws::SocketState::in_progress without taking the packet.
+		 */
+		SocketState auto_cork(size_t threshold, EventLoop* loop = nullptr);
+
+		/**
+		 * \brief Sends any packets buffered by auto-corking, then any queued shared packets.
+		 * \return \c sws::SocketState::done once both are empty,
+		 * \c sws::SocketState::in_progress if some of them are still waiting to be sent.
+		 */
+		SocketState flush();
+
+		/**
+		 * \brief Gets the zero-copy threshold in bytes, or \c 0 if zero-copy sends are disabled.
+		 */
+		[[nodiscard]] size_t zero_copy() const;
+
+		/**
+		 * \brief Enables or disables zero-copy sends on a TCP socket.
+		 *
+		 * While enabled, \c Socket::send(Packet&) hands packets of at least \p threshold
+		 * bytes to an overlapped send, and the send buffer size is set to \c 0 so that the
+		 * network stack transmits straight out of the packet's memory instead of copying it.
+		 * The packet's buffer is taken over, leaving the packet cleared, and is kept alive
+		 * until the stack reports the send as complete. Smaller packets are copied as usual.
+		 *
+		 * \param threshold Minimum size of packets sent without copying. \c 0 disables zero-copy sends.
+		 * \param max_in_flight Number of bytes awaiting completion above which
+		 * \c Socket::send(Packet&) returns \c sws::SocketState::in_progress
+		 * \return \c sws::SocketState::done on success. Disabling returns
+		 * \c sws::SocketState::in_progress while sends are still awaiting completion.
+		 * \remark Copying is cheaper than pinning memory for small buffers; a threshold
+		 * in the tens of kilobytes is a reasonable start. The previous send buffer size is
+		 * restored when disabled, and accepted sockets do not inherit the change.
+		 * \c Socket::close waits up to a second for pending sends to complete, then cancels them.
+		 */
+		SocketState zero_copy(size_t threshold, size_t max_in_flight = default_zero_copy_in_flight);
+
+		/**
+		 * \brief Releases the buffers of completed zero-copy sends.
+		 * \return Number of bytes still awaiting completion.
+		 */
+		size_t zero_copy_pending();
+
+		/**
+		 * \brief Gets the sink this socket's packets are captured into, or \c nullptr if none.
+		 */
+		[[nodiscard]] CaptureSink* capture() const;
+
+		/**
+		 * \brief Captures every \c sws::Packet sent and received by this socket into a sink,
+		 * such as a \c sws::CaptureLog or a \c sws::PcapWriter
+		 * Sockets accepted by a capturing TCP socket capture into the same sink.
+		 * \param sink Sink to capture into, or \c nullptr to stop capturing.
+		 * The sink must outlive the socket, or be detached from it first.
+		 * \remark Packets are captured when they have been fully sent or received,
+		 * or handed to auto-corking or a zero-copy send.
+		 */
+		void capture(CaptureSink* sink);
+
+		/**
+		 * \brief Gets the limiter incoming packets are checked against, or \c nullptr if none.
+		 */
+		[[nodiscard]] IngressLimiter* ingress_limiter() const;
+
+		/**
+		 * \brief Drops incoming packets beyond the rates of a limiter.
+		 *
+		 * Packets are checked as soon as they are received, before they are verified or
+		 * returned. A dropped packet makes the receive return \c sws::SocketState::in_progress
+		 * with the packet empty, and counts \c Counter::rate_limited. A TCP socket is one peer,
+		 * and sockets accepted by it share its limiter. A UDP socket tracks each remote address.
+		 *
+		 * \param limiter Limiter to check against, or \c nullptr to stop limiting.
+		 * The limiter must outlive the socket, or be detached from it first.
+		 */
+		void ingress_limiter(IngressLimiter* limiter);
+
 		/**
 		 * \brief Closes this socket (unbinds, etc).
+		 * Packets buffered by auto-corking or queued are flushed if possible without blocking.
+		 * Waits for sends started with \c Socket::zero_copy to complete.
 		 */
 		void close() noexcept;
 
@@ -232,6 +432,27 @@ namespace sws
 		 */
 		SocketState blocking(bool value);
 
+		/**
+		 * \brief Gets the options which have been set on this socket.
+		 * \see sws::SocketOptions
+		 */
+		[[nodiscard]] const SocketOptions& options() const;
+
+		/**
+		 * \brief Sets socket options.
+		 * \param value Options to set. Options without a value are left unchanged.
+		 * \return \c sws::SocketState::done on success.
+		 * \remark
+		 * If the socket is not open, this method will always succeed.
+		 * The options will be applied once the native socket is
+		 * created by \c Socket::bind or \c Socket::connect. Sockets
+		 * accepted by a \c sws::TcpSocket inherit its options.
+		 *
+		 * \see sws::SocketOptions
+		 * \see sws::SocketState
+		 */
+		SocketState options(const SocketOptions& value);
+
 		/**
 		 * \brief Gets the protocol of this socket.
 		 * \see sws::Protocol
@@ -243,6 +464,12 @@ namespace sws
 		 */
 		[[nodiscard]] bool is_open() const;
 
+		/**
+		 * \brief Gets the I/O counters of this socket.
+		 * \see sws::global_statistics
+		 */
+		[[nodiscard]] const SocketStatistics& statistics() const;
+
 		/**
 		 * \brief Gets the last native socket error.
 		 */
@@ -250,6 +477,7 @@ namespace sws
 
 	protected:
 		void init_socket(const sockaddr_storage& native);
+		SocketState apply_options(const SocketOptions& value, int family);
 
 		void update_local_address();
 		void update_remote_address();
@@ -261,6 +489,19 @@ namespace sws
 		SocketError clear_error();
 		SocketState clear_error_state();
 
-		SocketState receive_datagram_packet(Packet& packet, int received);
+		SocketState receive_datagram_packet(Packet& packet, int received, const Address& address);
+		SocketState receive_failed(Packet& packet, int received);
+		int send_checksummed(std::span<const uint8_t> data, const Address* address) const;
+		SocketState send_corked(Packet& packet);
+		SocketState send_queued();
+		SocketState send_zero_copy(Packet& packet);
+		void reap_zero_copy(bool wait) noexcept;
+		SocketState apply_zero_copy_buffer();
+		void close_zero_copy() noexcept;
+
+		void capture_packet(CaptureDirection direction, std::span<const uint8_t> data, const Address& address) const;
+
+		void record_send(int result) const;
+		void record_receive(int result) const;
 	};
 }
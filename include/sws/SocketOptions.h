@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace sws
+{
+	/**
+	 * \brief Native socket options. Only options which have a value are applied;
+	 * the rest are left at the system default.
+	 *
+	 * \remark Winsock has no equivalent of \c TCP_CORK or \c SO_BUSY_POLL.
+	 * \see sws::Socket::options
+	 */
+	struct SocketOptions
+	{
+		/**
+		 * \brief Size of the send buffer in bytes (\c SO_SNDBUF).
+		 */
+		std::optional<int> send_buffer_size;
+
+		/**
+		 * \brief Size of the receive buffer in bytes (\c SO_RCVBUF).
+		 */
+		std::optional<int> receive_buffer_size;
+
+		/**
+		 * \brief Disables Nagle's algorithm (\c TCP_NODELAY). TCP only.
+		 */
+		std::optional<bool> no_delay;
+
+		/**
+		 * \brief Acknowledges every segment immediately instead of delaying acknowledgements.
+		 * This is the Winsock counterpart of \c TCP_QUICKACK (\c SIO_TCP_SET_ACK_FREQUENCY). TCP only.
+		 */
+		std::optional<bool> quick_ack;
+
+		/**
+		 * \brief Sends keep-alive probes on idle connections (\c SO_KEEPALIVE). TCP only.
+		 */
+		std::optional<bool> keep_alive;
+
+		/**
+		 * \brief Allows binding to an address which is already in use (\c SO_REUSEADDR).
+		 * \remark On Windows this lets another socket take over a bound port;
+		 * it does not load-balance like \c SO_REUSEPORT
+		 */
+		std::optional<bool> reuse_address;
+
+		/**
+		 * \brief Type of service / traffic class byte of outgoing packets (\c IP_TOS or \c IPV6_TCLASS).
+		 */
+		std::optional<uint8_t> type_of_service;
+
+		/**
+		 * \brief Copies every option which has a value in \p other into this.
+		 * \return \c *this
+		 */
+		SocketOptions& merge(const SocketOptions& other);
+
+		/**
+		 * \brief Options favoring latency: Nagle disabled and immediate acknowledgements.
+		 */
+		[[nodiscard]] static SocketOptions low_latency();
+
+		/**
+		 * \brief Options favoring throughput: Nagle and delayed acknowledgements
+		 * enabled, with large buffers.
+		 */
+		[[nodiscard]] static SocketOptions high_throughput();
+	};
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace sws
+{
+	/**
+	 * \brief I/O events counted per socket and per process.
+	 */
+	enum class Counter : uint8_t
+	{
+		bytes_sent,
+		bytes_received,
+		packets_sent,
+		packets_received,
+		/** Native send calls, including failed ones. */
+		send_calls,
+		/** Native receive calls, including failed ones. */
+		receive_calls,
+		/** Native calls which failed with \c sws::SocketError::would_block */
+		would_block,
+		/** Native sends which accepted only part of a \c sws::Packet */
+		partial_sends,
+		/** Datagrams dropped for being too small or having a mismatched size header. */
+		malformed_datagrams,
+		/** Datagrams dropped because their CRC32C trailer did not match. */
+		checksum_failures,
+		/** Packets dropped by a \c sws::IngressLimiter */
+		rate_limited,
+
+		count
+	};
+
+	inline constexpr size_t counter_count = static_cast<size_t>(Counter::count);
+
+	/**
+	 * \brief Gets the name of a counter, e.g. \c "bytes_sent"
+	 */
+	[[nodiscard]] std::string_view to_string(Counter counter);
+
+	/**
+	 * \brief Point-in-time copy of a set of counters.
+	 */
+	struct StatisticsSnapshot
+	{
+		std::array<uint64_t, counter_count> values {};
+
+		[[nodiscard]] uint64_t operator[](Counter counter) const;
+
+		StatisticsSnapshot& operator+=(const StatisticsSnapshot& rhs);
+		StatisticsSnapshot& operator-=(const StatisticsSnapshot& rhs);
+	};
+
+	[[nodiscard]] StatisticsSnapshot operator+(StatisticsSnapshot lhs, const StatisticsSnapshot& rhs);
+	[[nodiscard]] StatisticsSnapshot operator-(StatisticsSnapshot lhs, const StatisticsSnapshot& rhs);
+
+	/**
+	 * \brief Counters of a single socket. Every update is also added to the
+	 * process-wide counters returned by \c sws::global_statistics
+	 *
+	 * \remark Only the thread using the socket may update its counters, which
+	 * is what makes updates cheap (relaxed loads and stores, no locked
+	 * instructions). Any thread may read them.
+	 */
+	class SocketStatistics
+	{
+		std::array<std::atomic<uint64_t>, counter_count> counters_ {};
+
+	public:
+		SocketStatistics() = default;
+		SocketStatistics(const SocketStatistics& other);
+		SocketStatistics& operator=(const SocketStatistics& other);
+
+		/**
+		 * \brief Adds to a counter of this socket and to the process-wide counter.
+		 * \param counter Counter to add to.
+		 * \param amount Amount to add.
+		 */
+		void add(Counter counter, uint64_t amount = 1);
+
+		/**
+		 * \brief Gets the current value of a counter.
+		 */
+		[[nodiscard]] uint64_t get(Counter counter) const;
+
+		/**
+		 * \brief Copies all counters.
+		 */
+		[[nodiscard]] StatisticsSnapshot snapshot() const;
+
+		/**
+		 * \brief Resets the counters of this socket. Process-wide counters are unaffected.
+		 */
+		void reset();
+	};
+
+	/**
+	 * \brief Gets the process-wide counters, summed over every socket since startup.
+	 * \remark Counters are kept in per-thread shards which are merged here. A thread's
+	 * shard is folded into a shared total when the thread exits, so totals never go backwards.
+	 */
+	[[nodiscard]] StatisticsSnapshot global_statistics();
+
+	/**
+	 * \brief Formats counters in the Prometheus text exposition format.
+	 * \param snapshot Counters to format.
+	 * \param prefix Prefix of every metric name, e.g. \c "sws" gives \c sws_bytes_sent_total
+	 * \return The formatted metrics.
+	 */
+	[[nodiscard]] std::string to_prometheus(const StatisticsSnapshot& snapshot, std::string_view prefix = "sws");
+
+	/**
+	 * \brief Writes counters in the Prometheus text exposition format to a file.
+	 * The file is written next to \p path and renamed into place, so a scraper
+	 * never sees a partially written file.
+	 * \param path File to write.
+	 * \param snapshot Counters to write.
+	 * \param prefix Prefix of every metric name.
+	 * \return \c true on success.
+	 */
+	bool write_prometheus(const std::filesystem::path& path, const StatisticsSnapshot& snapshot, std::string_view prefix = "sws");
+}
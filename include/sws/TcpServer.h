@@ -0,0 +1,116 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "TcpSocket.h"
+
+namespace sws
+{
+	/**
+	 * \brief A multi-threaded TCP server. Each worker thread runs its own
+	 * \c sws::EventLoop and accepts connections from a shared listening socket.
+	 *
+	 * \remark Winsock has no \c SO_REUSEPORT load balancing across listening
+	 * sockets, so workers share one non-blocking listener and race to accept;
+	 * whichever worker wins owns the connection for its lifetime. Accepted
+	 * sockets inherit the listener's non-blocking mode, as well as its options,
+	 * capture sink and ingress limiter (see \c TcpServer::listener).
+	 */
+	class TcpServer
+	{
+	public:
+		/**
+		 * \brief Callback invoked on a worker thread for each accepted connection.
+		 * The connection should be registered with \p loop to be serviced by that worker.
+		 */
+		using AcceptHandler = std::function<void(EventLoop& loop, TcpSocket&& socket)>;
+
+		/**
+		 * \brief Maximum number of connections a worker accepts per wake-up
+		 * before giving other workers (and its own connections) a turn.
+		 */
+		static constexpr size_t accept_batch = 64;
+
+	protected:
+		struct Worker
+		{
+			EventLoop   loop;
+			std::thread thread;
+		};
+
+		TcpSocket     listener_;
+		AcceptHandler handler_;
+
+		std::vector<std::unique_ptr<Worker>> workers_;
+
+		size_t worker_count_;
+		int    backlog_;
+		bool   pin_threads_;
+
+	public:
+		/**
+		 * \brief Constructs a TCP server.
+		 * \param worker_count Number of worker threads. \c 0 uses the number of hardware threads.
+		 * \param backlog Maximum length of the queue of pending connections.
+		 * \param pin_threads If \c true, each worker thread is pinned to one processor.
+		 */
+		explicit TcpServer(size_t worker_count = 0, int backlog = SOMAXCONN, bool pin_threads = false);
+
+		TcpServer(const TcpServer&) = delete;
+		TcpServer& operator=(const TcpServer&) = delete;
+
+		/**
+		 * \brief Destructor. Automatically calls \c TcpServer::stop
+		 */
+		~TcpServer();
+
+		/**
+		 * \brief Binds, listens and starts the worker threads.
+		 * \param address The address and port to listen on.
+		 * \param handler Callback invoked for each accepted connection.
+		 * \return \c sws::SocketState::done on success.
+		 */
+		SocketState start(const Address& address, AcceptHandler handler);
+
+		/**
+		 * \brief Stops all worker threads and closes the listening socket.
+		 */
+		void stop();
+
+		/**
+		 * \brief Gets the number of worker threads.
+		 */
+		[[nodiscard]] size_t worker_count() const;
+
+		/**
+		 * \brief Gets the event loop of a worker.
+		 * \param index Index of the worker.
+		 */
+		[[nodiscard]] EventLoop& loop(size_t index);
+
+		/**
+		 * \brief Gets the listening socket, to set the options, capture sink and
+		 * ingress limiter that accepted connections inherit.
+		 * \remark Configure it before \c TcpServer::start; it is shared by every worker while running.
+		 */
+		[[nodiscard]] TcpSocket& listener();
+
+		/**
+		 * \brief Gets the local address/port of the listening socket.
+		 */
+		[[nodiscard]] const Address& local_address() const;
+
+		/**
+		 * \brief Gets the last native socket error of the listening socket.
+		 */
+		[[nodiscard]] SocketError native_error() const;
+
+	protected:
+		void accept_connections(EventLoop& loop);
+		static void pin_thread(std::thread& thread, size_t processor);
+	};
+}
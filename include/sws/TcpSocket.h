@@ -1,11 +1,14 @@
 #pragma once
 
 #include "Socket.h"
+#include "FileTransfer.h"
 
 namespace sws
 {
 	class TcpSocket : public Socket
 	{
+		friend class TcpServer;
+
 	public:
 		/**
 		 * \brief Construct a blocking TCP socket.
@@ -20,9 +23,10 @@ namespace sws
 
 		/**
 		 * \brief Begins listening on this socket for incoming connections.
+		 * \param backlog Maximum length of the queue of pending connections.
 		 * \return \c SocketState::done on success.
 		 */
-		SocketState listen();
+		SocketState listen(int backlog = SOMAXCONN);
 
 		/**
 		 * \brief Accepts an incoming connection, if any.
@@ -31,6 +35,22 @@ namespace sws
 		 */
 		SocketState accept(TcpSocket& s);
 
+		/**
+		 * \brief Sends a range of a file without copying it through a \c sws::Packet
+		 *
+		 * Blocking sockets hand the file to \c TransmitFile, which sends it from the
+		 * file system cache without it ever entering user space. Non-blocking sockets
+		 * send straight out of a memory-mapped view of the file.
+		 *
+		 * \param file [in,out] Transfer to send. Its position advances by the number of bytes sent.
+		 * \return \c sws::SocketState::done once the whole range has been sent.
+		 * \c sws::SocketState::in_progress if the socket would block, in which case
+		 * this must be called again with the same transfer to resume.
+		 * \throws std::system_error if the file cannot be mapped.
+		 * \remark Packets buffered by auto-corking are flushed first.
+		 */
+		SocketState send_file(FileTransfer& file);
+
 		// TODO: re-implement
 		bool send_all(const uint8_t* data, int length);
 
@@ -42,5 +62,11 @@ namespace sws
 
 		// TODO: re-implement
 		bool receive_all(std::span<uint8_t> data);
+
+	protected:
+		// Takes over a socket accepted by `listener`, inheriting its options, capture sink and ingress limiter.
+		void adopt(NativeSocket socket, const TcpSocket& listener);
+		SocketState transmit_file(FileTransfer& file);
+		SocketState send_mapped(FileTransfer& file);
 	};
 }
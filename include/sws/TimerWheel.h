@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace sws
+{
+	/**
+	 * \brief Handle to a timer scheduled on a \c sws::TimerWheel
+	 * Handles become invalid once the timer fires (unless rescheduled) or is cancelled.
+	 */
+	struct TimerId
+	{
+		uint32_t index      = UINT32_MAX;
+		uint32_t generation = 0;
+
+		[[nodiscard]] bool valid() const;
+
+		bool operator==(const TimerId& other) const = default;
+	};
+
+	/**
+	 * \brief A hierarchical timing wheel with O(1) schedule, cancel and reschedule.
+	 *
+	 * Time is divided into ticks of a fixed resolution. Timers due within 256 ticks
+	 * live in the first level; timers further out live in coarser levels and are
+	 * cascaded down as time advances. Advancing skips empty slots, so the cost of
+	 * \c TimerWheel::advance is bounded by the number of expired timers plus one
+	 * step per 256 ticks elapsed.
+	 *
+	 * \remark Timers never fire early, and fire at most one tick late.
+	 */
+	class TimerWheel
+	{
+	public:
+		using clock    = std::chrono::steady_clock;
+		using Callback = std::function<void()>;
+
+		static constexpr size_t level_bits  = 8;
+		static constexpr size_t level_slots = 1 << level_bits;
+		static constexpr size_t level_count = 4;
+
+	protected:
+		static constexpr uint32_t nil = UINT32_MAX;
+
+		enum class NodeState : uint8_t
+		{
+			free,
+			armed,
+			firing,
+			cancelled
+		};
+
+		struct Node
+		{
+			uint64_t  expiry      = 0;
+			uint32_t  prev        = nil;
+			uint32_t  next        = nil;
+			uint32_t  generation  = 0;
+			uint16_t  slot        = 0;
+			NodeState state       = NodeState::free;
+			bool      dispatching = false; // callback running; fire releases the node once it returns
+			Callback  callback;
+		};
+
+		struct Level
+		{
+			std::array<uint32_t, level_slots> heads {};
+			std::array<uint64_t, level_slots / 64> occupied {};
+		};
+
+		clock::duration   resolution_;
+		clock::time_point origin_;
+		uint64_t          current_ = 0;
+
+		std::array<Level, level_count> levels_ {};
+
+		// std::deque keeps a node's callback in place while it runs, even if
+		// the callback schedules more timers.
+		std::deque<Node>      nodes_;
+		std::vector<uint32_t> free_;
+		size_t                armed_ = 0;
+
+	public:
+		/**
+		 * \brief Constructs a timer wheel.
+		 * \param resolution Length of one tick.
+		 * \param start Time corresponding to tick zero.
+		 */
+		explicit TimerWheel(clock::duration resolution = std::chrono::milliseconds(1), clock::time_point start = clock::now());
+
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		/**
+		 * \brief Schedules a callback to be invoked after a delay.
+		 * \param delay Time from now until the timer fires.
+		 * \param callback Invoked from \c TimerWheel::advance
+		 * \return Handle to the new timer.
+		 */
+		TimerId schedule(clock::duration delay, Callback callback);
+
+		/**
+		 * \brief Schedules a callback to be invoked at a point in time.
+		 * \param when Time at which the timer fires.
+		 * \param callback Invoked from \c TimerWheel::advance
+		 * \return Handle to the new timer.
+		 */
+		TimerId schedule_at(clock::time_point when, Callback callback);
+
+		/**
+		 * \brief Moves an armed timer to a new delay from now, keeping its callback.
+		 * May be called from the timer's own callback to make it periodic.
+		 * \return \c false if \p id is no longer valid.
+		 */
+		bool reschedule(TimerId id, clock::duration delay);
+
+		/**
+		 * \brief Moves an armed timer to a new point in time, keeping its callback.
+		 * \return \c false if \p id is no longer valid.
+		 */
+		bool reschedule_at(TimerId id, clock::time_point when);
+
+		/**
+		 * \brief Cancels a timer.
+		 * \return \c false if \p id is no longer valid.
+		 */
+		bool cancel(TimerId id);
+
+		/**
+		 * \brief Checks if a timer is still waiting to fire.
+		 */
+		[[nodiscard]] bool armed(TimerId id) const;
+
+		/**
+		 * \brief Fires every timer due at or before \p now
+		 * \param now Current time.
+		 * \return Number of timers fired.
+		 */
+		size_t advance(clock::time_point now);
+
+		/**
+		 * \brief Gets a time at or before the next timer expiry, suitable as a poll deadline.
+		 * \return \c clock::time_point::max() if no timers are armed.
+		 */
+		[[nodiscard]] clock::time_point next_expiry() const;
+
+		/**
+		 * \brief Gets the number of armed timers.
+		 */
+		[[nodiscard]] size_t size() const;
+
+		/**
+		 * \brief Checks if no timers are armed.
+		 */
+		[[nodiscard]] bool empty() const;
+
+	protected:
+		[[nodiscard]] uint64_t to_tick(clock::time_point when) const;
+		[[nodiscard]] clock::time_point from_tick(uint64_t tick) const;
+
+		Node* get(TimerId id);
+		[[nodiscard]] const Node* get(TimerId id) const;
+
+		uint32_t allocate();
+		void release(uint32_t index);
+
+		void link(uint32_t index);
+		void unlink(uint32_t index);
+
+		void cascade(size_t level);
+		size_t fire(uint64_t tick);
+		void finish(uint32_t index);
+
+		[[nodiscard]] ptrdiff_t next_occupied(size_t level, size_t from) const;
+	};
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+
+namespace sws
+{
+	/**
+	 * \brief A token bucket used for rate limiting (e.g. bytes per second).
+	 * Tokens are refilled continuously at \c rate per second, up to \c burst tokens.
+	 * A bucket with a rate of \c 0 is unlimited.
+	 */
+	class TokenBucket
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+	protected:
+		double rate_   = 0.0;
+		double burst_  = 0.0;
+		double tokens_ = 0.0;
+
+		clock::time_point last_ {};
+
+	public:
+		/**
+		 * \brief Constructs an unlimited token bucket.
+		 */
+		TokenBucket() = default;
+
+		/**
+		 * \brief Constructs a token bucket. The bucket starts full.
+		 * \param rate Number of tokens refilled per second. \c 0 for unlimited.
+		 * \param burst Maximum number of tokens the bucket can hold.
+		 */
+		TokenBucket(double rate, double burst);
+
+		/**
+		 * \brief Refills the bucket according to the time elapsed since the last refill.
+		 * \param now Current time.
+		 */
+		void refill(clock::time_point now);
+
+		/**
+		 * \brief Attempts to take \p amount tokens out of the bucket.
+		 * \param amount Number of tokens to take.
+		 * \param now Current time.
+		 * \return \c true if there were enough tokens, in which case they are consumed.
+		 * \remark If \p amount exceeds the burst size, it is allowed once the bucket is full,
+		 * leaving the bucket in debt until enough time has passed to repay it.
+		 */
+		bool try_consume(double amount, clock::time_point now);
+
+		/**
+		 * \brief Computes how long it will take until \p amount tokens are available.
+		 * \param amount Number of tokens required.
+		 * \param now Current time.
+		 * \return Zero if the tokens are available now, otherwise the time to wait.
+		 * \remark If \p amount exceeds the burst size, the time until the bucket is full is returned.
+		 */
+		[[nodiscard]] clock::duration time_until(double amount, clock::time_point now) const;
+
+		/**
+		 * \brief Gets the refill rate in tokens per second.
+		 */
+		[[nodiscard]] double rate() const;
+
+		/**
+		 * \brief Gets the maximum number of tokens the bucket can hold.
+		 */
+		[[nodiscard]] double burst() const;
+
+		/**
+		 * \brief Gets the number of tokens available as of the last refill.
+		 */
+		[[nodiscard]] double tokens() const;
+
+		/**
+		 * \brief Checks if this bucket is unlimited (i.e. has a rate of \c 0).
+		 */
+		[[nodiscard]] bool unlimited() const;
+	};
+}
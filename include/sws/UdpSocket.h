@@ -6,6 +6,12 @@ namespace sws
 {
 	class UdpSocket : public Socket
 	{
+		bool receive_timestamps_ = false;
+
+		int      multicast_hops_      = 1;
+		bool     multicast_loopback_  = true;
+		uint32_t multicast_interface_ = 0;
+
 	public:
 		/**
 		 * \brief Construct a blocking UDP socket.
@@ -56,6 +62,19 @@ namespace sws
 		 */
 		int receive_from(std::span<uint8_t> data, Address& address) const;
 
+		/**
+		 * \brief Receives a raw buffer of data from an address along with the
+		 * time the datagram was received by the network stack.
+		 * \param data Buffer to receive into.
+		 * \param address Address of the data's origin.
+		 * \param timestamp [out] Receive time in the same clock as \c sws::timestamp_now,
+		 * or \c 0 if the stack did not provide one.
+		 * \return \c -1 on error, non-zero positive number of bytes received on success.
+		 * \remark Requires \c UdpSocket::receive_timestamps to be enabled to get timestamps.
+		 * Note that this method does not perform error handling.
+		 */
+		int receive_from(std::span<uint8_t> data, Address& address, uint64_t& timestamp) const;
+
 		/**
 		 * \brief Sends a packet to an address.
 		 * \param packet \c sws::Packet to send.
@@ -71,5 +90,111 @@ namespace sws
 		 * \return \c sws::SocketState::done on success.
 		 */
 		SocketState receive_from(Packet& packet, Address& address);
+
+		/**
+		 * \brief Receives a packet from an address along with the time the
+		 * datagram was received by the network stack.
+		 * \param packet \c sws::Packet to receive into.
+		 * \param address Address of packet's origin.
+		 * \param timestamp [out] Receive time in the same clock as \c sws::timestamp_now,
+		 * or \c 0 if the stack did not provide one.
+		 * \return \c sws::SocketState::done on success.
+		 * \remark Subtracting \p timestamp from \c sws::timestamp_now gives the time
+		 * the datagram spent queued before the application picked it up.
+		 */
+		SocketState receive_from(Packet& packet, Address& address, uint64_t& timestamp);
+
+		/**
+		 * \brief Checks if receive timestamps are enabled.
+		 */
+		[[nodiscard]] bool receive_timestamps() const;
+
+		/**
+		 * \brief Enables or disables software receive timestamps (\c SIO_TIMESTAMPING).
+		 * \param value Whether the network stack should timestamp received datagrams.
+		 * \return \c sws::SocketState::done on success.
+		 * \remark The socket must be bound or connected first. Requires Windows 10
+		 * version 2004 or later; otherwise an error is returned.
+		 */
+		SocketState receive_timestamps(bool value);
+
+		/**
+		 * \brief Checks if packets are sent and received with a CRC32C trailer.
+		 */
+		[[nodiscard]] bool checksum() const;
+
+		/**
+		 * \brief Enables or disables a CRC32C trailer on packets sent and received by this socket.
+		 *
+		 * The trailer covers the size header and payload, and is checked before a received
+		 * datagram is parsed. Datagrams which fail the check, such as corrupted or stray
+		 * ones, are dropped: the receive returns \c sws::SocketState::in_progress and counts
+		 * \c Counter::checksum_failures. Both peers must enable it.
+		 *
+		 * \param value Whether to add and verify the trailer. Disabled by default.
+		 * \see Socket::checksum_size
+		 */
+		void checksum(bool value);
+
+		/**
+		 * \brief Joins a multicast group, so that datagrams sent to it are received by this socket.
+		 * \param group Multicast address of the group, of the same family as the socket.
+		 * \param interface_index Index of the interface to join on, or \c 0 to let the system choose.
+		 * \return \c sws::SocketState::done on success.
+		 * \remark The socket must be bound first, normally to the wildcard address and the group's port.
+		 * Set \c SocketOptions::reuse_address before binding to let several sockets on one host join.
+		 */
+		SocketState join_group(const Address& group, uint32_t interface_index = 0);
+
+		/**
+		 * \brief Leaves a multicast group joined with \c UdpSocket::join_group
+		 * \param group Multicast address of the group.
+		 * \param interface_index Index of the interface the group was joined on.
+		 * \return \c sws::SocketState::done on success.
+		 */
+		SocketState leave_group(const Address& group, uint32_t interface_index = 0);
+
+		/**
+		 * \brief Gets the time-to-live (IPv4) or hop limit (IPv6) of multicast datagrams sent by this socket.
+		 */
+		[[nodiscard]] int multicast_hops() const;
+
+		/**
+		 * \brief Sets the time-to-live (IPv4) or hop limit (IPv6) of multicast datagrams sent by this socket.
+		 * \param value Number of routers datagrams may cross; \c 1 (the default) keeps them on the local network.
+		 * \return \c sws::SocketState::done on success.
+		 * \remark The socket must be bound or connected first.
+		 */
+		SocketState multicast_hops(int value);
+
+		/**
+		 * \brief Checks if multicast datagrams sent by this socket are looped back to the sending host.
+		 */
+		[[nodiscard]] bool multicast_loopback() const;
+
+		/**
+		 * \brief Enables or disables looping back multicast datagrams to group members on the sending host.
+		 * \param value Whether members on this host receive datagrams it sends. Enabled by default.
+		 * \return \c sws::SocketState::done on success.
+		 * \remark The socket must be bound or connected first.
+		 */
+		SocketState multicast_loopback(bool value);
+
+		/**
+		 * \brief Gets the index of the interface multicast datagrams are sent from, or \c 0 if the system chooses.
+		 */
+		[[nodiscard]] uint32_t multicast_interface() const;
+
+		/**
+		 * \brief Selects the interface multicast datagrams are sent from.
+		 * \param interface_index Index of the interface, or \c 0 to let the system choose.
+		 * \return \c sws::SocketState::done on success.
+		 * \remark The socket must be bound or connected first.
+		 */
+		SocketState multicast_interface(uint32_t interface_index);
+
+	protected:
+		[[nodiscard]] int native_family() const;
+		SocketState membership(const Address& group, uint32_t interface_index, bool join);
 	};
 }
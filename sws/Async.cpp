@@ -0,0 +1,111 @@
+#include "../include/sws/Async.h"
+
+namespace sws
+{
+	ReceiveAwaiter::ReceiveAwaiter(EventLoop& loop, Socket& socket, Packet& packet, duration timeout)
+		: AsyncOperation(loop, socket, timeout),
+		  packet_(packet)
+	{
+	}
+
+	SocketState ReceiveAwaiter::attempt(PollEvents)
+	{
+		return socket_.receive(packet_);
+	}
+
+	SendAwaiter::SendAwaiter(EventLoop& loop, Socket& socket, Packet& packet, duration timeout)
+		: AsyncOperation(loop, socket, timeout),
+		  packet_(packet)
+	{
+	}
+
+	SocketState SendAwaiter::attempt(PollEvents)
+	{
+		return socket_.send(packet_);
+	}
+
+	AcceptAwaiter::AcceptAwaiter(EventLoop& loop, TcpSocket& listener, TcpSocket& accepted, duration timeout)
+		: AsyncOperation(loop, listener, timeout),
+		  accepted_(accepted)
+	{
+	}
+
+	SocketState AcceptAwaiter::attempt(PollEvents)
+	{
+		return static_cast<TcpSocket&>(socket_).accept(accepted_);
+	}
+
+	ConnectAwaiter::ConnectAwaiter(EventLoop& loop, Socket& socket, const Address& address, duration timeout)
+		: AsyncOperation(loop, socket, timeout),
+		  address_(address)
+	{
+	}
+
+	SocketState ConnectAwaiter::attempt(PollEvents events)
+	{
+		if (!any(events & PollEvents::error))
+		{
+			return socket_.connect(address_);
+		}
+
+		// A failed non-blocking connect is reported through SO_ERROR.
+		int error = 0;
+		int length = sizeof(error);
+
+		if (getsockopt(socket_.socket_, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) == SOCKET_ERROR)
+		{
+			return socket_.get_error_state();
+		}
+
+		socket_.native_error_ = error ? static_cast<SocketError>(error) : SocketError::connection_refused;
+		return SocketState::error;
+	}
+
+	SleepAwaiter::SleepAwaiter(EventLoop& loop, TimerWheel::clock::duration delay)
+		: loop_(loop),
+		  delay_(delay)
+	{
+	}
+
+	bool SleepAwaiter::await_ready() const
+	{
+		return delay_ <= TimerWheel::clock::duration::zero();
+	}
+
+	void SleepAwaiter::await_suspend(std::coroutine_handle<> handle)
+	{
+		loop_.timers().schedule(delay_, [handle]
+		{
+			handle.resume();
+		});
+	}
+
+	void SleepAwaiter::await_resume() const
+	{
+	}
+
+	ReceiveAwaiter async_receive(EventLoop& loop, Socket& socket, Packet& packet, TimerWheel::clock::duration timeout)
+	{
+		return { loop, socket, packet, timeout };
+	}
+
+	SendAwaiter async_send(EventLoop& loop, Socket& socket, Packet& packet, TimerWheel::clock::duration timeout)
+	{
+		return { loop, socket, packet, timeout };
+	}
+
+	AcceptAwaiter async_accept(EventLoop& loop, TcpSocket& listener, TcpSocket& accepted, TimerWheel::clock::duration timeout)
+	{
+		return { loop, listener, accepted, timeout };
+	}
+
+	ConnectAwaiter async_connect(EventLoop& loop, Socket& socket, const Address& address, TimerWheel::clock::duration timeout)
+	{
+		return { loop, socket, address, timeout };
+	}
+
+	SleepAwaiter async_sleep(EventLoop& loop, TimerWheel::clock::duration delay)
+	{
+		return { loop, delay };
+	}
+}
@@ -0,0 +1,224 @@
+#include "../include/sws/Broadcast.h"
+#include "../include/sws/Packet.h"
+#include "../include/sws/TcpSocket.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sws
+{
+	namespace
+	{
+		void send_one(const SharedPacket& packet, TcpSocket* socket, BroadcastResult& result)
+		{
+			if (!socket)
+			{
+				return;
+			}
+
+			if (!socket->is_open())
+			{
+				++result.failed;
+				return;
+			}
+
+			switch (socket->send(packet))
+			{
+				case SocketState::done:
+					++result.sent;
+					break;
+
+				case SocketState::in_progress:
+					++result.queued;
+					break;
+
+				default:
+					++result.failed;
+					break;
+			}
+		}
+
+		/**
+		 * \brief Worker threads kept for the life of the process and reused by every broadcast.
+		 * Starting threads per broadcast would cost more than it saves, and every thread
+		 * which sends keeps its statistics and latency shards forever.
+		 */
+		class WorkerPool
+		{
+			std::mutex busy_;
+
+			std::mutex               mutex_;
+			std::condition_variable  wake_;
+			std::condition_variable  finished_;
+			std::vector<std::thread> threads_;
+
+			const std::function<void(size_t)>* job_     = nullptr;
+			size_t                              next_    = 0;
+			size_t                              tasks_   = 0;
+			size_t                              pending_ = 0;
+
+		public:
+			static WorkerPool& instance()
+			{
+				// Intentionally leaked; joining threads during static destruction can deadlock.
+				static auto* pool = new WorkerPool();
+				return *pool;
+			}
+
+			/**
+			 * \brief Held by the broadcast using the pool. Broadcasts which cannot take it run alone.
+			 */
+			std::mutex& busy()
+			{
+				return busy_;
+			}
+
+			/**
+			 * \brief Runs \p job once for each task index on the workers, starting more if needed.
+			 * \c WorkerPool::wait must be called before \p job is destroyed.
+			 */
+			void start(size_t tasks, const std::function<void(size_t)>& job)
+			{
+				{
+					std::lock_guard lock(mutex_);
+
+					while (threads_.size() < tasks)
+					{
+						threads_.emplace_back([this] { work(); });
+					}
+
+					job_     = &job;
+					next_    = 0;
+					tasks_   = tasks;
+					pending_ = tasks;
+				}
+
+				wake_.notify_all();
+			}
+
+			void wait()
+			{
+				std::unique_lock lock(mutex_);
+				finished_.wait(lock, [this] { return !pending_; });
+
+				job_   = nullptr;
+				tasks_ = 0;
+				next_  = 0;
+			}
+
+		private:
+			void work()
+			{
+				std::unique_lock lock(mutex_);
+
+				while (true)
+				{
+					wake_.wait(lock, [this] { return next_ < tasks_; });
+
+					const size_t task = next_++;
+					const auto&  job  = *job_;
+
+					lock.unlock();
+					job(task);
+					lock.lock();
+
+					if (!--pending_)
+					{
+						finished_.notify_all();
+					}
+				}
+			}
+		};
+
+		// Splits [0, count) into up to `threads` chunks and runs `pass` on each, the last on this thread.
+		template <typename F>
+		BroadcastResult run_split(size_t count, size_t threads, F&& pass)
+		{
+			const size_t chunks = std::max<size_t>(1, std::min(threads, count / broadcast_sockets_per_thread));
+
+			WorkerPool& pool = WorkerPool::instance();
+			std::unique_lock busy(pool.busy(), std::defer_lock);
+
+			if (chunks == 1 || !busy.try_lock())
+			{
+				BroadcastResult result;
+				pass(0, count, result);
+				return result;
+			}
+
+			std::vector<BroadcastResult> results(chunks);
+
+			const size_t chunk_size = (count + chunks - 1) / chunks;
+
+			// Rounding the chunk size up can leave the last chunks short or empty.
+			const auto run_chunk = [&](size_t i)
+			{
+				pass(std::min(count, i * chunk_size), std::min(count, (i + 1) * chunk_size), results[i]);
+			};
+
+			const std::function<void(size_t)> job = run_chunk;
+
+			pool.start(chunks - 1, job);
+			run_chunk(chunks - 1);
+			pool.wait();
+
+			BroadcastResult total;
+
+			for (const BroadcastResult& result : results)
+			{
+				total += result;
+			}
+
+			return total;
+		}
+	}
+
+	BroadcastResult& BroadcastResult::operator+=(const BroadcastResult& rhs)
+	{
+		sent   += rhs.sent;
+		queued += rhs.queued;
+		failed += rhs.failed;
+		return *this;
+	}
+
+	BroadcastResult broadcast(const SharedPacket& packet, std::span<TcpSocket* const> sockets, size_t threads)
+	{
+		if (packet.empty())
+		{
+			return {};
+		}
+
+		return run_split(sockets.size(), threads, [&](size_t begin, size_t end, BroadcastResult& result)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				send_one(packet, sockets[i], result);
+			}
+		});
+	}
+
+	BroadcastResult broadcast(const SharedPacket& packet, std::span<TcpSocket> sockets, size_t threads)
+	{
+		if (packet.empty())
+		{
+			return {};
+		}
+
+		return run_split(sockets.size(), threads, [&](size_t begin, size_t end, BroadcastResult& result)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				send_one(packet, &sockets[i], result);
+			}
+		});
+	}
+
+	BroadcastResult broadcast(const Packet& packet, std::span<TcpSocket* const> sockets, size_t threads)
+	{
+		return broadcast(SharedPacket(packet), sockets, threads);
+	}
+}
@@ -0,0 +1,437 @@
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "../include/sws/Capture.h"
+#include "../include/sws/enforce.h"
+#include "../include/sws/Histogram.h"
+#include "../include/sws/Packet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+namespace sws
+{
+	namespace
+	{
+		// The log starts with a FileHeader, followed by records aligned to 8 bytes.
+		// The first 4 bytes of a record are its size. They are stored last, so that
+		// a reader never sees a partly written record; a size of 0 ends the log.
+
+		constexpr char     magic[8] = { 'S', 'W', 'S', 'C', 'A', 'P', '\0', '\0' };
+		constexpr uint32_t version  = 1;
+
+		struct FileHeader
+		{
+			char     magic[8];
+			uint32_t version;
+			uint32_t header_size;
+			uint64_t start_time;
+			uint64_t start_timestamp;
+		};
+
+		// Fills space which could not hold a record, e.g. the end of a segment.
+		constexpr uint8_t padding_kind = 0;
+
+		constexpr size_t max_address_size = sizeof(sockaddr_in6);
+
+		struct RecordHeader
+		{
+			uint32_t size;
+			uint8_t  kind;
+			uint8_t  address_size;
+			uint16_t reserved;
+			uint64_t timestamp;
+			uint32_t length;
+			uint8_t  address[max_address_size];
+		};
+
+		constexpr size_t record_alignment = 8;
+
+		static_assert(sizeof(FileHeader) % record_alignment == 0);
+		static_assert(sizeof(RecordHeader) % record_alignment == 0);
+
+		// Views must start on a multiple of the allocation granularity,
+		// which is 64 KiB on every version of Windows.
+		constexpr size_t segment_alignment = 64 * 1024;
+
+		constexpr uint64_t align(uint64_t size)
+		{
+			return (size + record_alignment - 1) & ~uint64_t(record_alignment - 1);
+		}
+
+		void commit(uint8_t* record, uint64_t size)
+		{
+			std::atomic_ref(*reinterpret_cast<uint32_t*>(record)).store(static_cast<uint32_t>(size), std::memory_order_release);
+		}
+
+		void write_padding(uint8_t* record, uint64_t size)
+		{
+			record[4] = padding_kind;
+			commit(record, size);
+		}
+
+		[[noreturn]] void throw_last_error(const char* what)
+		{
+			throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+		}
+	}
+
+	Packet CaptureRecord::packet() const
+	{
+		Packet result;
+
+		if (data.size() > sizeof(packetlen_t))
+		{
+			result.write_data(data.data() + sizeof(packetlen_t), data.size() - sizeof(packetlen_t), true);
+		}
+
+		return result;
+	}
+
+	CaptureLog::CaptureLog(const std::filesystem::path& path, size_t segment_size, size_t max_segments)
+		: segment_size_(segment_size),
+		  max_segments_(max_segments),
+		  segments_(std::make_unique<Segment[]>(max_segments))
+	{
+		enforce(segment_size && segment_size % segment_alignment == 0, "Capture segment size must be a multiple of 64 KiB.");
+		enforce(max_segments > 0, "Capture log must have at least one segment.");
+
+		file_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+		                    FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (file_ == INVALID_HANDLE_VALUE)
+		{
+			throw_last_error("Failed to create capture log");
+		}
+
+		uint8_t* const first = segment(0);
+
+		if (!first)
+		{
+			const DWORD error = GetLastError();
+			close();
+			SetLastError(error);
+			throw_last_error("Failed to map capture log");
+		}
+
+		const auto now = std::chrono::system_clock::now().time_since_epoch();
+
+		FileHeader header {};
+		std::memcpy(header.magic, magic, sizeof(magic));
+		header.version         = version;
+		header.header_size     = sizeof(FileHeader);
+		header.start_time      = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+		header.start_timestamp = timestamp_now();
+
+		std::memcpy(first, &header, sizeof(header));
+		tail_.store(sizeof(header), std::memory_order_relaxed);
+	}
+
+	CaptureLog::~CaptureLog()
+	{
+		close();
+	}
+
+	bool CaptureLog::append(CaptureDirection direction, const Address& address, std::span<const uint8_t> data) noexcept
+	{
+		const uint64_t size = align(sizeof(RecordHeader) + data.size());
+
+		if (size > segment_size_ || !is_open())
+		{
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		// The address is converted before any space is reserved, so that one which
+		// cannot be converted drops the packet rather than leaving a hole in the log.
+		sockaddr_storage native {};
+		size_t           native_size = 0;
+
+		if (address.family != AddressFamily::none)
+		{
+			try
+			{
+				native      = address.to_native();
+				native_size = std::min(address.native_size(), max_address_size);
+			}
+			catch (const std::exception&)
+			{
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+
+		for (;;)
+		{
+			const uint64_t offset = tail_.fetch_add(size, std::memory_order_relaxed);
+			const uint64_t end    = offset + size;
+
+			const size_t   index         = static_cast<size_t>(offset / segment_size_);
+			const uint64_t segment_start = static_cast<uint64_t>(index) * segment_size_;
+			const uint64_t segment_end   = segment_start + segment_size_;
+
+			uint8_t* const view = index + 1 < max_segments_ || end <= segment_end ? segment(index) : nullptr;
+
+			if (!view)
+			{
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			uint8_t* const record = view + (offset - segment_start);
+
+			// Records never straddle segments. Pad out both parts of the reservation and try again.
+			if (end > segment_end)
+			{
+				write_padding(record, segment_end - offset);
+
+				if (uint8_t* const next = segment(index + 1))
+				{
+					write_padding(next, end - segment_end);
+				}
+
+				continue;
+			}
+
+			// Whoever reserves the middle of a segment maps the next one,
+			// so that appends rarely have to wait for a mapping.
+			const uint64_t middle = segment_start + segment_size_ / 2;
+
+			if (offset <= middle && middle < end && index + 1 < max_segments_)
+			{
+				static_cast<void>(segment(index + 1));
+			}
+
+			RecordHeader header {};
+			header.kind      = static_cast<uint8_t>(direction);
+			header.timestamp = timestamp_now();
+			header.length    = static_cast<uint32_t>(data.size());
+
+			header.address_size = static_cast<uint8_t>(native_size);
+			std::memcpy(header.address, &native, native_size);
+
+			// The size is left at 0 until the whole record is in place.
+			std::memcpy(record + sizeof(header.size), reinterpret_cast<const uint8_t*>(&header) + sizeof(header.size),
+			            sizeof(header) - sizeof(header.size));
+
+			if (!data.empty())
+			{
+				std::memcpy(record + sizeof(header), data.data(), data.size());
+			}
+
+			commit(record, size);
+			return true;
+		}
+	}
+
+	bool CaptureLog::capture(Protocol, CaptureDirection direction, const Address&, const Address& remote,
+	                         std::span<const uint8_t> data) noexcept
+	{
+		return append(direction, remote, data);
+	}
+
+	void CaptureLog::close() noexcept
+	{
+		if (!is_open())
+		{
+			return;
+		}
+
+		for (size_t i = 0; i < max_segments_; ++i)
+		{
+			Segment& segment = segments_[i];
+
+			if (uint8_t* const view = segment.view.exchange(nullptr))
+			{
+				UnmapViewOfFile(view);
+			}
+
+			if (segment.mapping)
+			{
+				CloseHandle(segment.mapping);
+				segment.mapping = nullptr;
+			}
+		}
+
+		// Drop the unused rest of the last segment.
+		LARGE_INTEGER size {};
+		size.QuadPart = static_cast<LONGLONG>(std::min<uint64_t>(tail_.load(), static_cast<uint64_t>(segment_size_) * max_segments_));
+
+		if (SetFilePointerEx(file_, size, nullptr, FILE_BEGIN))
+		{
+			SetEndOfFile(file_);
+		}
+
+		CloseHandle(file_);
+		file_ = INVALID_HANDLE_VALUE;
+	}
+
+	bool CaptureLog::is_open() const
+	{
+		return file_ != INVALID_HANDLE_VALUE;
+	}
+
+	uint64_t CaptureLog::size() const
+	{
+		return tail_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t CaptureLog::dropped() const
+	{
+		return dropped_.load(std::memory_order_relaxed);
+	}
+
+	uint8_t* CaptureLog::segment(size_t index) noexcept
+	{
+		if (index >= max_segments_)
+		{
+			return nullptr;
+		}
+
+		Segment& segment = segments_[index];
+
+		if (uint8_t* const view = segment.view.load(std::memory_order_acquire))
+		{
+			return view;
+		}
+
+		std::lock_guard lock(map_lock_);
+
+		if (uint8_t* const view = segment.view.load(std::memory_order_relaxed))
+		{
+			return view;
+		}
+
+		const uint64_t offset = static_cast<uint64_t>(index) * segment_size_;
+		const uint64_t end    = offset + segment_size_;
+
+		// Mapping past the end of the file extends it with zeros.
+		segment.mapping = CreateFileMappingW(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(end >> 32),
+		                                     static_cast<DWORD>(end), nullptr);
+
+		if (!segment.mapping)
+		{
+			return nullptr;
+		}
+
+		auto* const view = static_cast<uint8_t*>(MapViewOfFile(segment.mapping, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32),
+		                                                       static_cast<DWORD>(offset), segment_size_));
+
+		if (!view)
+		{
+			CloseHandle(segment.mapping);
+			segment.mapping = nullptr;
+			return nullptr;
+		}
+
+		segment.view.store(view, std::memory_order_release);
+		return view;
+	}
+
+	CaptureReader::CaptureReader(const std::filesystem::path& path)
+		: file_(path, std::ios::binary)
+	{
+		if (!file_)
+		{
+			throw std::runtime_error("Failed to open capture log.");
+		}
+
+		FileHeader header {};
+
+		if (!file_.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		    std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version ||
+		    header.header_size < sizeof(header))
+		{
+			throw std::runtime_error("Not a capture log.");
+		}
+
+		start_time_      = header.start_time;
+		start_timestamp_ = header.start_timestamp;
+
+		file_.seekg(header.header_size);
+	}
+
+	bool CaptureReader::next(CaptureRecord& record)
+	{
+		for (;;)
+		{
+			RecordHeader header {};
+
+			if (!file_.read(reinterpret_cast<char*>(&header), sizeof(uint64_t)) || header.size < sizeof(uint64_t))
+			{
+				return false;
+			}
+
+			if (header.kind == padding_kind)
+			{
+				file_.seekg(header.size - sizeof(uint64_t), std::ios::cur);
+				continue;
+			}
+
+			if (header.size < sizeof(header) ||
+			    !file_.read(reinterpret_cast<char*>(&header) + sizeof(uint64_t), sizeof(header) - sizeof(uint64_t)) ||
+			    align(sizeof(header) + header.length) != header.size)
+			{
+				return false;
+			}
+
+			record.timestamp = header.timestamp;
+			record.direction = static_cast<CaptureDirection>(header.kind);
+			record.address   = header.address_size ? Address::from_native(reinterpret_cast<const sockaddr*>(header.address)) : Address();
+
+			record.data.resize(header.length);
+
+			if (!file_.read(reinterpret_cast<char*>(record.data.data()), header.length))
+			{
+				return false;
+			}
+
+			file_.seekg(header.size - sizeof(header) - header.length, std::ios::cur);
+			return true;
+		}
+	}
+
+	uint64_t CaptureReader::start_time() const
+	{
+		return start_time_;
+	}
+
+	uint64_t CaptureReader::start_timestamp() const
+	{
+		return start_timestamp_;
+	}
+
+	size_t replay(CaptureReader& reader, const std::function<bool(const CaptureRecord&)>& handler, ReplayPace pace)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		CaptureRecord record;
+		uint64_t first = 0;
+		size_t count = 0;
+
+		while (reader.next(record))
+		{
+			if (!count)
+			{
+				first = record.timestamp;
+			}
+			else if (pace == ReplayPace::recorded && record.timestamp > first)
+			{
+				std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.timestamp - first));
+			}
+
+			++count;
+
+			if (!handler(record))
+			{
+				break;
+			}
+		}
+
+		return count;
+	}
+}
@@ -0,0 +1,708 @@
+#include "../include/sws/Compressor.h"
+#include "../include/sws/enforce.h"
+#include "../include/sws/Packet.h"
+#include "../include/sws/Socket.h"
+#include "../include/sws/typedefs.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace sws
+{
+	namespace
+	{
+		constexpr int    max_hash_log  = 12;
+		constexpr size_t table_entries = size_t(1) << max_hash_log;
+
+		constexpr size_t min_match     = 4;
+		constexpr size_t max_offset    = 65535;
+		// The block format ends with at least 5 literals, and no match starts in the last 12 bytes.
+		constexpr size_t last_literals = 5;
+		constexpr size_t match_margin  = 12;
+		// Each miss in a row advances the search a little further, so incompressible data is skipped quickly.
+		constexpr int    skip_trigger  = 6;
+
+		// Flag byte, then the original size.
+		constexpr size_t header_size = 1 + sizeof(uint16_t);
+
+		// Slack past the end of decoded output, so that short copies can be done 16 bytes at a time.
+		constexpr size_t wild_copy_margin = 32;
+
+		uint32_t read32(const uint8_t* data)
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint64_t read64(const uint8_t* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint32_t hash(uint32_t sequence, int hash_log)
+		{
+			return (sequence * 2654435761u) >> (32 - hash_log);
+		}
+
+		// Counts the bytes at `a` equal to those at `b`, up to `a_end`.
+		size_t count_equal(const uint8_t* a, const uint8_t* b, const uint8_t* a_end)
+		{
+			const uint8_t* const start = a;
+
+			while (a_end - a >= 8)
+			{
+				if (const uint64_t diff = read64(a) ^ read64(b))
+				{
+					return (a - start) + (std::countr_zero(diff) >> 3);
+				}
+
+				a += 8;
+				b += 8;
+			}
+
+			while (a < a_end && *a == *b)
+			{
+				++a;
+				++b;
+			}
+
+			return a - start;
+		}
+
+		uint8_t* write_length(uint8_t* output, size_t length)
+		{
+			for (; length >= 255; length -= 255)
+			{
+				*output++ = 255;
+			}
+
+			*output++ = static_cast<uint8_t>(length);
+			return output;
+		}
+
+		bool read_length(const uint8_t*& input, const uint8_t* input_end, size_t& length)
+		{
+			uint8_t byte;
+
+			do
+			{
+				if (input == input_end)
+				{
+					return false;
+				}
+
+				byte = *input++;
+				length += byte;
+			} while (byte == 255);
+
+			return true;
+		}
+
+		// Writes literals followed by a match, or only literals if `length` is 0.
+		// `output_end` must be followed by `wild_copy_margin` writable bytes.
+		bool write_sequence(uint8_t*& output, const uint8_t* output_end, const uint8_t* literals, const uint8_t* input_end,
+		                    size_t literal_count, size_t offset, size_t length)
+		{
+			const size_t match  = length ? length - min_match : 0;
+			const size_t needed = 1 + literal_count + (literal_count >= 15 ? (literal_count - 15) / 255 + 1 : 0) +
+			                      (length ? 2 + (match >= 15 ? (match - 15) / 255 + 1 : 0) : 0);
+
+			if (static_cast<size_t>(output_end - output) < needed)
+			{
+				return false;
+			}
+
+			uint8_t* token = output++;
+			*token = static_cast<uint8_t>(std::min<size_t>(literal_count, 15) << 4);
+
+			if (literal_count >= 15)
+			{
+				output = write_length(output, literal_count - 15);
+			}
+
+			if (literal_count <= 16 && input_end - literals >= 16)
+			{
+				memcpy(output, literals, 16);
+			}
+			else
+			{
+				memcpy(output, literals, literal_count);
+			}
+
+			output += literal_count;
+
+			if (length)
+			{
+				*output++ = static_cast<uint8_t>(offset);
+				*output++ = static_cast<uint8_t>(offset >> 8);
+
+				*token |= static_cast<uint8_t>(std::min<size_t>(match, 15));
+
+				if (match >= 15)
+				{
+					output = write_length(output, match - 15);
+				}
+			}
+
+			return true;
+		}
+
+		// Encodes `input` as an LZ4 block. Returns its size, or 0 if it does not fit in `capacity`.
+		// `output` must have room for `wild_copy_margin` bytes more.
+		size_t encode(const uint8_t* input, size_t size, std::span<const uint8_t> dictionary, const uint32_t* dictionary_table,
+		              uint32_t* table, uint8_t* output, size_t capacity)
+		{
+			const int hash_log = std::clamp(static_cast<int>(std::bit_width(size)), 8, max_hash_log);
+			std::fill_n(table, size_t(1) << hash_log, 0u);
+
+			const uint8_t* const dict      = dictionary.data();
+			const size_t         dict_size = dictionary.size();
+
+			uint8_t*             op     = output;
+			const uint8_t* const op_end = output + capacity;
+
+			size_t anchor   = 0;
+			size_t position = 0;
+
+			if (size > match_margin)
+			{
+				const size_t search_end = size - match_margin;
+				const size_t match_end  = size - last_literals;
+
+				while (position < search_end)
+				{
+					size_t candidate = 0;
+					bool   found     = false;
+					bool   in_dict   = false;
+
+					for (size_t attempts = size_t(1) << skip_trigger; position < search_end; position += attempts++ >> skip_trigger)
+					{
+						const uint32_t sequence = read32(input + position);
+						uint32_t&      slot     = table[hash(sequence, hash_log)];
+
+						candidate = slot;
+						slot      = static_cast<uint32_t>(position);
+
+						if (candidate < position && position - candidate <= max_offset && read32(input + candidate) == sequence)
+						{
+							found = true;
+							break;
+						}
+
+						if (dictionary_table)
+						{
+							candidate = dictionary_table[hash(sequence, max_hash_log)];
+
+							if (dict_size - candidate + position <= max_offset && read32(dict + candidate) == sequence)
+							{
+								found   = true;
+								in_dict = true;
+								break;
+							}
+						}
+					}
+
+					if (!found)
+					{
+						break;
+					}
+
+					size_t length = min_match;
+
+					if (!in_dict)
+					{
+						length += count_equal(input + position + min_match, input + candidate + min_match, input + match_end);
+					}
+					else
+					{
+						// A match may run off the end of the dictionary into the start of the payload.
+						const size_t limit = std::min(match_end, position + (dict_size - candidate));
+						length += count_equal(input + position + min_match, dict + candidate + min_match, input + limit);
+
+						if (candidate + length == dict_size && position + length < match_end)
+						{
+							length += count_equal(input + position + length, input, input + match_end);
+						}
+					}
+
+					const uint8_t* const source = in_dict ? dict : input;
+
+					while (position > anchor && candidate > 0 && input[position - 1] == source[candidate - 1])
+					{
+						--position;
+						--candidate;
+						++length;
+					}
+
+					const size_t offset = in_dict ? dict_size - candidate + position : position - candidate;
+
+					if (!write_sequence(op, op_end, input + anchor, input + size, position - anchor, offset, length))
+					{
+						return 0;
+					}
+
+					position += length;
+					anchor = position;
+
+					if (position < search_end)
+					{
+						table[hash(read32(input + position - 2), hash_log)] = static_cast<uint32_t>(position - 2);
+					}
+				}
+			}
+
+			if (!write_sequence(op, op_end, input + anchor, input + size, size - anchor, 0, 0))
+			{
+				return 0;
+			}
+
+			return op - output;
+		}
+
+		// Copies 16 bytes at a time, writing up to 15 bytes past `output + size`
+		void wild_copy(uint8_t* output, const uint8_t* input, size_t size)
+		{
+			for (uint8_t* const end = output + size; output < end; output += 16, input += 16)
+			{
+				memcpy(output, input, 16);
+			}
+		}
+
+		// Decodes an LZ4 block of exactly `output_size` bytes, checking every length and offset.
+		// `output` must have room for `wild_copy_margin` bytes more.
+		bool decode(const uint8_t* input, size_t size, uint8_t* output, size_t output_size, std::span<const uint8_t> dictionary)
+		{
+			const uint8_t*       ip     = input;
+			const uint8_t* const ip_end = input + size;
+			uint8_t*             op     = output;
+			uint8_t* const       op_end = output + output_size;
+
+			while (ip < ip_end)
+			{
+				const uint8_t token = *ip++;
+
+				size_t literal_count = token >> 4;
+
+				if (literal_count == 15 && !read_length(ip, ip_end, literal_count))
+				{
+					return false;
+				}
+
+				if (literal_count > static_cast<size_t>(ip_end - ip) || literal_count > static_cast<size_t>(op_end - op))
+				{
+					return false;
+				}
+
+				if (literal_count < 16 && ip_end - ip >= 16)
+				{
+					memcpy(op, ip, 16);
+				}
+				else
+				{
+					memcpy(op, ip, literal_count);
+				}
+
+				ip += literal_count;
+				op += literal_count;
+
+				if (ip == ip_end)
+				{
+					return op == op_end;
+				}
+
+				if (ip_end - ip < 2)
+				{
+					return false;
+				}
+
+				const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+				ip += 2;
+
+				size_t length = token & 15;
+
+				if (length == 15 && !read_length(ip, ip_end, length))
+				{
+					return false;
+				}
+
+				length += min_match;
+
+				if (!offset || length > static_cast<size_t>(op_end - op))
+				{
+					return false;
+				}
+
+				const size_t produced = op - output;
+
+				if (offset > produced)
+				{
+					const size_t back = offset - produced;
+
+					if (back > dictionary.size())
+					{
+						return false;
+					}
+
+					const size_t count = std::min(back, length);
+					memcpy(op, dictionary.data() + dictionary.size() - back, count);
+
+					op += count;
+					length -= count;
+				}
+
+				const uint8_t* match = op - offset;
+
+				if (offset >= 16)
+				{
+					wild_copy(op, match, length);
+					op += length;
+				}
+				else
+				{
+					// Overlapping matches repeat the last `offset` bytes.
+					for (; offset >= 8 && length >= 8; length -= 8)
+					{
+						memcpy(op, match, 8);
+						op += 8;
+						match += 8;
+					}
+
+					while (length--)
+					{
+						*op++ = *match++;
+					}
+				}
+			}
+
+			return false;
+		}
+	}
+
+	Compressor::Compressor(size_t threshold)
+		: threshold_(threshold),
+		  table_(std::make_unique_for_overwrite<uint32_t[]>(table_entries))
+	{
+	}
+
+	Compressor::Compressor(std::span<const uint8_t> dictionary, size_t threshold)
+		: Compressor(threshold)
+	{
+		Compressor::dictionary(dictionary);
+	}
+
+	Compressor::Compressor(const Compressor& other)
+		: Compressor(other.threshold_)
+	{
+		dictionary_ = other.dictionary_;
+
+		if (other.dictionary_table_)
+		{
+			dictionary_table_ = std::make_unique_for_overwrite<uint32_t[]>(table_entries);
+			std::copy_n(other.dictionary_table_.get(), table_entries, dictionary_table_.get());
+		}
+	}
+
+	Compressor::~Compressor() = default;
+
+	Compressor& Compressor::operator=(const Compressor& other)
+	{
+		if (this != &other)
+		{
+			*this = Compressor(other);
+		}
+
+		return *this;
+	}
+
+	size_t Compressor::threshold() const
+	{
+		return threshold_;
+	}
+
+	void Compressor::threshold(size_t value)
+	{
+		threshold_ = value;
+	}
+
+	std::span<const uint8_t> Compressor::dictionary() const
+	{
+		return dictionary_;
+	}
+
+	void Compressor::dictionary(std::span<const uint8_t> value)
+	{
+		if (value.size() > max_dictionary_size)
+		{
+			value = value.last(max_dictionary_size);
+		}
+
+		dictionary_.assign(value.begin(), value.end());
+		dictionary_table_.reset();
+
+		if (dictionary_.size() < min_match)
+		{
+			return;
+		}
+
+		dictionary_table_ = std::make_unique<uint32_t[]>(table_entries);
+
+		// Later positions overwrite earlier ones, so matches prefer the nearest (cheapest) offset.
+		for (size_t i = 0; i + min_match <= dictionary_.size(); ++i)
+		{
+			dictionary_table_[hash(read32(&dictionary_[i]), max_hash_log)] = static_cast<uint32_t>(i);
+		}
+	}
+
+	bool Compressor::compress(const Packet& source, Packet& destination)
+	{
+		enforce(&source != &destination, "Cannot compress a packet into itself.");
+
+		const size_t         size  = source.work_size();
+		const uint8_t* const input = source.data_.data() + sizeof(packetlen_t);
+
+		destination.clear();
+
+		// The compressed payload is only worth sending if it is smaller than the payload stored as is.
+		if (size >= threshold_ && size > header_size)
+		{
+			if (!table_)
+			{
+				table_ = std::make_unique_for_overwrite<uint32_t[]>(table_entries);
+			}
+
+			const size_t capacity = size - header_size;
+			destination.data_.reserve(sizeof(packetlen_t) + header_size + capacity + wild_copy_margin);
+			destination.resize(sizeof(packetlen_t) + header_size + capacity);
+
+			uint8_t* const output = destination.data_.data() + sizeof(packetlen_t);
+			const size_t   block  = encode(input, size, dictionary_, dictionary_table_.get(), table_.get(), output + header_size, capacity);
+
+			if (block)
+			{
+				auto flags = CompressionFlags::compressed;
+
+				if (!dictionary_.empty())
+				{
+					flags = flags | CompressionFlags::dictionary;
+				}
+
+				const auto original = static_cast<uint16_t>(size);
+
+				output[0] = static_cast<uint8_t>(flags);
+				memcpy(output + 1, &original, sizeof(original));
+
+				destination.resize(sizeof(packetlen_t) + header_size + block);
+				destination.seek(SeekCursor::write, SeekType::from_end, 0);
+				return true;
+			}
+
+			destination.clear();
+		}
+
+		enforce(size < Socket::datagram_size - sizeof(packetlen_t), "Packet is too large to store with a compression flag.");
+
+		destination << static_cast<uint8_t>(CompressionFlags::none);
+		destination.write_data(input, size, true);
+		return false;
+	}
+
+	bool Compressor::decompress(const Packet& source, Packet& destination) const
+	{
+		enforce(&source != &destination, "Cannot decompress a packet into itself.");
+
+		destination.clear();
+
+		const size_t size = source.work_size();
+
+		if (!size)
+		{
+			return false;
+		}
+
+		const uint8_t* const input = source.data_.data() + sizeof(packetlen_t);
+		const auto           flags = static_cast<CompressionFlags>(input[0]);
+
+		if (input[0] & ~static_cast<uint8_t>(CompressionFlags::compressed | CompressionFlags::dictionary))
+		{
+			return false;
+		}
+
+		if (!any(flags & CompressionFlags::compressed))
+		{
+			destination.write_data(input + 1, size - 1, true);
+			return true;
+		}
+
+		const bool with_dictionary = any(flags & CompressionFlags::dictionary);
+
+		if (size < header_size || (with_dictionary && dictionary_.empty()))
+		{
+			return false;
+		}
+
+		uint16_t original;
+		memcpy(&original, input + 1, sizeof(original));
+
+		if (original > Socket::datagram_size - sizeof(packetlen_t))
+		{
+			return false;
+		}
+
+		destination.data_.reserve(sizeof(packetlen_t) + original + wild_copy_margin);
+		destination.resize(sizeof(packetlen_t) + original);
+
+		if (!decode(input + header_size, size - header_size, destination.data_.data() + sizeof(packetlen_t), original,
+		            with_dictionary ? std::span<const uint8_t>(dictionary_) : std::span<const uint8_t>()))
+		{
+			destination.clear();
+			return false;
+		}
+
+		destination.seek(SeekCursor::write, SeekType::from_end, 0);
+		return true;
+	}
+
+	bool Compressor::is_compressed(const Packet& packet)
+	{
+		return !packet.empty() &&
+		       any(static_cast<CompressionFlags>(packet.data()[sizeof(packetlen_t)]) & CompressionFlags::compressed);
+	}
+
+	std::vector<uint8_t> Compressor::train(std::span<const Packet> samples, size_t size)
+	{
+		constexpr size_t gram_size    = 8;
+		constexpr size_t segment_size = 32;
+		constexpr size_t segment_step = 8;
+
+		size = std::min(size, max_dictionary_size);
+
+		// Number of samples each 8-byte sequence occurs in.
+		std::unordered_map<uint64_t, uint32_t> counts;
+
+		{
+			std::unordered_set<uint64_t> seen;
+
+			for (const Packet& sample : samples)
+			{
+				const uint8_t* const data = sample.data().data() + sizeof(packetlen_t);
+				seen.clear();
+
+				for (size_t i = 0; i + gram_size <= sample.work_size(); ++i)
+				{
+					seen.insert(read64(data + i));
+				}
+
+				for (const uint64_t gram : seen)
+				{
+					++counts[gram];
+				}
+			}
+		}
+
+		struct Segment
+		{
+			const uint8_t* data;
+			size_t         size;
+		};
+
+		std::vector<Segment> segments;
+
+		for (const Packet& sample : samples)
+		{
+			const uint8_t* const data        = sample.data().data() + sizeof(packetlen_t);
+			const size_t         sample_size = sample.work_size();
+
+			for (size_t i = 0; i + gram_size <= sample_size; i += segment_step)
+			{
+				segments.push_back({ data + i, std::min(segment_size, sample_size - i) });
+
+				if (i + segment_size >= sample_size)
+				{
+					break;
+				}
+			}
+		}
+
+		// Sequences only found in one sample are of no use to any other payload.
+		const auto score = [&](const Segment& segment)
+		{
+			uint64_t result = 0;
+
+			for (size_t i = 0; i + gram_size <= segment.size; ++i)
+			{
+				const auto it = counts.find(read64(segment.data + i));
+
+				if (it != counts.end() && it->second > 1)
+				{
+					result += it->second;
+				}
+			}
+
+			return result;
+		};
+
+		// Scores only ever fall as sequences are covered, so a segment whose score is
+		// still current when it reaches the top of the queue is the best remaining one.
+		std::priority_queue<std::pair<uint64_t, size_t>> queue;
+
+		for (size_t i = 0; i < segments.size(); ++i)
+		{
+			queue.emplace(score(segments[i]), i);
+		}
+
+		std::vector<size_t> chosen;
+		size_t              total = 0;
+
+		while (!queue.empty() && total < size)
+		{
+			const auto [last_score, index] = queue.top();
+			queue.pop();
+
+			if (!last_score)
+			{
+				break;
+			}
+
+			const uint64_t current = score(segments[index]);
+
+			if (current < last_score)
+			{
+				queue.emplace(current, index);
+				continue;
+			}
+
+			const Segment& segment = segments[index];
+
+			for (size_t i = 0; i + gram_size <= segment.size; ++i)
+			{
+				counts.erase(read64(segment.data + i));
+			}
+
+			chosen.push_back(index);
+			total += segment.size;
+		}
+
+		std::vector<uint8_t> dictionary;
+		dictionary.reserve(total);
+
+		// The best segments go last, closest to the payloads that refer to them.
+		for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+		{
+			dictionary.insert(dictionary.end(), segments[*it].data, segments[*it].data + segments[*it].size);
+		}
+
+		if (dictionary.size() > size)
+		{
+			dictionary.erase(dictionary.begin(), dictionary.begin() + static_cast<ptrdiff_t>(dictionary.size() - size));
+		}
+
+		return dictionary;
+	}
+}
@@ -0,0 +1,254 @@
+#include "../include/sws/Crc32c.h"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SWS_CRC32C_X64
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SWS_CRC32C_TARGET
+#else
+#include <cpuid.h>
+#define SWS_CRC32C_TARGET __attribute__((target("sse4.2,pclmul")))
+#endif
+
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+namespace sws
+{
+	namespace
+	{
+		// Reflected CRC32C polynomial.
+		constexpr uint32_t polynomial = 0x82F63B78;
+
+		using Table = std::array<std::array<uint32_t, 256>, 8>;
+
+		consteval Table make_table()
+		{
+			Table table {};
+
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t crc = i;
+
+				for (int bit = 0; bit < 8; ++bit)
+				{
+					crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+				}
+
+				table[0][i] = crc;
+			}
+
+			for (size_t k = 1; k < table.size(); ++k)
+			{
+				for (uint32_t i = 0; i < 256; ++i)
+				{
+					table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+				}
+			}
+
+			return table;
+		}
+
+		// table[k][i] is the CRC of byte i followed by k zero bytes, so 8 bytes are folded in at once.
+		constexpr Table table = make_table();
+
+		uint64_t read64(const uint8_t* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint32_t update_portable(uint32_t state, const uint8_t* data, size_t size)
+		{
+			for (; size && (reinterpret_cast<uintptr_t>(data) & 7); --size)
+			{
+				state = (state >> 8) ^ table[0][(state ^ *data++) & 0xFF];
+			}
+
+			for (; size >= 8; size -= 8, data += 8)
+			{
+				const uint64_t word = read64(data);
+				const uint32_t low  = static_cast<uint32_t>(word) ^ state;
+				const uint32_t high = static_cast<uint32_t>(word >> 32);
+
+				state = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+				        table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+			}
+
+			for (; size; --size)
+			{
+				state = (state >> 8) ^ table[0][(state ^ *data++) & 0xFF];
+			}
+
+			return state;
+		}
+
+#ifdef SWS_CRC32C_X64
+		// Bytes per stream when checksumming three streams at once.
+		constexpr size_t long_block  = 1024;
+		constexpr size_t short_block = 128;
+
+		// x^(8 * bytes - 33) mod P, reflected. Carry-less multiplying a CRC by this and reducing
+		// the product with the crc32 instruction (which multiplies by x^32, and the reflected
+		// product carries another x) advances the CRC past `bytes` zeros.
+		uint32_t shift_constant(size_t bytes)
+		{
+			uint32_t value = 0x80000000; // x^0
+
+			for (size_t i = 0; i < 8 * bytes - 33; ++i)
+			{
+				value = (value >> 1) ^ ((value & 1) ? polynomial : 0);
+			}
+
+			return value;
+		}
+
+		struct Hardware
+		{
+			bool crc32  = false;
+			bool clmul  = false;
+
+			uint32_t long_shift_2  = 0;
+			uint32_t long_shift_1  = 0;
+			uint32_t short_shift_2 = 0;
+			uint32_t short_shift_1 = 0;
+		};
+
+		const Hardware& hardware()
+		{
+			static const Hardware result = []
+			{
+				Hardware value;
+
+#ifdef _MSC_VER
+				int info[4] {};
+				__cpuid(info, 1);
+				const auto ecx = static_cast<unsigned>(info[2]);
+#else
+				unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+				__get_cpuid(1, &eax, &ebx, &ecx, &edx);
+#endif
+
+				value.crc32 = ecx & (1u << 20);
+				value.clmul = value.crc32 && (ecx & (1u << 1));
+
+				if (value.clmul)
+				{
+					value.long_shift_2  = shift_constant(2 * long_block);
+					value.long_shift_1  = shift_constant(long_block);
+					value.short_shift_2 = shift_constant(2 * short_block);
+					value.short_shift_1 = shift_constant(short_block);
+				}
+
+				return value;
+			}();
+
+			return result;
+		}
+
+		SWS_CRC32C_TARGET uint32_t shift(uint32_t crc, uint32_t constant)
+		{
+			const __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+			                                             _mm_cvtsi32_si128(static_cast<int>(constant)), 0);
+
+			return static_cast<uint32_t>(_mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(product))));
+		}
+
+		// The crc32 instruction has a latency of three cycles but can start one per cycle,
+		// so three independent streams keep it busy. Their CRCs are then combined.
+		template <size_t Block>
+		SWS_CRC32C_TARGET uint32_t update_streams(uint32_t state, const uint8_t*& data, size_t& size, uint32_t shift_2, uint32_t shift_1)
+		{
+			for (; size >= 3 * Block; size -= 3 * Block, data += 3 * Block)
+			{
+				uint64_t a = state;
+				uint64_t b = 0;
+				uint64_t c = 0;
+
+				for (size_t i = 0; i < Block; i += 8)
+				{
+					a = _mm_crc32_u64(a, read64(data + i));
+					b = _mm_crc32_u64(b, read64(data + Block + i));
+					c = _mm_crc32_u64(c, read64(data + 2 * Block + i));
+				}
+
+				state = shift(static_cast<uint32_t>(a), shift_2) ^ shift(static_cast<uint32_t>(b), shift_1) ^ static_cast<uint32_t>(c);
+			}
+
+			return state;
+		}
+
+		// Unaligned loads cost next to nothing, so unlike the table version this does not align first.
+		SWS_CRC32C_TARGET uint32_t update_hardware(uint32_t state, const uint8_t* data, size_t size, const Hardware& hw)
+		{
+			if (hw.clmul)
+			{
+				state = update_streams<long_block>(state, data, size, hw.long_shift_2, hw.long_shift_1);
+				state = update_streams<short_block>(state, data, size, hw.short_shift_2, hw.short_shift_1);
+			}
+
+			uint64_t wide = state;
+
+			for (; size >= 8; size -= 8, data += 8)
+			{
+				wide = _mm_crc32_u64(wide, read64(data));
+			}
+
+			state = static_cast<uint32_t>(wide);
+
+			if (size & 4)
+			{
+				uint32_t word;
+				memcpy(&word, data, sizeof(word));
+				state = _mm_crc32_u32(state, word);
+				data += 4;
+			}
+
+			if (size & 2)
+			{
+				uint16_t word;
+				memcpy(&word, data, sizeof(word));
+				state = _mm_crc32_u16(state, word);
+				data += 2;
+			}
+
+			if (size & 1)
+			{
+				state = _mm_crc32_u8(state, *data);
+			}
+
+			return state;
+		}
+#endif
+	}
+
+	uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc)
+	{
+		const uint32_t state = ~crc;
+
+#ifdef SWS_CRC32C_X64
+		if (const Hardware& hw = hardware(); hw.crc32)
+		{
+			return ~update_hardware(state, data.data(), data.size(), hw);
+		}
+#endif
+
+		return ~update_portable(state, data.data(), data.size());
+	}
+
+	bool crc32c_accelerated()
+	{
+#ifdef SWS_CRC32C_X64
+		return hardware().crc32;
+#else
+		return false;
+#endif
+	}
+}
@@ -0,0 +1,430 @@
+#include "../include/sws/Delta.h"
+#include "../include/sws/enforce.h"
+#include "../include/sws/Socket.h"
+#include "../include/sws/typedefs.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SWS_DELTA_SSE2
+#endif
+
+namespace sws
+{
+	namespace
+	{
+		// Each run costs at least two bytes of lengths, so shorter unchanged gaps are sent as part of the change.
+		constexpr size_t min_gap = 4;
+
+		// Largest encoding of a length.
+		constexpr size_t max_varint_size = 3;
+
+		// Both snapshots sent whole and deltas start with the snapshot's and the baseline's sequence numbers.
+		constexpr size_t header_size = 2 * sizeof(uint32_t);
+
+		uint8_t* write_varint(uint8_t* output, size_t value)
+		{
+			while (value >= 0x80)
+			{
+				*output++ = static_cast<uint8_t>(value | 0x80);
+				value >>= 7;
+			}
+
+			*output++ = static_cast<uint8_t>(value);
+			return output;
+		}
+
+		bool read_varint(const uint8_t*& input, const uint8_t* input_end, size_t& value)
+		{
+			value = 0;
+
+			for (size_t i = 0; i < max_varint_size; ++i)
+			{
+				if (input == input_end)
+				{
+					return false;
+				}
+
+				const uint8_t byte = *input++;
+				value |= static_cast<size_t>(byte & 0x7F) << (7 * i);
+
+				if (!(byte & 0x80))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		// Finds the first index from `i` at which `a` and `b` differ, or `size` if there is none.
+		size_t find_mismatch(const uint8_t* a, const uint8_t* b, size_t i, size_t size)
+		{
+#ifdef SWS_DELTA_SSE2
+			// Unchanged spans are the common case, so they are skipped 64 bytes at a time.
+			for (; i + 64 <= size; i += 64)
+			{
+				const auto load = [](const uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); };
+
+				const __m128i eq0 = _mm_cmpeq_epi8(load(a + i), load(b + i));
+				const __m128i eq1 = _mm_cmpeq_epi8(load(a + i + 16), load(b + i + 16));
+				const __m128i eq2 = _mm_cmpeq_epi8(load(a + i + 32), load(b + i + 32));
+				const __m128i eq3 = _mm_cmpeq_epi8(load(a + i + 48), load(b + i + 48));
+
+				if (_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(eq0, eq1), _mm_and_si128(eq2, eq3))) != 0xFFFF)
+				{
+					break;
+				}
+			}
+
+			for (; i + 16 <= size; i += 16)
+			{
+				const __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+				                                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+
+				if (const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(eq)) & 0xFFFF)
+				{
+					return i + std::countr_zero(mask);
+				}
+			}
+#else
+			for (; i + 8 <= size; i += 8)
+			{
+				uint64_t x, y;
+				memcpy(&x, a + i, sizeof(x));
+				memcpy(&y, b + i, sizeof(y));
+
+				if (x != y)
+				{
+					break;
+				}
+			}
+#endif
+
+			for (; i < size; ++i)
+			{
+				if (a[i] != b[i])
+				{
+					return i;
+				}
+			}
+
+			return size;
+		}
+
+		// Finds the first index from `i` at which `a` and `b` are equal, or `size` if there is none.
+		size_t find_match(const uint8_t* a, const uint8_t* b, size_t i, size_t size)
+		{
+#ifdef SWS_DELTA_SSE2
+			for (; i + 16 <= size; i += 16)
+			{
+				const __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+				                                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+
+				if (const int mask = _mm_movemask_epi8(eq))
+				{
+					return i + std::countr_zero(static_cast<unsigned>(mask));
+				}
+			}
+#endif
+
+			for (; i < size; ++i)
+			{
+				if (a[i] == b[i])
+				{
+					return i;
+				}
+			}
+
+			return size;
+		}
+
+		const uint8_t* payload(const Packet& packet)
+		{
+			return packet.data().data() + sizeof(packetlen_t);
+		}
+	}
+
+	bool delta_encode(const Packet& baseline, const Packet& current, Packet& delta)
+	{
+		enforce(&current != &delta && &baseline != &delta, "Cannot encode a delta into one of its inputs.");
+
+		const uint8_t* const base      = payload(baseline);
+		const uint8_t* const data      = payload(current);
+		const size_t         base_size = baseline.work_size();
+		const size_t         size      = current.work_size();
+		const size_t         common    = std::min(base_size, size);
+
+		// Runs are separated by at least `min_gap` unchanged bytes, which bounds their number.
+		const size_t bound = max_varint_size + size + (size / (min_gap + 1) + 1) * 2 * max_varint_size;
+
+		const size_t start    = delta.write_pos_;
+		const size_t capacity = std::min(Socket::datagram_size, start + bound);
+
+		if (start >= capacity)
+		{
+			return false;
+		}
+
+		const size_t old_size = delta.data_.size();
+		delta.data_.resize(std::max(old_size, capacity));
+
+		uint8_t*             op     = delta.data_.data() + start;
+		const uint8_t* const op_end = delta.data_.data() + capacity;
+
+		const auto emit = [&](size_t keep, const uint8_t* literals, size_t literal_count)
+		{
+			if (static_cast<size_t>(op_end - op) < 2 * max_varint_size + literal_count)
+			{
+				return false;
+			}
+
+			op = write_varint(op, keep);
+			op = write_varint(op, literal_count);
+
+			memcpy(op, literals, literal_count);
+			op += literal_count;
+			return true;
+		};
+
+		bool fits = static_cast<size_t>(op_end - op) >= max_varint_size;
+
+		if (fits)
+		{
+			op = write_varint(op, size);
+		}
+
+		for (size_t position = 0; fits && position < size;)
+		{
+			const size_t first = find_mismatch(base, data, position, common);
+
+			if (first == common)
+			{
+				// Everything past the baseline is new.
+				fits = emit(common - position, data + common, size - common);
+				break;
+			}
+
+			// Extend the change until it is followed by a long enough unchanged gap.
+			size_t last = first;
+
+			while (true)
+			{
+				last = find_match(base, data, last, common);
+
+				if (last == common)
+				{
+					last = size;
+					break;
+				}
+
+				const size_t next = find_mismatch(base, data, last, common);
+
+				if (next - last >= min_gap)
+				{
+					break;
+				}
+
+				last = next;
+			}
+
+			fits = emit(first - position, data + first, last - first);
+			position = last;
+		}
+
+		if (!fits)
+		{
+			delta.data_.resize(old_size);
+			return false;
+		}
+
+		const size_t end = op - delta.data_.data();
+
+		delta.data_.resize(std::max(old_size, end));
+		delta.write_pos_ = static_cast<ptrdiff_t>(end);
+		delta.update_size();
+		return true;
+	}
+
+	bool delta_apply(const Packet& baseline, Packet& delta, Packet& result)
+	{
+		enforce(&result != &delta && &result != &baseline, "Cannot apply a delta into one of its inputs.");
+
+		result.clear();
+
+		const uint8_t* const base      = payload(baseline);
+		const size_t         base_size = baseline.work_size();
+
+		const uint8_t*       ip     = delta.data_.data() + delta.read_pos_;
+		const uint8_t* const ip_end = delta.data_.data() + delta.real_size();
+
+		size_t size;
+
+		if (!read_varint(ip, ip_end, size) || size > Socket::datagram_size - sizeof(packetlen_t))
+		{
+			return false;
+		}
+
+		result.resize(sizeof(packetlen_t) + size);
+
+		uint8_t* const output = result.data_.data() + sizeof(packetlen_t);
+
+		for (size_t position = 0; position < size;)
+		{
+			size_t keep;
+			size_t literal_count;
+
+			if (!read_varint(ip, ip_end, keep) || !read_varint(ip, ip_end, literal_count) ||
+			    (!keep && !literal_count) || keep > size - position || position + keep > base_size ||
+			    literal_count > size - position - keep || literal_count > static_cast<size_t>(ip_end - ip))
+			{
+				result.clear();
+				return false;
+			}
+
+			memcpy(output + position, base + position, keep);
+			position += keep;
+
+			memcpy(output + position, ip, literal_count);
+			position += literal_count;
+			ip += literal_count;
+		}
+
+		delta.read_pos_ = ip - delta.data_.data();
+		result.seek(SeekCursor::write, SeekType::from_end, 0);
+		return true;
+	}
+
+	DeltaEncoder::DeltaEncoder(size_t history)
+		: history_(std::max<size_t>(1, history))
+	{
+	}
+
+	uint32_t DeltaEncoder::encode(const Packet& snapshot, Packet& output)
+	{
+		const uint32_t sequence = next_sequence_++;
+
+		output.clear();
+		output << sequence;
+
+		const Snapshot* baseline = acknowledged_ ? find(*acknowledged_) : nullptr;
+		bool            encoded  = false;
+
+		if (baseline)
+		{
+			delta_.clear();
+			encoded = delta_encode(baseline->packet, snapshot, delta_) && delta_.work_size() < snapshot.work_size();
+		}
+
+		if (encoded)
+		{
+			output << baseline->sequence << delta_;
+		}
+		else
+		{
+			enforce(snapshot.work_size() + header_size <= Socket::datagram_size - sizeof(packetlen_t),
+			        "Snapshot is too large to send with a delta header.");
+
+			output << sequence << snapshot;
+		}
+
+		Snapshot& entry = history_[sequence % history_.size()];
+		entry.sequence  = sequence;
+		entry.valid     = true;
+		entry.packet    = snapshot;
+
+		return sequence;
+	}
+
+	void DeltaEncoder::acknowledge(uint32_t sequence)
+	{
+		// Sequence numbers wrap, so compare their distance rather than their values.
+		if (acknowledged_ && static_cast<int32_t>(sequence - *acknowledged_) <= 0)
+		{
+			return;
+		}
+
+		if (find(sequence))
+		{
+			acknowledged_ = sequence;
+		}
+	}
+
+	std::optional<uint32_t> DeltaEncoder::baseline() const
+	{
+		if (acknowledged_ && find(*acknowledged_))
+		{
+			return acknowledged_;
+		}
+
+		return std::nullopt;
+	}
+
+	void DeltaEncoder::reset()
+	{
+		for (Snapshot& entry : history_)
+		{
+			entry.valid = false;
+			entry.packet.clear();
+		}
+
+		acknowledged_.reset();
+	}
+
+	const DeltaEncoder::Snapshot* DeltaEncoder::find(uint32_t sequence) const
+	{
+		const Snapshot& entry = history_[sequence % history_.size()];
+		return entry.valid && entry.sequence == sequence ? &entry : nullptr;
+	}
+
+	DeltaDecoder::DeltaDecoder(size_t history)
+		: history_(std::max<size_t>(1, history))
+	{
+	}
+
+	bool DeltaDecoder::decode(Packet& input, Packet& snapshot, uint32_t& sequence)
+	{
+		uint32_t baseline_sequence;
+
+		if (!input.read(sequence) || !input.read(baseline_sequence))
+		{
+			return false;
+		}
+
+		Snapshot& entry = history_[sequence % history_.size()];
+
+		if (baseline_sequence == sequence)
+		{
+			snapshot.clear();
+			snapshot.write_data(payload(input) + input.tell(SeekCursor::read), input.work_size() - input.tell(SeekCursor::read), true);
+			input.seek(SeekCursor::read, SeekType::from_end, 0);
+		}
+		else
+		{
+			const Snapshot& baseline = history_[baseline_sequence % history_.size()];
+
+			if (!baseline.valid || baseline.sequence != baseline_sequence ||
+			    !delta_apply(baseline.packet, input, snapshot))
+			{
+				return false;
+			}
+		}
+
+		entry.sequence = sequence;
+		entry.valid    = true;
+		entry.packet   = snapshot;
+		return true;
+	}
+
+	void DeltaDecoder::reset()
+	{
+		for (Snapshot& entry : history_)
+		{
+			entry.valid = false;
+			entry.packet.clear();
+		}
+	}
+}
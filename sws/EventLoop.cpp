@@ -0,0 +1,422 @@
+#include "../include/sws/EventLoop.h"
+#include "../include/sws/enforce.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+
+namespace sws
+{
+	EventLoop::EventLoop()
+		: waker_(false)
+	{
+		// The waker is a UDP socket connected to itself; a datagram sent to it
+		// from any thread makes a blocking poll return.
+		if (waker_.bind(Address("127.0.0.1", Socket::any_port, AddressFamily::inet)) != SocketState::done ||
+		    waker_.connect(waker_.local_address()) != SocketState::done)
+		{
+			throw SocketException("failed to initialize event loop waker", waker_.native_error());
+		}
+
+		add_native(waker_.socket_, PollEvents::read, [this](PollEvents)
+		{
+			drain_waker();
+		});
+	}
+
+	void EventLoop::add(const Socket& socket, PollEvents events, Handler handler)
+	{
+		enforce(socket.is_open(), "Cannot watch a socket which is not open.");
+		add_native(socket.socket_, events, std::move(handler));
+	}
+
+	void EventLoop::modify(const Socket& socket, PollEvents events)
+	{
+		const auto it = indices_.find(socket.socket_);
+		enforce(it != indices_.end(), "Socket is not being watched.");
+
+		descriptors_[it->second].events = to_native(events);
+	}
+
+	void EventLoop::remove(const Socket& socket)
+	{
+		const auto it = indices_.find(socket.socket_);
+
+		if (it == indices_.end())
+		{
+			return;
+		}
+
+		const size_t index = it->second;
+		indices_.erase(it);
+
+		entries_[index]->removed    = true;
+		descriptors_[index].events  = 0;
+		descriptors_[index].revents = 0;
+
+		if (!dispatching_)
+		{
+			compact();
+		}
+	}
+
+	void EventLoop::wait(const Socket& socket, PollEvents events, WaitCallback callback, void* context)
+	{
+		enforce(events == PollEvents::read || events == PollEvents::write, "Can only wait for read or write.");
+		enforce(callback != nullptr, "A wait callback is required.");
+
+		const auto it = indices_.find(socket.socket_);
+		size_t index;
+
+		if (it == indices_.end())
+		{
+			enforce(socket.is_open(), "Cannot wait on a socket which is not open.");
+			index = add_native(socket.socket_, PollEvents::none, nullptr);
+		}
+		else
+		{
+			index = it->second;
+		}
+
+		Entry& entry = *entries_[index];
+		enforce(!entry.handler, "Cannot wait on a socket which has a handler.");
+
+		Waiter& waiter = events == PollEvents::read ? entry.reader : entry.writer;
+		enforce(waiter.callback == nullptr, "Socket is already being waited on.");
+
+		waiter.callback = callback;
+		waiter.context  = context;
+
+		update_waits(index);
+	}
+
+	void EventLoop::cancel_wait(const Socket& socket, PollEvents events)
+	{
+		const auto it = indices_.find(socket.socket_);
+
+		if (it == indices_.end())
+		{
+			return;
+		}
+
+		Entry& entry = *entries_[it->second];
+
+		if (any(events & PollEvents::read))
+		{
+			entry.reader = {};
+		}
+
+		if (any(events & PollEvents::write))
+		{
+			entry.writer = {};
+		}
+
+		update_waits(it->second);
+	}
+
+	bool EventLoop::contains(const Socket& socket) const
+	{
+		return indices_.contains(socket.socket_);
+	}
+
+	TimerWheel& EventLoop::timers()
+	{
+		return timers_;
+	}
+
+	size_t EventLoop::poll(std::chrono::milliseconds timeout)
+	{
+		const auto expiry = timers_.next_expiry();
+
+		if (expiry != TimerWheel::clock::time_point::max())
+		{
+			const auto until_expiry = std::chrono::ceil<std::chrono::milliseconds>(expiry - TimerWheel::clock::now());
+			const auto timer_timeout = std::clamp(until_expiry, std::chrono::milliseconds(0),
+			                                      std::chrono::milliseconds(std::numeric_limits<int>::max()));
+
+			if (timeout.count() < 0 || timer_timeout < timeout)
+			{
+				timeout = timer_timeout;
+			}
+		}
+
+		// Left over from the last flush because the send buffer was full.
+		if (!corked_.empty() && (timeout.count() < 0 || timeout > std::chrono::milliseconds(1)))
+		{
+			timeout = std::chrono::milliseconds(1);
+		}
+
+		const int native_timeout = timeout.count() < 0 ? -1 : static_cast<int>(timeout.count());
+		const int result = WSAPoll(descriptors_.data(), static_cast<ULONG>(descriptors_.size()), native_timeout);
+
+		if (result == SOCKET_ERROR)
+		{
+			throw SocketException("WSAPoll failed", Socket::get_native_error());
+		}
+
+		const size_t dispatched = result ? dispatch() : 0;
+		const size_t fired = timers_.advance(TimerWheel::clock::now());
+
+		flush_corked();
+		return dispatched + fired;
+	}
+
+	size_t EventLoop::dispatch()
+	{
+		size_t dispatched = 0;
+
+		// Entries added by handlers are appended and not dispatched until the next poll.
+		const size_t count = descriptors_.size();
+		dispatching_ = true;
+
+		try
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				const short revents = descriptors_[i].revents;
+
+				if (!revents)
+				{
+					continue;
+				}
+
+				descriptors_[i].revents = 0;
+
+				Entry* entry = entries_[i].get();
+
+				if (entry->removed)
+				{
+					continue;
+				}
+
+				if (entry->handler)
+				{
+					entry->handler(from_native(revents));
+				}
+				else
+				{
+					dispatch_waiters(i, from_native(revents));
+				}
+
+				++dispatched;
+			}
+		}
+		catch (...)
+		{
+			dispatching_ = false;
+			compact();
+			throw;
+		}
+
+		dispatching_ = false;
+		compact();
+
+		return dispatched;
+	}
+
+	void EventLoop::run()
+	{
+		while (!stopping_.load(std::memory_order_acquire))
+		{
+			poll();
+		}
+
+		stopping_.store(false, std::memory_order_release);
+	}
+
+	void EventLoop::stop()
+	{
+		stopping_.store(true, std::memory_order_release);
+		wake();
+	}
+
+	void EventLoop::wake()
+	{
+		// Called from any thread, so the native send is used directly; going through
+		// the socket would update its single-writer statistics from several threads.
+		constexpr char signal = 0;
+		static_cast<void>(::send(waker_.socket_, &signal, sizeof(signal), 0));
+	}
+
+	size_t EventLoop::add_native(NativeSocket socket, PollEvents events, Handler handler)
+	{
+		enforce(!indices_.contains(socket), "Socket is already being watched.");
+
+		WSAPOLLFD descriptor {};
+		descriptor.fd     = socket;
+		descriptor.events = to_native(events);
+
+		auto entry = std::make_unique<Entry>();
+		entry->socket  = socket;
+		entry->handler = std::move(handler);
+
+		const size_t index = descriptors_.size();
+
+		indices_[socket] = index;
+		descriptors_.push_back(descriptor);
+		entries_.push_back(std::move(entry));
+
+		return index;
+	}
+
+	void EventLoop::dispatch_waiters(size_t index, PollEvents events)
+	{
+		Entry* entry = entries_[index].get();
+		const bool failed = any(events & PollEvents::error);
+
+		// Waits are one-shot; callbacks are detached before being invoked so they can wait again.
+		if (entry->reader.callback && (failed || any(events & PollEvents::read)))
+		{
+			const Waiter waiter = std::exchange(entry->reader, {});
+			update_waits(index);
+			waiter.callback(waiter.context, events);
+		}
+
+		if (entry->removed)
+		{
+			return;
+		}
+
+		if (entry->writer.callback && (failed || any(events & PollEvents::write)))
+		{
+			const Waiter waiter = std::exchange(entry->writer, {});
+			update_waits(index);
+			waiter.callback(waiter.context, events);
+		}
+	}
+
+	void EventLoop::update_waits(size_t index)
+	{
+		const Entry& entry = *entries_[index];
+		WSAPOLLFD& descriptor = descriptors_[index];
+
+		auto events = PollEvents::none;
+
+		if (entry.reader.callback)
+		{
+			events = events | PollEvents::read;
+		}
+
+		if (entry.writer.callback)
+		{
+			events = events | PollEvents::write;
+		}
+
+		// WSAPoll ignores negative descriptors. Without this, an idle socket
+		// which has been hung up would make every poll return immediately.
+		descriptor.fd     = any(events) ? entry.socket : INVALID_SOCKET;
+		descriptor.events = to_native(events);
+	}
+
+	void EventLoop::compact()
+	{
+		for (size_t i = 0; i < entries_.size();)
+		{
+			if (!entries_[i]->removed)
+			{
+				++i;
+				continue;
+			}
+
+			// swap-remove; the moved entry's index needs to be updated
+			const size_t last = entries_.size() - 1;
+
+			if (i != last)
+			{
+				descriptors_[i] = descriptors_[last];
+				entries_[i]     = std::move(entries_[last]);
+
+				indices_[entries_[i]->socket] = i;
+			}
+
+			descriptors_.pop_back();
+			entries_.pop_back();
+		}
+	}
+
+	void EventLoop::schedule_flush(Socket::Cork& cork)
+	{
+		cork.scheduled = true;
+		corked_.push_back(&cork);
+	}
+
+	void EventLoop::cancel_flush(Socket::Cork& cork)
+	{
+		const auto it = std::find(corked_.begin(), corked_.end(), &cork);
+
+		if (it != corked_.end())
+		{
+			*it = corked_.back();
+			corked_.pop_back();
+		}
+
+		cork.scheduled = false;
+	}
+
+	void EventLoop::flush_corked()
+	{
+		flushing_.swap(corked_);
+
+		for (Socket::Cork* cork : flushing_)
+		{
+			cork->scheduled = false;
+
+			// Still pending on would_block; retried on the next poll.
+			if (cork->owner->flush() == SocketState::in_progress)
+			{
+				schedule_flush(*cork);
+			}
+		}
+
+		flushing_.clear();
+	}
+
+	void EventLoop::drain_waker()
+	{
+		std::array<uint8_t, 64> buffer {};
+
+		while (waker_.receive(buffer) > 0)
+		{
+		}
+	}
+
+	short EventLoop::to_native(PollEvents events)
+	{
+		short result = 0;
+
+		if (any(events & PollEvents::read))
+		{
+			result |= POLLRDNORM;
+		}
+
+		if (any(events & PollEvents::write))
+		{
+			result |= POLLWRNORM;
+		}
+
+		return result;
+	}
+
+	PollEvents EventLoop::from_native(short events)
+	{
+		auto result = PollEvents::none;
+
+		if (events & POLLRDNORM)
+		{
+			result = result | PollEvents::read;
+		}
+
+		if (events & POLLWRNORM)
+		{
+			result = result | PollEvents::write;
+		}
+
+		if (events & (POLLERR | POLLHUP | POLLNVAL))
+		{
+			result = result | PollEvents::error;
+		}
+
+		return result;
+	}
+}
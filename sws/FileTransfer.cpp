@@ -0,0 +1,195 @@
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "../include/sws/FileTransfer.h"
+
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+namespace sws
+{
+	namespace
+	{
+		// Views must start on a multiple of the allocation granularity,
+		// which is 64 KiB on every version of Windows.
+		constexpr uint64_t view_alignment = 64 * 1024;
+
+		constexpr uint64_t max_view_size = 8 * 1024 * 1024;
+
+		[[noreturn]] void throw_last_error(const char* what)
+		{
+			throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+		}
+	}
+
+	FileTransfer::FileTransfer(const std::filesystem::path& path, uint64_t offset, uint64_t length)
+	{
+		file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		if (file_ == INVALID_HANDLE_VALUE)
+		{
+			throw_last_error("Failed to open file for transfer");
+		}
+
+		owns_file_ = true;
+		select(offset, length);
+	}
+
+	FileTransfer::FileTransfer(HANDLE file, uint64_t offset, uint64_t length)
+		: file_(file)
+	{
+		select(offset, length);
+	}
+
+	FileTransfer::FileTransfer(FileTransfer&& rhs) noexcept
+		: file_(std::exchange(rhs.file_, INVALID_HANDLE_VALUE)),
+		  owns_file_(std::exchange(rhs.owns_file_, false)),
+		  position_(std::exchange(rhs.position_, 0)),
+		  remaining_(std::exchange(rhs.remaining_, 0)),
+		  mapping_(std::exchange(rhs.mapping_, nullptr)),
+		  view_(std::exchange(rhs.view_, nullptr)),
+		  view_offset_(std::exchange(rhs.view_offset_, 0)),
+		  view_size_(std::exchange(rhs.view_size_, 0))
+	{
+	}
+
+	FileTransfer::~FileTransfer()
+	{
+		close();
+	}
+
+	FileTransfer& FileTransfer::operator=(FileTransfer&& rhs) noexcept
+	{
+		if (this != &rhs)
+		{
+			close();
+
+			file_        = std::exchange(rhs.file_, INVALID_HANDLE_VALUE);
+			owns_file_   = std::exchange(rhs.owns_file_, false);
+			position_    = std::exchange(rhs.position_, 0);
+			remaining_   = std::exchange(rhs.remaining_, 0);
+			mapping_     = std::exchange(rhs.mapping_, nullptr);
+			view_        = std::exchange(rhs.view_, nullptr);
+			view_offset_ = std::exchange(rhs.view_offset_, 0);
+			view_size_   = std::exchange(rhs.view_size_, 0);
+		}
+
+		return *this;
+	}
+
+	void FileTransfer::close() noexcept
+	{
+		unmap();
+
+		if (owns_file_ && file_ != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file_);
+		}
+
+		file_      = INVALID_HANDLE_VALUE;
+		owns_file_ = false;
+		position_  = 0;
+		remaining_ = 0;
+	}
+
+	bool FileTransfer::is_open() const
+	{
+		return file_ != INVALID_HANDLE_VALUE;
+	}
+
+	uint64_t FileTransfer::position() const
+	{
+		return position_;
+	}
+
+	uint64_t FileTransfer::remaining() const
+	{
+		return remaining_;
+	}
+
+	bool FileTransfer::done() const
+	{
+		return !remaining_;
+	}
+
+	void FileTransfer::select(uint64_t offset, uint64_t length)
+	{
+		LARGE_INTEGER size {};
+
+		if (!GetFileSizeEx(file_, &size))
+		{
+			const DWORD error = GetLastError();
+			close();
+			SetLastError(error);
+			throw_last_error("Failed to get size of file for transfer");
+		}
+
+		const auto file_size = static_cast<uint64_t>(size.QuadPart);
+
+		position_  = std::min(offset, file_size);
+		remaining_ = std::min(length, file_size - position_);
+	}
+
+	void FileTransfer::advance(uint64_t sent)
+	{
+		position_  += sent;
+		remaining_ -= sent;
+
+		if (!remaining_)
+		{
+			unmap();
+		}
+	}
+
+	void FileTransfer::unmap() noexcept
+	{
+		if (view_)
+		{
+			UnmapViewOfFile(view_);
+			view_ = nullptr;
+		}
+
+		if (mapping_)
+		{
+			CloseHandle(mapping_);
+			mapping_ = nullptr;
+		}
+
+		view_offset_ = 0;
+		view_size_   = 0;
+	}
+
+	bool FileTransfer::map()
+	{
+		if (view_ && position_ >= view_offset_ && position_ < view_offset_ + view_size_)
+		{
+			return true;
+		}
+
+		if (view_)
+		{
+			UnmapViewOfFile(view_);
+			view_ = nullptr;
+		}
+
+		if (!mapping_)
+		{
+			mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+			if (!mapping_)
+			{
+				return false;
+			}
+		}
+
+		view_offset_ = position_ - position_ % view_alignment;
+		view_size_   = static_cast<size_t>(std::min(max_view_size, position_ + remaining_ - view_offset_));
+
+		view_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, static_cast<DWORD>(view_offset_ >> 32),
+		                                                  static_cast<DWORD>(view_offset_), view_size_));
+
+		return view_ != nullptr;
+	}
+}
@@ -0,0 +1,232 @@
+#include "../include/sws/Handshake.h"
+#include "../include/sws/Packet.h"
+#include "../include/sws/UdpSocket.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace sws
+{
+	namespace
+	{
+		// Addresses as received are numeric, so they fit with room to spare.
+		constexpr size_t inline_message_size = 96;
+
+		uint64_t read64(const uint8_t* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		struct SipState
+		{
+			uint64_t v0, v1, v2, v3;
+
+			void round()
+			{
+				v0 += v1; v1 = std::rotl(v1, 13); v1 ^= v0; v0 = std::rotl(v0, 32);
+				v2 += v3; v3 = std::rotl(v3, 16); v3 ^= v2;
+				v0 += v3; v3 = std::rotl(v3, 21); v3 ^= v0;
+				v2 += v1; v1 = std::rotl(v1, 17); v1 ^= v2; v2 = std::rotl(v2, 32);
+			}
+
+			void compress(uint64_t word)
+			{
+				v3 ^= word;
+				round();
+				round();
+				v0 ^= word;
+			}
+		};
+
+		CookieHandshake::Key random_key()
+		{
+			std::random_device random;
+			CookieHandshake::Key key;
+
+			for (size_t i = 0; i < key.size(); i += sizeof(uint32_t))
+			{
+				const uint32_t value = random();
+				memcpy(key.data() + i, &value, sizeof(value));
+			}
+
+			return key;
+		}
+	}
+
+	uint64_t siphash24(const std::array<uint8_t, 16>& key, std::span<const uint8_t> data)
+	{
+		const uint64_t k0 = read64(key.data());
+		const uint64_t k1 = read64(key.data() + 8);
+
+		SipState state { k0 ^ 0x736F6D6570736575, k1 ^ 0x646F72616E646F6D, k0 ^ 0x6C7967656E657261, k1 ^ 0x7465646279746573 };
+
+		const uint8_t* input = data.data();
+		size_t         size  = data.size();
+
+		for (; size >= 8; size -= 8, input += 8)
+		{
+			state.compress(read64(input));
+		}
+
+		uint64_t last = static_cast<uint64_t>(data.size()) << 56;
+		memcpy(&last, input, size);
+		state.compress(last);
+
+		state.v2 ^= 0xFF;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			state.round();
+		}
+
+		return state.v0 ^ state.v1 ^ state.v2 ^ state.v3;
+	}
+
+	CookieHandshake::CookieHandshake(clock::duration lifetime)
+		: CookieHandshake(random_key(), lifetime)
+	{
+	}
+
+	CookieHandshake::CookieHandshake(const Key& key, clock::duration lifetime)
+		: key_(key),
+		  lifetime_(std::max<clock::duration>(lifetime, clock::duration(1)))
+	{
+	}
+
+	uint64_t CookieHandshake::cookie(const Address& address, clock::time_point now) const
+	{
+		return compute(address, slot(now));
+	}
+
+	bool CookieHandshake::verify(const Address& address, uint64_t cookie, clock::time_point now) const
+	{
+		uint64_t issued = slot(now);
+
+		// A cookie issued just before the slot changed is still accepted. Its lowest bit
+		// tells which of the two slots it was issued in, so only one hash is computed.
+		if ((cookie & 1) != (issued & 1))
+		{
+			--issued;
+		}
+
+		return cookie == compute(address, issued);
+	}
+
+	HandshakeResult CookieHandshake::admit(UdpSocket& socket, Packet& packet, const Address& address)
+	{
+		const ptrdiff_t start = packet.tell(SeekCursor::read);
+
+		uint32_t magic  = 0;
+		uint64_t echoed = 0;
+
+		if (!packet.read(magic) || magic != hello_magic || !packet.read(echoed))
+		{
+			packet.seek(SeekCursor::read, SeekType::from_start, start);
+			++rejected_;
+			return HandshakeResult::rejected;
+		}
+
+		const clock::time_point now = clock::now();
+
+		if (echoed && verify(address, echoed, now))
+		{
+			++accepted_;
+			return HandshakeResult::accepted;
+		}
+
+		// The challenge is the same size as a hello without application data, so it never amplifies.
+		Packet challenge;
+		challenge << challenge_magic << cookie(address, now);
+
+		static_cast<void>(socket.send_to(challenge, address));
+
+		++challenged_;
+		return HandshakeResult::challenged;
+	}
+
+	void CookieHandshake::rekey()
+	{
+		key_ = random_key();
+	}
+
+	uint64_t CookieHandshake::accepted() const
+	{
+		return accepted_;
+	}
+
+	uint64_t CookieHandshake::challenged() const
+	{
+		return challenged_;
+	}
+
+	uint64_t CookieHandshake::rejected() const
+	{
+		return rejected_;
+	}
+
+	void CookieHandshake::write_hello(Packet& packet, uint64_t cookie)
+	{
+		packet << hello_magic << cookie;
+	}
+
+	bool CookieHandshake::read_challenge(Packet& packet, uint64_t& cookie)
+	{
+		const ptrdiff_t start = packet.tell(SeekCursor::read);
+
+		uint32_t magic = 0;
+		uint64_t value = 0;
+
+		if (!packet.read(magic) || magic != challenge_magic || !packet.read(value))
+		{
+			packet.seek(SeekCursor::read, SeekType::from_start, start);
+			return false;
+		}
+
+		cookie = value;
+		return true;
+	}
+
+	uint64_t CookieHandshake::compute(const Address& address, uint64_t slot) const
+	{
+		// slot, port, family, then the address as text.
+		const size_t size = sizeof(slot) + sizeof(address.port) + 1 + address.address.size();
+
+		std::array<uint8_t, inline_message_size> inline_message;
+		std::vector<uint8_t>                     heap_message;
+
+		uint8_t* message = inline_message.data();
+
+		if (size > inline_message.size())
+		{
+			heap_message.resize(size);
+			message = heap_message.data();
+		}
+
+		uint8_t* output = message;
+
+		memcpy(output, &slot, sizeof(slot));
+		output += sizeof(slot);
+
+		memcpy(output, &address.port, sizeof(address.port));
+		output += sizeof(address.port);
+
+		*output++ = static_cast<uint8_t>(address.family);
+
+		memcpy(output, address.address.data(), address.address.size());
+
+		const uint64_t result = (siphash24(key_, std::span<const uint8_t>(message, size)) & ~uint64_t { 1 }) | (slot & 1);
+
+		// Zero means "no cookie" in a hello.
+		return result ? result : 2;
+	}
+
+	uint64_t CookieHandshake::slot(clock::time_point now) const
+	{
+		return static_cast<uint64_t>(now.time_since_epoch() / lifetime_);
+	}
+}
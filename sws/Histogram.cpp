@@ -0,0 +1,276 @@
+#include "../include/sws/Histogram.h"
+#include "../include/sws/ConcurrentQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+
+#include "thread_shards.h"
+
+namespace sws
+{
+	namespace
+	{
+		constexpr size_t   half_bucket = size_t(1) << (Histogram::precision_bits - 1);
+		constexpr uint64_t exact_limit = uint64_t(1) << Histogram::precision_bits;
+
+		// Single writer: a relaxed load and store is enough and avoids a locked add.
+		void increment(std::atomic<uint64_t>& value, uint64_t amount)
+		{
+			value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+
+		struct MetricShard
+		{
+			std::array<std::atomic<uint64_t>, Histogram::bucket_count> counts {};
+
+			std::atomic<uint64_t> sum = 0;
+			std::atomic<uint64_t> min = UINT64_MAX;
+			std::atomic<uint64_t> max = 0;
+
+			void merge(const MetricShard& other)
+			{
+				for (size_t i = 0; i < Histogram::bucket_count; ++i)
+				{
+					// Most buckets of a thread are empty; skipping them keeps the retired shard's lines clean.
+					if (const uint64_t count = other.counts[i].load(std::memory_order_relaxed))
+					{
+						increment(counts[i], count);
+					}
+				}
+
+				increment(sum, other.sum.load(std::memory_order_relaxed));
+				min.store(std::min(min.load(std::memory_order_relaxed), other.min.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+				max.store(std::max(max.load(std::memory_order_relaxed), other.max.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+			}
+		};
+
+		struct alignas(cache_line_size) LatencyShard
+		{
+			std::array<MetricShard, latency_metric_count> metrics;
+
+			// Called with the shards' lock held, when the thread owning `other` exits.
+			void merge(const LatencyShard& other)
+			{
+				for (size_t i = 0; i < latency_metric_count; ++i)
+				{
+					metrics[i].merge(other.metrics[i]);
+				}
+			}
+		};
+
+		std::atomic<bool> recording = true;
+	}
+
+	Histogram::Histogram()
+		: counts_(bucket_count)
+	{
+	}
+
+	void Histogram::record(uint64_t value, uint64_t count)
+	{
+		if (!count)
+		{
+			return;
+		}
+
+		counts_[bucket_index(value)] += count;
+
+		total_ += count;
+		sum_   += value * count;
+		min_    = std::min(min_, value);
+		max_    = std::max(max_, value);
+	}
+
+	Histogram& Histogram::operator+=(const Histogram& rhs)
+	{
+		for (size_t i = 0; i < bucket_count; ++i)
+		{
+			counts_[i] += rhs.counts_[i];
+		}
+
+		total_ += rhs.total_;
+		sum_   += rhs.sum_;
+		min_    = std::min(min_, rhs.min_);
+		max_    = std::max(max_, rhs.max_);
+
+		return *this;
+	}
+
+	void Histogram::reset()
+	{
+		std::fill(counts_.begin(), counts_.end(), 0);
+
+		total_ = 0;
+		sum_   = 0;
+		min_   = UINT64_MAX;
+		max_   = 0;
+	}
+
+	uint64_t Histogram::count() const
+	{
+		return total_;
+	}
+
+	bool Histogram::empty() const
+	{
+		return !total_;
+	}
+
+	uint64_t Histogram::min() const
+	{
+		return total_ ? min_ : 0;
+	}
+
+	uint64_t Histogram::max() const
+	{
+		return max_;
+	}
+
+	double Histogram::mean() const
+	{
+		return total_ ? static_cast<double>(sum_) / static_cast<double>(total_) : 0.0;
+	}
+
+	uint64_t Histogram::percentile(double percentile) const
+	{
+		if (!total_)
+		{
+			return 0;
+		}
+
+		percentile = std::clamp(percentile, 0.0, 100.0);
+
+		const auto target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total_))));
+		uint64_t seen = 0;
+
+		for (size_t i = 0; i < bucket_count; ++i)
+		{
+			seen += counts_[i];
+
+			if (seen >= target)
+			{
+				return std::clamp(bucket_highest(i), min_, max_);
+			}
+		}
+
+		return max_;
+	}
+
+	size_t Histogram::bucket_index(uint64_t value)
+	{
+		if (value < exact_limit)
+		{
+			return static_cast<size_t>(value);
+		}
+
+		// Keep the top precision_bits of the value; each shift adds another
+		// half-range of buckets since the top bit is always set.
+		const size_t shift = static_cast<size_t>(std::bit_width(value)) - precision_bits;
+		return shift * half_bucket + static_cast<size_t>(value >> shift);
+	}
+
+	uint64_t Histogram::bucket_lowest(size_t index)
+	{
+		if (index < exact_limit)
+		{
+			return index;
+		}
+
+		const size_t shift = index / half_bucket - 1;
+		const uint64_t mantissa = index % half_bucket + half_bucket;
+
+		return mantissa << shift;
+	}
+
+	uint64_t Histogram::bucket_highest(size_t index)
+	{
+		if (index < exact_limit)
+		{
+			return index;
+		}
+
+		const size_t shift = index / half_bucket - 1;
+		return bucket_lowest(index) + ((uint64_t(1) << shift) - 1);
+	}
+
+	void LatencyRecorder::record(LatencyMetric metric, uint64_t nanoseconds)
+	{
+		MetricShard& shard = ThreadShards<LatencyShard>::local().metrics[static_cast<size_t>(metric)];
+
+		increment(shard.counts[Histogram::bucket_index(nanoseconds)], 1);
+		increment(shard.sum, nanoseconds);
+
+		if (nanoseconds < shard.min.load(std::memory_order_relaxed))
+		{
+			shard.min.store(nanoseconds, std::memory_order_relaxed);
+		}
+
+		if (nanoseconds > shard.max.load(std::memory_order_relaxed))
+		{
+			shard.max.store(nanoseconds, std::memory_order_relaxed);
+		}
+	}
+
+	Histogram LatencyRecorder::snapshot(LatencyMetric metric)
+	{
+		Histogram result;
+
+		ThreadShards<LatencyShard>::for_each([&](const LatencyShard& shard)
+		{
+			const MetricShard& source = shard.metrics[static_cast<size_t>(metric)];
+
+			for (size_t i = 0; i < Histogram::bucket_count; ++i)
+			{
+				const uint64_t count = source.counts[i].load(std::memory_order_relaxed);
+
+				result.counts_[i] += count;
+				result.total_     += count;
+			}
+
+			result.sum_ += source.sum.load(std::memory_order_relaxed);
+			result.min_  = std::min(result.min_, source.min.load(std::memory_order_relaxed));
+			result.max_  = std::max(result.max_, source.max.load(std::memory_order_relaxed));
+		});
+
+		return result;
+	}
+
+	bool LatencyRecorder::enabled()
+	{
+		return recording.load(std::memory_order_relaxed);
+	}
+
+	void LatencyRecorder::enabled(bool value)
+	{
+		recording.store(value, std::memory_order_relaxed);
+	}
+
+	LatencyTimer::LatencyTimer(LatencyMetric metric)
+		: metric_(metric),
+		  start_(LatencyRecorder::enabled() ? timestamp_now() : 0)
+	{
+	}
+
+	LatencyTimer::~LatencyTimer()
+	{
+		if (start_)
+		{
+			LatencyRecorder::record(metric_, timestamp_now() - start_);
+		}
+	}
+
+	uint64_t timestamp_now()
+	{
+		const auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+	}
+
+	void record_round_trip(uint64_t sent)
+	{
+		const uint64_t now = timestamp_now();
+		LatencyRecorder::record(LatencyMetric::round_trip, now > sent ? now - sent : 0);
+	}
+}
@@ -0,0 +1,176 @@
+#include "../include/sws/IngressLimiter.h"
+#include "../include/sws/enforce.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+namespace sws
+{
+	namespace
+	{
+		IngressLimits normalize(IngressLimits limits)
+		{
+			enforce(limits.packets_per_second >= 0.0 && limits.packet_burst >= 0.0 &&
+			        limits.bytes_per_second >= 0.0 && limits.byte_burst >= 0.0,
+			        "ingress limits must be non-negative");
+
+			if (limits.packet_burst <= 0.0)
+			{
+				limits.packet_burst = limits.packets_per_second;
+			}
+
+			if (limits.byte_burst <= 0.0)
+			{
+				limits.byte_burst = limits.bytes_per_second;
+			}
+
+			return limits;
+		}
+
+		bool unlimited(const IngressLimits& limits)
+		{
+			return limits.packets_per_second <= 0.0 && limits.bytes_per_second <= 0.0;
+		}
+
+		void refill(IngressState& state, const IngressLimits& limits, uint64_t now)
+		{
+			// A state which has never been used starts with full buckets.
+			if (!state.last)
+			{
+				state.packets = static_cast<float>(limits.packet_burst);
+				state.bytes   = static_cast<float>(limits.byte_burst);
+				state.last    = now;
+				return;
+			}
+
+			if (now <= state.last)
+			{
+				return;
+			}
+
+			const double elapsed = static_cast<double>(now - state.last) * 1e-9;
+
+			state.packets = static_cast<float>(std::min(limits.packet_burst, state.packets + elapsed * limits.packets_per_second));
+			state.bytes   = static_cast<float>(std::min(limits.byte_burst, state.bytes + elapsed * limits.bytes_per_second));
+			state.last    = now;
+		}
+
+		// Packets larger than the byte burst are allowed once the bucket is full,
+		// leaving it in debt, as with TokenBucket::try_consume.
+		bool allows(const IngressState& state, const IngressLimits& limits, double bytes)
+		{
+			return (limits.packets_per_second <= 0.0 || state.packets >= std::min(1.0, limits.packet_burst)) &&
+			       (limits.bytes_per_second <= 0.0 || state.bytes >= std::min(bytes, limits.byte_burst));
+		}
+
+		void consume(IngressState& state, double bytes)
+		{
+			state.packets -= 1.0f;
+			state.bytes   -= static_cast<float>(bytes);
+		}
+	}
+
+	IngressLimiter::IngressLimiter(const IngressLimits& peer_limits, const IngressLimits& global_limits, size_t table_size)
+		: peer_limits_(normalize(peer_limits)),
+		  global_limits_(normalize(global_limits)),
+		  table_(std::bit_ceil(std::max<size_t>(1, table_size))),
+		  mask_(table_.size() - 1)
+	{
+	}
+
+	bool IngressLimiter::admit(IngressState& peer, size_t bytes, clock::time_point now)
+	{
+		std::unique_lock lock(mutex_, std::defer_lock);
+		return admit(peer, bytes, now, lock);
+	}
+
+	bool IngressLimiter::admit(const Address& address, size_t bytes, clock::time_point now)
+	{
+		const size_t index = std::hash<Address>()(address) & mask_;
+
+		std::unique_lock lock(mutex_);
+		return admit(table_[index], bytes, now, lock);
+	}
+
+	bool IngressLimiter::admit(IngressState& peer, size_t bytes, clock::time_point now, std::unique_lock<std::mutex>& lock)
+	{
+		// Zero is reserved for states which have never been used.
+		const uint64_t ticks = std::max<uint64_t>(1, static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count()));
+
+		const double size = static_cast<double>(bytes);
+
+		const bool limit_peer   = !unlimited(peer_limits_);
+		const bool limit_global = !unlimited(global_limits_);
+
+		bool admitted = true;
+
+		if (limit_peer)
+		{
+			refill(peer, peer_limits_, ticks);
+			admitted = allows(peer, peer_limits_, size);
+		}
+
+		if (admitted && limit_global)
+		{
+			if (!lock.owns_lock())
+			{
+				lock.lock();
+			}
+
+			refill(global_, global_limits_, ticks);
+			admitted = allows(global_, global_limits_, size);
+
+			if (admitted)
+			{
+				consume(global_, size);
+			}
+		}
+
+		if (!admitted)
+		{
+			dropped_packets_.fetch_add(1, std::memory_order_relaxed);
+			dropped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+			return false;
+		}
+
+		if (limit_peer)
+		{
+			consume(peer, size);
+		}
+
+		return true;
+	}
+
+	const IngressLimits& IngressLimiter::peer_limits() const
+	{
+		return peer_limits_;
+	}
+
+	const IngressLimits& IngressLimiter::global_limits() const
+	{
+		return global_limits_;
+	}
+
+	uint64_t IngressLimiter::dropped_packets() const
+	{
+		return dropped_packets_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t IngressLimiter::dropped_bytes() const
+	{
+		return dropped_bytes_.load(std::memory_order_relaxed);
+	}
+
+	void IngressLimiter::reset()
+	{
+		std::lock_guard lock(mutex_);
+
+		std::fill(table_.begin(), table_.end(), IngressState {});
+		global_ = {};
+
+		dropped_packets_.store(0, std::memory_order_relaxed);
+		dropped_bytes_.store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,340 @@
+#include "../include/sws/NetworkSimulator.h"
+#include "../include/sws/enforce.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sws
+{
+	bool NetworkSimulator::Datagram::operator>(const Datagram& other) const
+	{
+		if (release != other.release)
+		{
+			return release > other.release;
+		}
+
+		// keeps datagrams with identical release times in arrival order
+		return sequence > other.sequence;
+	}
+
+	NetworkSimulator::NetworkSimulator(const Address& listen_address, Address target_address, uint64_t seed)
+		: listener_(false),
+		  target_(std::move(target_address)),
+		  random_(seed),
+		  buffer_(std::make_unique<std::array<uint8_t, Socket::datagram_size>>())
+	{
+		if (listener_.bind(listen_address) != SocketState::done)
+		{
+			throw SocketException("failed to bind network simulator", listener_.native_error());
+		}
+	}
+
+	const LinkConditions& NetworkSimulator::conditions(LinkDirection direction) const
+	{
+		return get_link(direction).conditions;
+	}
+
+	void NetworkSimulator::conditions(LinkDirection direction, const LinkConditions& conditions)
+	{
+		enforce(conditions.loss >= 0.0 && conditions.loss <= 1.0, "loss must be in the range [0, 1]");
+		enforce(conditions.duplication >= 0.0 && conditions.duplication <= 1.0, "duplication must be in the range [0, 1]");
+		enforce(conditions.reordering >= 0.0 && conditions.reordering <= 1.0, "reordering must be in the range [0, 1]");
+
+		Link& link = get_link(direction);
+
+		link.conditions = conditions;
+		link.bucket     = TokenBucket(conditions.bandwidth, static_cast<double>(conditions.burst));
+	}
+
+	void NetworkSimulator::conditions(const LinkConditions& conditions)
+	{
+		this->conditions(LinkDirection::upstream, conditions);
+		this->conditions(LinkDirection::downstream, conditions);
+	}
+
+	const LinkStatistics& NetworkSimulator::statistics(LinkDirection direction) const
+	{
+		return get_link(direction).statistics;
+	}
+
+	const Address& NetworkSimulator::local_address() const
+	{
+		return listener_.local_address();
+	}
+
+	SocketState NetworkSimulator::update()
+	{
+		const auto now = clock::now();
+
+		SocketState result = receive_upstream(now);
+
+		if (result != SocketState::done)
+		{
+			return result;
+		}
+
+		result = receive_downstream(now);
+
+		if (result != SocketState::done)
+		{
+			return result;
+		}
+
+		forward(upstream_, LinkDirection::upstream, now);
+		forward(downstream_, LinkDirection::downstream, now);
+
+		return SocketState::done;
+	}
+
+	NetworkSimulator::clock::time_point NetworkSimulator::next_event() const
+	{
+		const auto now    = clock::now();
+		auto       result = clock::time_point::max();
+
+		for (const Link* link : { &upstream_, &downstream_ })
+		{
+			if (!link->delayed.empty())
+			{
+				result = std::min(result, link->delayed.top().release);
+			}
+
+			if (!link->throttled.empty())
+			{
+				const auto size = static_cast<double>(link->throttled.front().data.size());
+				result = std::min(result, now + link->bucket.time_until(size, now));
+			}
+		}
+
+		return result;
+	}
+
+	NetworkSimulator::Link& NetworkSimulator::get_link(LinkDirection direction)
+	{
+		return direction == LinkDirection::upstream ? upstream_ : downstream_;
+	}
+
+	const NetworkSimulator::Link& NetworkSimulator::get_link(LinkDirection direction) const
+	{
+		return direction == LinkDirection::upstream ? upstream_ : downstream_;
+	}
+
+	UdpSocket& NetworkSimulator::get_upstream_socket(const Address& client)
+	{
+		const auto it = upstream_sockets_.find(client);
+
+		if (it != upstream_sockets_.end())
+		{
+			return *it->second;
+		}
+
+		auto socket = std::make_unique<UdpSocket>(false);
+
+		if (socket->connect(target_) != SocketState::done)
+		{
+			throw SocketException("failed to connect network simulator to target", socket->native_error());
+		}
+
+		return *upstream_sockets_.emplace(client, std::move(socket)).first->second;
+	}
+
+	SocketState NetworkSimulator::receive_upstream(clock::time_point now)
+	{
+		Address client;
+
+		while (true)
+		{
+			const int received = listener_.receive_from(*buffer_, client);
+
+			if (received == SOCKET_ERROR)
+			{
+				const SocketError error = Socket::get_native_error();
+
+				// Winsock reports ICMP port unreachable on UDP sockets as a reset.
+				if (error == SocketError::connection_reset)
+				{
+					continue;
+				}
+
+				const SocketState state = to_state(error);
+				return state == SocketState::in_progress ? SocketState::done : state;
+			}
+
+			enqueue(upstream_, client, buffer_->data(), static_cast<size_t>(received), now);
+		}
+	}
+
+	SocketState NetworkSimulator::receive_downstream(clock::time_point now)
+	{
+		for (auto& [client, socket] : upstream_sockets_)
+		{
+			while (true)
+			{
+				const int received = socket->receive(*buffer_);
+
+				if (received == SOCKET_ERROR)
+				{
+					const SocketError error = Socket::get_native_error();
+
+					if (error == SocketError::connection_reset)
+					{
+						continue;
+					}
+
+					const SocketState state = to_state(error);
+
+					if (state == SocketState::in_progress)
+					{
+						break;
+					}
+
+					return state;
+				}
+
+				enqueue(downstream_, client, buffer_->data(), static_cast<size_t>(received), now);
+			}
+		}
+
+		return SocketState::done;
+	}
+
+	void NetworkSimulator::enqueue(Link& link, const Address& client, const uint8_t* data, size_t length, clock::time_point now)
+	{
+		++link.statistics.received;
+
+		if (chance(link.conditions.loss))
+		{
+			++link.statistics.lost;
+			return;
+		}
+
+		const int copies = chance(link.conditions.duplication) ? 2 : 1;
+
+		if (copies > 1)
+		{
+			++link.statistics.duplicated;
+		}
+
+		for (int i = 0; i < copies; ++i)
+		{
+			Datagram datagram;
+
+			datagram.sequence = sequence_++;
+			datagram.client   = client;
+			datagram.data.assign(data, data + length);
+
+			if (chance(link.conditions.reordering))
+			{
+				++link.statistics.reordered;
+				datagram.release = now;
+			}
+			else
+			{
+				datagram.release = now + pick_latency(link.conditions);
+			}
+
+			link.delayed.push(std::move(datagram));
+		}
+	}
+
+	void NetworkSimulator::forward(Link& link, LinkDirection direction, clock::time_point now)
+	{
+		while (!link.delayed.empty() && link.delayed.top().release <= now)
+		{
+			// std::priority_queue::top is const; the datagram is moved out before pop.
+			auto datagram = std::move(const_cast<Datagram&>(link.delayed.top()));
+			link.delayed.pop();
+
+			if (link.throttled_bytes + datagram.data.size() > link.conditions.queue_limit)
+			{
+				++link.statistics.overflowed;
+				continue;
+			}
+
+			link.throttled_bytes += datagram.data.size();
+			link.throttled.push_back(std::move(datagram));
+		}
+
+		while (!link.throttled.empty())
+		{
+			const Datagram& datagram = link.throttled.front();
+
+			if (!link.bucket.try_consume(static_cast<double>(datagram.data.size()), now))
+			{
+				break;
+			}
+
+			transmit(direction, datagram);
+
+			++link.statistics.forwarded;
+			link.throttled_bytes -= datagram.data.size();
+			link.throttled.pop_front();
+		}
+	}
+
+	void NetworkSimulator::transmit(LinkDirection direction, const Datagram& datagram)
+	{
+		// Send failures are treated as loss on the simulated link.
+		if (direction == LinkDirection::upstream)
+		{
+			static_cast<void>(get_upstream_socket(datagram.client).send(datagram.data));
+		}
+		else
+		{
+			static_cast<void>(listener_.send_to(std::span<const uint8_t>(datagram.data), datagram.client));
+		}
+	}
+
+	NetworkSimulator::clock::duration NetworkSimulator::pick_latency(const LinkConditions& conditions)
+	{
+		const auto latency = static_cast<double>(conditions.latency.count());
+		const auto jitter  = static_cast<double>(conditions.jitter.count());
+
+		double result = latency;
+
+		switch (conditions.distribution)
+		{
+			case LatencyDistribution::constant:
+				break;
+
+			case LatencyDistribution::uniform:
+				if (jitter > 0.0)
+				{
+					result = std::uniform_real_distribution<double>(latency - jitter, latency + jitter)(random_);
+				}
+				break;
+
+			case LatencyDistribution::normal:
+				if (jitter > 0.0)
+				{
+					result = std::normal_distribution<double>(latency, jitter)(random_);
+				}
+				break;
+
+			case LatencyDistribution::pareto:
+				if (jitter > 0.0)
+				{
+					// Pareto with shape 2 (finite mean, infinite variance) and scale jitter,
+					// shifted so that the minimum delay is the base latency.
+					constexpr double shape = 2.0;
+					const double u = std::uniform_real_distribution<double>(0.0, 1.0)(random_);
+					result = latency + jitter * (1.0 / std::pow(1.0 - u, 1.0 / shape) - 1.0);
+				}
+				break;
+
+			default:
+				break;
+		}
+
+		return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::micro>(std::max(0.0, result)));
+	}
+
+	bool NetworkSimulator::chance(double probability)
+	{
+		if (probability <= 0.0)
+		{
+			return false;
+		}
+
+		return std::uniform_real_distribution<double>(0.0, 1.0)(random_) < probability;
+	}
+}
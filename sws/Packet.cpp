@@ -6,7 +6,6 @@ namespace sws
 {
 	Packet::Packet()
 	{
-		data_.reserve(256);
 		Packet::clear(); // initializes buffer size, seek positions, etc
 	}
 
@@ -23,7 +22,8 @@ namespace sws
 		  write_pos_(other.write_pos_),
 		  send_pos_(other.send_pos_),
 		  recv_pos_(other.recv_pos_),
-		  recv_target_(other.recv_target_)
+		  recv_target_(other.recv_target_),
+		  send_start_(other.send_start_)
 	{
 		other.send_reset();
 		other.recv_reset();
@@ -39,6 +39,7 @@ namespace sws
 			send_pos_    = other.send_pos_;
 			recv_pos_    = other.recv_pos_;
 			recv_target_ = other.recv_target_;
+			send_start_  = other.send_start_;
 
 			other.send_reset();
 			other.recv_reset();
@@ -224,7 +225,7 @@ namespace sws
 
 		if (write_end > data_.size())
 		{
-			data_.resize(data_.size() + (write_end - data_.size()));
+			data_.resize(write_end);
 		}
 
 		memcpy(&data_[write_pos_], data, write_size);
@@ -327,7 +328,7 @@ namespace sws
 			return 0;
 		}
 
-		return write_data(&packet.data().at(sizeof(packetlen_t)), packet.work_size(), true);
+		return write_data(packet.data().data() + sizeof(packetlen_t), packet.work_size(), true);
 	}
 
 	Packet& Packet::operator>>(std::string& data)
@@ -560,7 +561,7 @@ namespace sws
 		data_.shrink_to_fit();
 	}
 
-	const std::vector<uint8_t>& Packet::data() const
+	const PacketBuffer& Packet::data() const
 	{
 		return data_;
 	}
@@ -577,7 +578,7 @@ namespace sws
 
 	ptrdiff_t Packet::get_send_remainder() const
 	{
-		return send_pos_ < 1 ? 0 : data_.size() - send_pos_;
+		return send_pos_ < 0 ? 0 : data_.size() - send_pos_;
 	}
 
 	ptrdiff_t Packet::get_recv_remainder() const
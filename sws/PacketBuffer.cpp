@@ -0,0 +1,153 @@
+#include "../include/sws/PacketBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace sws
+{
+	PacketBuffer::PacketBuffer(const PacketBuffer& other)
+	{
+		reserve(other.size_);
+		size_ = other.size_;
+
+		if (size_)
+		{
+			memcpy(data(), other.data(), size_);
+		}
+	}
+
+	PacketBuffer::PacketBuffer(PacketBuffer&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	PacketBuffer& PacketBuffer::operator=(const PacketBuffer& other)
+	{
+		if (this != &other)
+		{
+			// Only the bytes in use are copied, so keep any capacity we already have.
+			size_ = 0;
+			reserve(other.size_);
+			size_ = other.size_;
+
+			if (size_)
+			{
+				memcpy(data(), other.data(), size_);
+			}
+		}
+
+		return *this;
+	}
+
+	PacketBuffer& PacketBuffer::operator=(PacketBuffer&& other) noexcept
+	{
+		if (this == &other)
+		{
+			return *this;
+		}
+
+		if (other.heap_)
+		{
+			heap_     = std::move(other.heap_);
+			data_     = heap_.get();
+			capacity_ = other.capacity_;
+		}
+		else
+		{
+			heap_.reset();
+			data_     = inline_.data();
+			capacity_ = inline_capacity;
+			memcpy(inline_.data(), other.inline_.data(), other.size_);
+		}
+
+		size_ = other.size_;
+
+		other.data_     = other.inline_.data();
+		other.size_     = 0;
+		other.capacity_ = inline_capacity;
+
+		return *this;
+	}
+
+	bool PacketBuffer::is_inline() const
+	{
+		return !heap_;
+	}
+
+	const uint8_t& PacketBuffer::at(size_t index) const
+	{
+		if (index >= size_)
+		{
+			throw std::out_of_range("PacketBuffer index out of range");
+		}
+
+		return data_[index];
+	}
+
+	void PacketBuffer::reserve(size_t capacity)
+	{
+		if (capacity > capacity_)
+		{
+			reallocate(capacity);
+		}
+	}
+
+	void PacketBuffer::grow(size_t size)
+	{
+		// Grow geometrically so that writing a packet one value at a time stays amortized O(1).
+		reallocate(std::max(size, capacity_ * 2));
+	}
+
+	void PacketBuffer::clear()
+	{
+		size_ = 0;
+	}
+
+	void PacketBuffer::shrink_to_fit()
+	{
+		if (!heap_)
+		{
+			return;
+		}
+
+		if (size_ <= inline_capacity)
+		{
+			memcpy(inline_.data(), heap_.get(), size_);
+			heap_.reset();
+			data_     = inline_.data();
+			capacity_ = inline_capacity;
+		}
+		else if (capacity_ > size_)
+		{
+			reallocate(size_);
+		}
+	}
+
+	void PacketBuffer::swap(PacketBuffer& other) noexcept
+	{
+		PacketBuffer temp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(temp);
+	}
+
+	PacketBuffer::operator std::span<const uint8_t>() const
+	{
+		return { data_, size_ };
+	}
+
+	void PacketBuffer::reallocate(size_t capacity)
+	{
+		// make_unique_for_overwrite default-initializes, i.e. does not zero the new buffer.
+		auto buffer = std::make_unique_for_overwrite<uint8_t[]>(capacity);
+
+		if (size_)
+		{
+			memcpy(buffer.get(), data_, size_);
+		}
+
+		heap_     = std::move(buffer);
+		data_     = heap_.get();
+		capacity_ = capacity;
+	}
+}
@@ -0,0 +1,671 @@
+#include "../include/sws/PcapWriter.h"
+#include "../include/sws/Socket.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+
+namespace sws
+{
+	namespace
+	{
+		// pcapng block types and options, see draft-ietf-opsawg-pcapng.
+		constexpr uint32_t section_header_block        = 0x0A0D0D0A;
+		constexpr uint32_t interface_block             = 0x00000001;
+		constexpr uint32_t enhanced_packet_block       = 0x00000006;
+		constexpr uint32_t byte_order_magic            = 0x1A2B3C4D;
+		constexpr uint16_t option_end                  = 0;
+		constexpr uint16_t option_timestamp_resolution = 9;
+		constexpr uint16_t option_packet_flags         = 2;
+		constexpr uint32_t packet_flags_inbound        = 1;
+		constexpr uint32_t packet_flags_outbound       = 2;
+
+		// Packets start with an IPv4 or IPv6 header.
+		constexpr uint16_t linktype_raw = 101;
+
+		constexpr size_t ipv4_header_size = 20;
+		constexpr size_t ipv6_header_size = 40;
+		constexpr size_t udp_header_size  = 8;
+		constexpr size_t tcp_header_size  = 20;
+
+		// Keeps every synthesized packet within the 16-bit IP length fields.
+		constexpr size_t max_payload_size = 65535 - ipv6_header_size - tcp_header_size;
+
+		constexpr uint8_t default_hop_limit = 64;
+
+		// Section header and interface description blocks at the start of each file.
+		constexpr size_t file_header_size = 28 + 32;
+
+		// Enhanced packet block, IP and transport headers and padding of one packet.
+		constexpr size_t max_packet_overhead = 44 + ipv6_header_size + tcp_header_size + 3;
+
+		constexpr auto flush_interval = std::chrono::milliseconds(100);
+
+		// Records taken from the buffer before its space is handed back to producers.
+		constexpr size_t batch_size = 256;
+
+		// Addresses of sockets are numeric, so they fit with room to spare.
+		constexpr size_t max_address_text = 64;
+
+		// A packet as buffered, followed by the text of its local and remote
+		// addresses and then its data.
+		struct RecordHeader
+		{
+			uint32_t size;
+			uint8_t  kind;
+			uint8_t  protocol;
+			uint8_t  direction;
+			uint8_t  reserved;
+			uint64_t time;
+			uint32_t length;
+			uint16_t local_port;
+			uint16_t remote_port;
+			uint8_t  local_family;
+			uint8_t  remote_family;
+			uint8_t  local_size;
+			uint8_t  remote_size;
+			uint32_t padding;
+		};
+
+		constexpr uint8_t packet_kind  = 1;
+		constexpr uint8_t padding_kind = 2;
+
+		constexpr size_t record_alignment = 8;
+
+		static_assert(sizeof(RecordHeader) % record_alignment == 0);
+
+		// The buffer always holds several of the largest records.
+		constexpr size_t min_buffer_size = std::bit_ceil(4 * (sizeof(RecordHeader) + 2 * max_address_text + Socket::datagram_size));
+
+		constexpr uint64_t align(uint64_t size)
+		{
+			return (size + record_alignment - 1) & ~uint64_t(record_alignment - 1);
+		}
+
+		// The size is left at 0 until the whole record is in place, as in a capture log.
+		void commit(uint8_t* record, uint64_t size)
+		{
+			std::atomic_ref(*reinterpret_cast<uint32_t*>(record)).store(static_cast<uint32_t>(size), std::memory_order_release);
+		}
+
+		uint32_t committed_size(uint8_t* record)
+		{
+			return std::atomic_ref(*reinterpret_cast<uint32_t*>(record)).load(std::memory_order_acquire);
+		}
+
+		void write_padding(uint8_t* record, uint64_t size)
+		{
+			record[4] = padding_kind;
+			commit(record, size);
+		}
+
+		// Converted by the background thread, keeping the capturing thread free of parsing.
+		// An address which cannot be converted is written as unspecified rather than losing the packet.
+		sockaddr_storage to_native(const uint8_t* text, size_t size, port_t port, uint8_t family)
+		{
+			if (static_cast<AddressFamily>(family) == AddressFamily::none)
+			{
+				return {};
+			}
+
+			try
+			{
+				return Address(std::string(reinterpret_cast<const char*>(text), size), port, static_cast<AddressFamily>(family)).to_native();
+			}
+			catch (const std::exception&)
+			{
+				return {};
+			}
+		}
+
+		// Connections whose sequence numbers are tracked before starting over.
+		constexpr size_t max_tracked_flows = 65536;
+
+		template <typename T>
+		void append(std::vector<uint8_t>& buffer, const T& value)
+		{
+			const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+		}
+
+		void pad(std::vector<uint8_t>& buffer)
+		{
+			buffer.resize((buffer.size() + 3) & ~size_t(3));
+		}
+
+		void put16(uint8_t* destination, uint16_t value)
+		{
+			destination[0] = static_cast<uint8_t>(value >> 8);
+			destination[1] = static_cast<uint8_t>(value);
+		}
+
+		void put32(uint8_t* destination, uint32_t value)
+		{
+			put16(destination, static_cast<uint16_t>(value >> 16));
+			put16(destination + 2, static_cast<uint16_t>(value));
+		}
+
+		// One's complement sum of big-endian 16-bit words (RFC 1071).
+		uint64_t checksum_add(uint64_t sum, const uint8_t* data, size_t size)
+		{
+			for (; size > 1; data += 2, size -= 2)
+			{
+				sum += static_cast<uint64_t>(data[0] << 8 | data[1]);
+			}
+
+			if (size)
+			{
+				sum += static_cast<uint64_t>(data[0] << 8);
+			}
+
+			return sum;
+		}
+
+		uint16_t checksum_fold(uint64_t sum)
+		{
+			while (sum >> 16)
+			{
+				sum = (sum & 0xFFFF) + (sum >> 16);
+			}
+
+			return static_cast<uint16_t>(~sum);
+		}
+
+		struct Endpoint
+		{
+			uint8_t  address[16] = {};
+			uint16_t port        = 0;
+		};
+
+		// Addresses of the other family are IPv4-mapped, so both ends of a packet share one family.
+		Endpoint to_endpoint(const sockaddr_storage& native, bool ipv6)
+		{
+			Endpoint result;
+
+			if (native.ss_family == AF_INET)
+			{
+				const auto& address = reinterpret_cast<const sockaddr_in&>(native);
+
+				if (ipv6)
+				{
+					result.address[10] = 0xFF;
+					result.address[11] = 0xFF;
+					std::memcpy(&result.address[12], &address.sin_addr, 4);
+				}
+				else
+				{
+					std::memcpy(result.address, &address.sin_addr, 4);
+				}
+
+				result.port = ntohs(address.sin_port);
+			}
+			else if (native.ss_family == AF_INET6)
+			{
+				const auto& address = reinterpret_cast<const sockaddr_in6&>(native);
+
+				std::memcpy(result.address, &address.sin6_addr, 16);
+				result.port = ntohs(address.sin6_port);
+			}
+
+			return result;
+		}
+
+		std::string flow_key(const Endpoint& source, const Endpoint& destination)
+		{
+			std::string result(sizeof(Endpoint) * 2, '\0');
+
+			std::memcpy(result.data(), &source, sizeof(Endpoint));
+			std::memcpy(result.data() + sizeof(Endpoint), &destination, sizeof(Endpoint));
+
+			return result;
+		}
+	}
+
+	PcapWriter::PcapWriter(std::filesystem::path path, uint64_t rotate_size, size_t buffer_size)
+		: path_(std::move(path)),
+		  rotate_size_(rotate_size),
+		  buffer_size_(std::bit_ceil(std::max(buffer_size, min_buffer_size)))
+	{
+		// Zeroed, so that no record is committed until a producer writes one.
+		buffer_ = std::make_unique<uint64_t[]>(buffer_size_ / sizeof(uint64_t));
+
+		block_.reserve(block_size + 65536 + 64);
+		open(0);
+
+		if (!file_)
+		{
+			throw std::system_error(std::make_error_code(std::errc::io_error), "Failed to create pcap file");
+		}
+
+		thread_ = std::thread(&PcapWriter::run, this);
+	}
+
+	PcapWriter::~PcapWriter()
+	{
+		close();
+	}
+
+	bool PcapWriter::capture(Protocol protocol, CaptureDirection direction, const Address& local, const Address& remote,
+	                         std::span<const uint8_t> data) noexcept
+	{
+		const size_t local_size  = local.family != AddressFamily::none ? local.address.size() : 0;
+		const size_t remote_size = remote.family != AddressFamily::none ? remote.address.size() : 0;
+
+		if (local_size > max_address_text || remote_size > max_address_text || data.size() > Socket::datagram_size)
+		{
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		const uint64_t size = align(sizeof(RecordHeader) + local_size + remote_size + data.size());
+		const uint64_t mask = buffer_size_ - 1;
+
+		uint64_t position = tail_.load(std::memory_order_relaxed);
+		uint64_t padding  = 0;
+
+		for (;;)
+		{
+			const uint64_t head = head_.load(std::memory_order_acquire);
+
+			// The background thread has since released past a stale tail.
+			if (head > position)
+			{
+				position = tail_.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			// Records never wrap around the end of the buffer; the rest of it is padded out.
+			const uint64_t offset = position & mask;
+			padding = offset + size > buffer_size_ ? buffer_size_ - offset : 0;
+
+			if (position + padding + size - head > buffer_size_)
+			{
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			if (tail_.compare_exchange_weak(position, position + padding + size, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+
+		uint8_t* const base = buffer();
+
+		if (padding)
+		{
+			write_padding(base + (position & mask), padding);
+		}
+
+		uint8_t* const record = base + ((position + padding) & mask);
+
+		const auto now = std::chrono::system_clock::now().time_since_epoch();
+
+		RecordHeader header {};
+		header.kind          = packet_kind;
+		header.protocol      = static_cast<uint8_t>(protocol);
+		header.direction     = static_cast<uint8_t>(direction);
+		header.time          = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+		header.length        = static_cast<uint32_t>(data.size());
+		header.local_port    = local.port;
+		header.remote_port   = remote.port;
+		header.local_family  = static_cast<uint8_t>(local_size ? local.family : AddressFamily::none);
+		header.remote_family = static_cast<uint8_t>(remote_size ? remote.family : AddressFamily::none);
+		header.local_size    = static_cast<uint8_t>(local_size);
+		header.remote_size   = static_cast<uint8_t>(remote_size);
+
+		std::memcpy(record + sizeof(header.size), reinterpret_cast<const uint8_t*>(&header) + sizeof(header.size),
+		            sizeof(header) - sizeof(header.size));
+
+		uint8_t* output = record + sizeof(header);
+
+		std::memcpy(output, local.address.data(), local_size);
+		output += local_size;
+
+		std::memcpy(output, remote.address.data(), remote_size);
+		output += remote_size;
+
+		if (!data.empty())
+		{
+			std::memcpy(output, data.data(), data.size());
+		}
+
+		commit(record, size);
+		return true;
+	}
+
+	void PcapWriter::close()
+	{
+		if (!thread_.joinable())
+		{
+			return;
+		}
+
+		stop_.store(true, std::memory_order_release);
+		thread_.join();
+	}
+
+	uint64_t PcapWriter::dropped() const
+	{
+		return dropped_.load(std::memory_order_relaxed);
+	}
+
+	std::filesystem::path PcapWriter::current_path() const
+	{
+		const size_t index = file_index_.load(std::memory_order_relaxed);
+
+		if (!index)
+		{
+			return path_;
+		}
+
+		auto result = path_;
+		result.replace_filename(path_.stem().string() + '.' + std::to_string(index) + path_.extension().string());
+		return result;
+	}
+
+	uint8_t* PcapWriter::buffer() const
+	{
+		return reinterpret_cast<uint8_t*>(buffer_.get());
+	}
+
+	void PcapWriter::run()
+	{
+		uint8_t* const base = buffer();
+		const uint64_t mask = buffer_size_ - 1;
+
+		uint64_t head = head_.load(std::memory_order_relaxed);
+		auto last_write = std::chrono::steady_clock::now();
+
+		for (;;)
+		{
+			// Checked before reading so that nothing buffered before close() is missed.
+			const bool stopping = stop_.load(std::memory_order_acquire);
+			const uint64_t start = head;
+
+			size_t count = 0;
+			Entry  entry;
+
+			for (; count < batch_size && next(entry, head); ++count)
+			{
+				// Upper bound of the bytes the entry adds, including every segment's headers and block.
+				const size_t segments = 1 + entry.data.size() / max_payload_size;
+				const size_t size     = entry.data.size() + segments * max_packet_overhead;
+
+				if (rotate_size_ && file_size_ + block_.size() > file_header_size && file_size_ + block_.size() + size > rotate_size_)
+				{
+					write_block();
+					open(file_index_.load(std::memory_order_relaxed) + 1);
+				}
+
+				write(entry);
+
+				if (block_.size() >= block_size)
+				{
+					write_block();
+					last_write = std::chrono::steady_clock::now();
+				}
+			}
+
+			if (head != start)
+			{
+				// Record headers of the next lap may start anywhere in the space read,
+				// so it is cleared before producers can reserve it again.
+				for (uint64_t position = start; position != head;)
+				{
+					const uint64_t offset = position & mask;
+					const uint64_t length = std::min(head - position, buffer_size_ - offset);
+
+					std::memset(base + offset, 0, length);
+					position += length;
+				}
+
+				head_.store(head, std::memory_order_release);
+			}
+
+			const auto now = std::chrono::steady_clock::now();
+
+			if (!count && !block_.empty() && now - last_write >= flush_interval)
+			{
+				write_block();
+				last_write = now;
+			}
+
+			if (!count)
+			{
+				if (stopping)
+				{
+					break;
+				}
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		write_block();
+		file_.close();
+	}
+
+	bool PcapWriter::next(Entry& entry, uint64_t& head)
+	{
+		for (;;)
+		{
+			uint8_t* const record = buffer() + (head & (buffer_size_ - 1));
+			const uint32_t size   = committed_size(record);
+
+			if (!size)
+			{
+				return false;
+			}
+
+			head += size;
+
+			RecordHeader header;
+			std::memcpy(&header, record, sizeof(header));
+
+			if (header.kind == padding_kind)
+			{
+				continue;
+			}
+
+			const uint8_t* input = record + sizeof(header);
+
+			entry.time      = header.time;
+			entry.protocol  = static_cast<Protocol>(header.protocol);
+			entry.direction = static_cast<CaptureDirection>(header.direction);
+			entry.local     = to_native(input, header.local_size, header.local_port, header.local_family);
+			input += header.local_size;
+
+			entry.remote = to_native(input, header.remote_size, header.remote_port, header.remote_family);
+			input += header.remote_size;
+
+			entry.data = std::span<const uint8_t>(input, header.length);
+			return true;
+		}
+	}
+
+	void PcapWriter::open(size_t index)
+	{
+		file_.close();
+		file_index_.store(index, std::memory_order_relaxed);
+		file_.open(current_path(), std::ios::binary | std::ios::trunc);
+
+		std::vector<uint8_t> header;
+
+		append(header, section_header_block);
+		append(header, uint32_t(28));
+		append(header, byte_order_magic);
+		append(header, uint16_t(1));
+		append(header, uint16_t(0));
+		append(header, int64_t(-1));
+		append(header, uint32_t(28));
+
+		// Timestamps are in nanoseconds.
+		append(header, interface_block);
+		append(header, uint32_t(32));
+		append(header, linktype_raw);
+		append(header, uint16_t(0));
+		append(header, uint32_t(0));
+		append(header, option_timestamp_resolution);
+		append(header, uint16_t(1));
+		append(header, uint32_t(9));
+		append(header, option_end);
+		append(header, uint16_t(0));
+		append(header, uint32_t(32));
+
+		file_.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+		file_size_ = header.size();
+	}
+
+	void PcapWriter::write(const Entry& entry)
+	{
+		const bool ipv6 = entry.local.ss_family == AF_INET6 || entry.remote.ss_family == AF_INET6;
+		const bool tcp  = entry.protocol == Protocol::tcp;
+
+		const Endpoint local  = to_endpoint(entry.local, ipv6);
+		const Endpoint remote = to_endpoint(entry.remote, ipv6);
+
+		const bool      sent        = entry.direction == CaptureDirection::sent;
+		const Endpoint& source      = sent ? local : remote;
+		const Endpoint& destination = sent ? remote : local;
+
+		const size_t ip_size        = ipv6 ? ipv6_header_size : ipv4_header_size;
+		const size_t transport_size = tcp ? tcp_header_size : udp_header_size;
+		const size_t address_size   = ipv6 ? 16 : 4;
+		const uint8_t next_header   = tcp ? IPPROTO_TCP : IPPROTO_UDP;
+
+		uint32_t* sequence    = nullptr;
+		uint32_t  acknowledge = 0;
+
+		if (tcp)
+		{
+			if (sequences_.size() >= max_tracked_flows)
+			{
+				sequences_.clear();
+			}
+
+			sequence = &sequences_.try_emplace(flow_key(source, destination), 1).first->second;
+
+			const auto reverse = sequences_.find(flow_key(destination, source));
+			acknowledge = reverse != sequences_.end() ? reverse->second : 1;
+		}
+
+		// Stream packets larger than an IP packet are split into several segments;
+		// oversized datagrams are truncated in the capture.
+		size_t offset = 0;
+
+		do
+		{
+			const size_t payload_size  = std::min(entry.data.size() - offset, max_payload_size);
+			const size_t original_size = tcp ? payload_size : entry.data.size() - offset;
+			const size_t header_size   = ip_size + transport_size;
+
+			scratch_.assign(header_size, 0);
+			uint8_t* const ip        = scratch_.data();
+			uint8_t* const transport = ip + ip_size;
+
+			const auto transport_length = static_cast<uint16_t>(transport_size + payload_size);
+
+			if (ipv6)
+			{
+				put32(ip, 0x60000000);
+				put16(ip + 4, transport_length);
+				ip[6] = next_header;
+				ip[7] = default_hop_limit;
+				std::memcpy(ip + 8, source.address, 16);
+				std::memcpy(ip + 24, destination.address, 16);
+			}
+			else
+			{
+				ip[0] = 0x45;
+				put16(ip + 2, static_cast<uint16_t>(ipv4_header_size + transport_length));
+				put16(ip + 4, ip_id_++);
+				put16(ip + 6, 0x4000); // don't fragment
+				ip[8] = default_hop_limit;
+				ip[9] = next_header;
+				std::memcpy(ip + 12, source.address, 4);
+				std::memcpy(ip + 16, destination.address, 4);
+				put16(ip + 10, checksum_fold(checksum_add(0, ip, ipv4_header_size)));
+			}
+
+			put16(transport, source.port);
+			put16(transport + 2, destination.port);
+
+			if (tcp)
+			{
+				put32(transport + 4, *sequence);
+				put32(transport + 8, acknowledge);
+				transport[12] = (tcp_header_size / 4) << 4;
+				transport[13] = 0x18; // PSH, ACK
+				put16(transport + 14, 65535);
+
+				*sequence += static_cast<uint32_t>(payload_size);
+			}
+			else
+			{
+				put16(transport + 4, transport_length);
+			}
+
+			const uint8_t* const payload = entry.data.data() + offset;
+
+			// Pseudo header, transport header and payload.
+			uint64_t sum = checksum_add(0, ip + (ipv6 ? 8 : 12), address_size * 2);
+			sum += next_header;
+			sum += transport_length;
+			sum  = checksum_add(sum, transport, transport_size);
+			sum  = checksum_add(sum, payload, payload_size);
+
+			uint16_t checksum = checksum_fold(sum);
+
+			if (!tcp && !checksum)
+			{
+				checksum = 0xFFFF;
+			}
+
+			put16(transport + (tcp ? 16 : 6), checksum);
+
+			const size_t captured_size = header_size + payload_size;
+			const size_t padded_size   = (captured_size + 3) & ~size_t(3);
+			const auto   block_length  = static_cast<uint32_t>(28 + padded_size + 12 + 4);
+
+			append(block_, enhanced_packet_block);
+			append(block_, block_length);
+			append(block_, uint32_t(0));
+			append(block_, static_cast<uint32_t>(entry.time >> 32));
+			append(block_, static_cast<uint32_t>(entry.time));
+			append(block_, static_cast<uint32_t>(captured_size));
+			append(block_, static_cast<uint32_t>(header_size + original_size));
+			block_.insert(block_.end(), scratch_.begin(), scratch_.end());
+			block_.insert(block_.end(), payload, payload + payload_size);
+			pad(block_);
+			append(block_, option_packet_flags);
+			append(block_, uint16_t(4));
+			append(block_, sent ? packet_flags_outbound : packet_flags_inbound);
+			append(block_, option_end);
+			append(block_, uint16_t(0));
+			append(block_, block_length);
+
+			offset += payload_size;
+		} while (tcp && offset < entry.data.size());
+	}
+
+	void PcapWriter::write_block()
+	{
+		if (block_.empty())
+		{
+			return;
+		}
+
+		// If the file could not be written, the block is lost; capturing must not stop the process.
+		if (file_)
+		{
+			file_.write(reinterpret_cast<const char*>(block_.data()), static_cast<std::streamsize>(block_.size()));
+			file_.flush();
+		}
+
+		file_size_ += block_.size();
+		block_.clear();
+	}
+}
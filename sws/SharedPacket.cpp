@@ -0,0 +1,48 @@
+#include "../include/sws/SharedPacket.h"
+#include "../include/sws/Packet.h"
+
+namespace sws
+{
+	SharedPacket::SharedPacket(Packet&& packet)
+	{
+		if (!packet.empty())
+		{
+			buffer_ = std::make_shared<const PacketBuffer>(std::move(packet.data_));
+		}
+
+		packet.clear();
+	}
+
+	SharedPacket::SharedPacket(const Packet& packet)
+	{
+		if (!packet.empty())
+		{
+			buffer_ = std::make_shared<const PacketBuffer>(packet.data_);
+		}
+	}
+
+	std::span<const uint8_t> SharedPacket::data() const
+	{
+		if (!buffer_)
+		{
+			return {};
+		}
+
+		return *buffer_;
+	}
+
+	size_t SharedPacket::size() const
+	{
+		return buffer_ ? buffer_->size() : 0;
+	}
+
+	bool SharedPacket::empty() const
+	{
+		return !buffer_;
+	}
+
+	long SharedPacket::use_count() const
+	{
+		return buffer_.use_count();
+	}
+}
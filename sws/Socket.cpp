@@ -1,15 +1,92 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <optional>
 #include <sstream>
 #include <utility>
 #include <WS2tcpip.h>
+#include <mstcpip.h>
 
+#include "../include/sws/Crc32c.h"
 #include "../include/sws/enforce.h"
 #include "../include/sws/typedefs.h"
 #include "../include/sws/Socket.h"
 #include "../include/sws/Address.h"
+#include "../include/sws/EventLoop.h"
+#include "../include/sws/Histogram.h"
 #include "../include/sws/Packet.h"
 
 namespace sws
 {
+	struct Socket::ZeroCopy
+	{
+		struct Send
+		{
+			WSAOVERLAPPED overlapped {};
+			PacketBuffer  data;
+		};
+
+		size_t threshold     = 0;
+		size_t max_in_flight = 0;
+		size_t pending       = 0;
+
+		// Send buffer size to restore when disabled, once the socket's has been replaced.
+		std::optional<int> previous_send_buffer;
+
+		// In submission order, which is also completion order for a stream.
+		std::deque<std::unique_ptr<Send>> in_flight;
+
+		// Completed sends, reused along with their event and buffer.
+		std::vector<std::unique_ptr<Send>> spare;
+
+		ZeroCopy() = default;
+		ZeroCopy(const ZeroCopy&) = delete;
+		ZeroCopy& operator=(const ZeroCopy&) = delete;
+		~ZeroCopy();
+
+		std::unique_ptr<Send> acquire();
+	};
+
+	Socket::ZeroCopy::~ZeroCopy()
+	{
+		for (const auto& send : in_flight)
+		{
+			WSACloseEvent(send->overlapped.hEvent);
+		}
+
+		for (const auto& send : spare)
+		{
+			WSACloseEvent(send->overlapped.hEvent);
+		}
+	}
+
+	std::unique_ptr<Socket::ZeroCopy::Send> Socket::ZeroCopy::acquire()
+	{
+		if (!spare.empty())
+		{
+			auto send = std::move(spare.back());
+			spare.pop_back();
+			return send;
+		}
+
+		auto send = std::make_unique<Send>();
+		send->overlapped.hEvent = WSACreateEvent();
+
+		if (send->overlapped.hEvent == WSA_INVALID_EVENT)
+		{
+			throw SocketException("WSACreateEvent failed", get_native_error());
+		}
+
+		return send;
+	}
+
+	namespace
+	{
+		// How long closing a socket waits for zero-copy sends before cancelling them.
+		constexpr std::chrono::milliseconds zero_copy_close_timeout { 1000 };
+	}
+
 	bool Socket::is_initialized_ = false;
 
 	Socket::Socket(Protocol protocol, bool blocking)
@@ -31,9 +108,23 @@ namespace sws
 		  local_address_(std::move(rhs.local_address_)),
 		  blocking_(rhs.blocking_),
 		  connected_(std::exchange(rhs.connected_, false)),
+		  options_(rhs.options_),
 		  native_error_(std::exchange(rhs.native_error_, SocketError::none)),
-		  datagram_(std::move(rhs.datagram_))
+		  datagram_(std::move(rhs.datagram_)),
+		  checksum_(rhs.checksum_),
+		  statistics_(rhs.statistics_),
+		  capture_(rhs.capture_),
+		  ingress_limiter_(rhs.ingress_limiter_),
+		  ingress_(rhs.ingress_),
+		  cork_(std::move(rhs.cork_)),
+		  zero_copy_(std::move(rhs.zero_copy_)),
+		  send_queue_(std::move(rhs.send_queue_)),
+		  queued_bytes_(std::exchange(rhs.queued_bytes_, 0))
 	{
+		if (cork_)
+		{
+			cork_->owner = this;
+		}
 	}
 
 	Socket& Socket::operator=(Socket&& rhs) noexcept
@@ -42,14 +133,29 @@ namespace sws
 		{
 			close();
 
-			socket_         = std::exchange(rhs.socket_, INVALID_SOCKET);
-			protocol_       = rhs.protocol_;
-			remote_address_ = std::move(rhs.remote_address_);
-			local_address_  = std::move(rhs.local_address_);
-			blocking_       = rhs.blocking_;
-			connected_      = std::exchange(rhs.connected_, false);
-			native_error_   = std::exchange(rhs.native_error_, SocketError::none);
-			datagram_       = std::move(rhs.datagram_);
+			socket_          = std::exchange(rhs.socket_, INVALID_SOCKET);
+			protocol_        = rhs.protocol_;
+			remote_address_  = std::move(rhs.remote_address_);
+			local_address_   = std::move(rhs.local_address_);
+			blocking_        = rhs.blocking_;
+			connected_       = std::exchange(rhs.connected_, false);
+			options_         = rhs.options_;
+			native_error_    = std::exchange(rhs.native_error_, SocketError::none);
+			datagram_        = std::move(rhs.datagram_);
+			checksum_        = rhs.checksum_;
+			statistics_      = rhs.statistics_;
+			capture_         = rhs.capture_;
+			ingress_limiter_ = rhs.ingress_limiter_;
+			ingress_         = rhs.ingress_;
+			cork_            = std::move(rhs.cork_);
+			zero_copy_       = std::move(rhs.zero_copy_);
+			send_queue_      = std::move(rhs.send_queue_);
+			queued_bytes_    = std::exchange(rhs.queued_bytes_, 0);
+
+			if (cork_)
+			{
+				cork_->owner = this;
+			}
 		}
 
 		return *this;
@@ -114,7 +220,14 @@ namespace sws
 
 		if (result == SOCKET_ERROR)
 		{
-			return get_error_state();
+			const SocketState state = get_error_state();
+
+			// A non-blocking connect is completed by calling connect again;
+			// Winsock then reports WSAEISCONN, which maps to done.
+			if (state != SocketState::done)
+			{
+				return state;
+			}
 		}
 
 		connected_ = true;
@@ -124,7 +237,9 @@ namespace sws
 
 	int Socket::send(const uint8_t* data, int length) const
 	{
-		return ::send(socket_, reinterpret_cast<const char*>(data), length, 0);
+		const int result = ::send(socket_, reinterpret_cast<const char*>(data), length, 0);
+		record_send(result);
+		return result;
 	}
 
 	int Socket::send(std::span<const uint8_t> data) const
@@ -134,7 +249,9 @@ namespace sws
 
 	int Socket::receive(uint8_t* data, int length) const
 	{
-		return ::recv(socket_, reinterpret_cast<char*>(data), length, 0);
+		const int result = ::recv(socket_, reinterpret_cast<char*>(data), length, 0);
+		record_receive(result);
+		return result;
 	}
 
 	int Socket::receive(std::span<uint8_t> data) const
@@ -144,6 +261,8 @@ namespace sws
 
 	SocketState Socket::send(Packet& packet)
 	{
+		const LatencyTimer timer(LatencyMetric::send_call);
+
 		if (packet.empty())
 		{
 			packet.send_reset();
@@ -153,92 +272,467 @@ namespace sws
 		// For "connected" UDP, we don't have to worry about partial writes.
 		if (protocol_ == Protocol::udp)
 		{
-			static_cast<void>(send(packet.data_));
-			return get_error_state();
+			const int sent = checksum_ ? send_checksummed(packet.data_, nullptr) : send(packet.data_);
+
+			if (sent == SOCKET_ERROR)
+			{
+				return get_error_state();
+			}
+
+			statistics_.add(Counter::packets_sent);
+			capture_packet(CaptureDirection::sent, packet.data_, remote_address_);
+			return clear_error_state();
 		}
 
-		if (packet.send_pos_ == -1)
+		// Shared packets queued earlier go first; the packet is not taken until they have.
+		if (!send_queue_.empty() && packet.send_pos_ < 0)
 		{
-			const int sent = send(packet.data_);
+			const SocketState state = flush();
 
-			if (sent > 0)
+			if (state != SocketState::done)
 			{
-				packet.send_pos_ = sent;
+				return state;
 			}
 		}
 
-		auto result = SocketState::done;
-
-		do
+		if (zero_copy_ && packet.send_pos_ < 0 && packet.data_.size() >= zero_copy_->threshold)
 		{
-			if (packet.get_send_remainder() <= 0)
+			// Corked packets were sent first.
+			const SocketState state = flush();
+
+			if (state != SocketState::done)
 			{
-				break;
+				return state;
 			}
 
+			return send_zero_copy(packet);
+		}
+
+		if (cork_)
+		{
+			return send_corked(packet);
+		}
+
+		if (packet.send_pos_ < 0)
+		{
+			packet.send_pos_   = 0;
+			packet.send_start_ = LatencyRecorder::enabled() ? timestamp_now() : 0;
+		}
+
+		while (packet.get_send_remainder() > 0)
+		{
 			const int sent = send(packet.get_send_data(), static_cast<int>(packet.get_send_remainder()));
 
-			if (sent > 0)
+			if (sent == SOCKET_ERROR)
 			{
-				packet.send_pos_ += sent;
+				const SocketState state = get_error_state();
+
+				// On would_block, send_pos_ is kept so the next call resumes where this one left off.
+				if (state != SocketState::in_progress)
+				{
+					packet.send_reset();
+				}
+
+				return state;
 			}
 
-			result = get_error_state();
-		} while (result == SocketState::in_progress);
+			if (!sent)
+			{
+				packet.send_reset();
+				return SocketState::closed;
+			}
+
+			if (static_cast<size_t>(sent) < packet.get_send_remainder())
+			{
+				statistics_.add(Counter::partial_sends);
+			}
+
+			packet.send_pos_ += sent;
+		}
 
 		packet.send_reset();
-		return result;
+		statistics_.add(Counter::packets_sent);
+		capture_packet(CaptureDirection::sent, packet.data_, remote_address_);
+
+		if (packet.send_start_)
+		{
+			LatencyRecorder::record(LatencyMetric::send_queue, timestamp_now() - packet.send_start_);
+		}
+
+		return clear_error_state();
+	}
+
+	SocketState Socket::send(const SharedPacket& packet)
+	{
+		const LatencyTimer timer(LatencyMetric::send_call);
+
+		if (packet.empty())
+		{
+			return clear_error_state();
+		}
+
+		if (protocol_ == Protocol::udp)
+		{
+			const int sent = checksum_ ? send_checksummed(packet.data(), nullptr) : send(packet.data());
+
+			if (sent == SOCKET_ERROR)
+			{
+				return get_error_state();
+			}
+
+			statistics_.add(Counter::packets_sent);
+			capture_packet(CaptureDirection::sent, packet.data(), remote_address_);
+			return clear_error_state();
+		}
+
+		// Corked packets were sent first. If they cannot be, the packet waits behind them.
+		const SocketState state = cork_ ? flush() : SocketState::done;
+
+		send_queue_.push_back({ packet, 0, LatencyRecorder::enabled() ? timestamp_now() : 0 });
+		queued_bytes_ += packet.size();
+
+		if (state != SocketState::done)
+		{
+			if (state != SocketState::in_progress)
+			{
+				send_queue_.clear();
+				queued_bytes_ = 0;
+			}
+
+			return state;
+		}
+
+		return send_queued();
+	}
+
+	size_t Socket::queued_bytes() const
+	{
+		return queued_bytes_;
 	}
 
 	SocketState Socket::receive(Packet& packet)
 	{
+		const LatencyTimer timer(LatencyMetric::receive_call);
+
 		// For "connected" UDP, receive like a datagram.
 		if (protocol_ == Protocol::udp)
 		{
-			return receive_datagram_packet(packet, receive(*datagram_));
+			return receive_datagram_packet(packet, receive(*datagram_), remote_address_);
 		}
 
+		// While the size header is being read, recv_target_ stays negative and
+		// recv_pos_ counts the header bytes received so far.
 		if (packet.recv_pos_ < 0 && packet.recv_target_ < 0)
 		{
 			packet.clear();
+			packet.recv_pos_ = 0;
+		}
+
+		while (packet.recv_target_ < 0)
+		{
+			const int received = receive(packet.get_recv_data(),
+			                             static_cast<int>(sizeof(packetlen_t) - packet.recv_pos_));
+
+			if (received == SOCKET_ERROR || !received)
+			{
+				return receive_failed(packet, received);
+			}
+
+			packet.recv_pos_ += received;
+
+			if (packet.recv_pos_ == static_cast<ptrdiff_t>(sizeof(packetlen_t)))
+			{
+				// A zero size is an empty packet, which leaves nothing more to read.
+				packet.recv_target_ = *reinterpret_cast<const packetlen_t*>(packet.data_.data());
+				packet.resize(packet.recv_target_ + sizeof(packetlen_t));
+			}
 		}
 
-		if (packet.recv_target_ < 0)
+		while (packet.get_recv_remainder() > 0)
 		{
-			packetlen_t size = 0;
-			const int received = receive(reinterpret_cast<uint8_t*>(&size), sizeof(packetlen_t));
+			const int received = receive(packet.get_recv_data(), static_cast<int>(packet.get_recv_remainder()));
 
-			if (received == sizeof(packetlen_t) && size > 0)
+			if (received == SOCKET_ERROR || !received)
 			{
-				packet.recv_target_ = size;
+				return receive_failed(packet, received);
 			}
+
+			packet.recv_pos_ += received;
 		}
 
-		if (packet.recv_target_ <= 0)
+		packet.recv_reset();
+
+		// The whole packet has been read, so dropping it keeps the stream in step.
+		if (ingress_limiter_ && !ingress_limiter_->admit(ingress_, packet.data_.size()))
 		{
-			return get_error_state();
+			statistics_.add(Counter::rate_limited);
+			packet.clear();
+			return SocketState::in_progress;
 		}
 
-		packet.resize(packet.recv_target_ + sizeof(packetlen_t));
-		packet.recv_pos_ = sizeof(packetlen_t);
+		statistics_.add(Counter::packets_received);
+		capture_packet(CaptureDirection::received, packet.data_, remote_address_);
 
-		const int received = receive(packet.get_recv_data(), static_cast<int>(packet.get_recv_remainder()));
+		return clear_error_state();
+	}
 
-		if (received > 0)
+	SocketState Socket::receive_failed(Packet& packet, int received)
+	{
+		if (!received)
 		{
-			packet.recv_pos_ += received;
+			packet.recv_reset();
+			return SocketState::closed;
 		}
 
-		if (!packet.get_recv_remainder())
+		const SocketState state = get_error_state();
+
+		// On would_block, recv_pos_ is kept so the next call resumes where this one left off.
+		if (state != SocketState::in_progress)
 		{
 			packet.recv_reset();
 		}
 
-		return get_error_state();
+		return state;
+	}
+
+	size_t Socket::auto_cork() const
+	{
+		return cork_ ? cork_->threshold : 0;
+	}
+
+	SocketState Socket::auto_cork(size_t threshold, EventLoop* loop)
+	{
+		enforce(protocol_ == Protocol::tcp, "Auto-corking requires a TCP socket.");
+
+		if (!threshold)
+		{
+			if (!cork_)
+			{
+				return clear_error_state();
+			}
+
+			const SocketState state = flush();
+
+			if (state != SocketState::done)
+			{
+				return state;
+			}
+
+			if (cork_->scheduled)
+			{
+				cork_->loop->cancel_flush(*cork_);
+			}
+
+			cork_.reset();
+			return state;
+		}
+
+		if (!cork_)
+		{
+			cork_ = std::make_unique<Cork>();
+			cork_->owner = this;
+		}
+
+		if (cork_->loop != loop && cork_->scheduled)
+		{
+			cork_->loop->cancel_flush(*cork_);
+		}
+
+		cork_->loop      = loop;
+		cork_->threshold = threshold;
+		cork_->buffer.reserve(threshold);
+
+		if (loop && cork_->pending() && !cork_->scheduled)
+		{
+			loop->schedule_flush(*cork_);
+		}
+
+		return clear_error_state();
+	}
+
+	SocketState Socket::flush()
+	{
+		if (!cork_ || !cork_->pending())
+		{
+			return send_queued();
+		}
+
+		Cork& cork = *cork_;
+
+		while (cork.pending())
+		{
+			const size_t remaining = cork.pending();
+			const int sent = send(&cork.buffer[cork.position], static_cast<int>(remaining));
+
+			if (sent == SOCKET_ERROR)
+			{
+				const SocketState state = get_error_state();
+
+				// On would_block, the rest is kept for the next flush.
+				if (state != SocketState::in_progress)
+				{
+					cork.buffer.clear();
+					cork.position = 0;
+				}
+
+				return state;
+			}
+
+			if (!sent)
+			{
+				cork.buffer.clear();
+				cork.position = 0;
+				return SocketState::closed;
+			}
+
+			if (static_cast<size_t>(sent) < remaining)
+			{
+				statistics_.add(Counter::partial_sends);
+			}
+
+			cork.position += sent;
+		}
+
+		if (cork.start)
+		{
+			LatencyRecorder::record(LatencyMetric::send_queue, timestamp_now() - cork.start);
+		}
+
+		cork.buffer.clear();
+		cork.position = 0;
+
+		return send_queued();
+	}
+
+	CaptureSink* Socket::capture() const
+	{
+		return capture_;
+	}
+
+	void Socket::capture(CaptureSink* sink)
+	{
+		capture_ = sink;
+	}
+
+	IngressLimiter* Socket::ingress_limiter() const
+	{
+		return ingress_limiter_;
+	}
+
+	void Socket::ingress_limiter(IngressLimiter* limiter)
+	{
+		ingress_limiter_ = limiter;
+	}
+
+	size_t Socket::zero_copy() const
+	{
+		return zero_copy_ ? zero_copy_->threshold : 0;
+	}
+
+	SocketState Socket::zero_copy(size_t threshold, size_t max_in_flight)
+	{
+		enforce(protocol_ == Protocol::tcp, "Zero-copy sends require a TCP socket.");
+
+		if (!threshold)
+		{
+			if (zero_copy_pending())
+			{
+				native_error_ = SocketError::would_block;
+				return SocketState::in_progress;
+			}
+
+			const std::optional<int> previous = zero_copy_ ? zero_copy_->previous_send_buffer : std::nullopt;
+			zero_copy_.reset();
+
+			if (previous && socket_ != INVALID_SOCKET &&
+			    setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&*previous), sizeof(*previous)) == SOCKET_ERROR)
+			{
+				return get_error_state();
+			}
+
+			return clear_error_state();
+		}
+
+		if (!zero_copy_)
+		{
+			zero_copy_ = std::make_unique<ZeroCopy>();
+		}
+
+		zero_copy_->threshold     = threshold;
+		zero_copy_->max_in_flight = max_in_flight;
+
+		return apply_zero_copy_buffer();
+	}
+
+	SocketState Socket::apply_zero_copy_buffer()
+	{
+		ZeroCopy& zero_copy = *zero_copy_;
+
+		// Applied when the socket is created. Not kept in options_, so that it is
+		// neither inherited by accepted sockets nor left behind when disabled.
+		if (socket_ == INVALID_SOCKET || zero_copy.previous_send_buffer)
+		{
+			return clear_error_state();
+		}
+
+		int previous = 0;
+		int length   = sizeof(previous);
+
+		if (getsockopt(socket_, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<char*>(&previous), &length) == SOCKET_ERROR)
+		{
+			return get_error_state();
+		}
+
+		// Without a send buffer, overlapped sends are transmitted from the caller's memory.
+		const int size = 0;
+
+		if (setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&size), sizeof(size)) == SOCKET_ERROR)
+		{
+			return get_error_state();
+		}
+
+		zero_copy.previous_send_buffer = previous;
+		return clear_error_state();
+	}
+
+	size_t Socket::zero_copy_pending()
+	{
+		if (!zero_copy_)
+		{
+			return 0;
+		}
+
+		reap_zero_copy(false);
+		return zero_copy_->pending;
 	}
 
 	void Socket::close() noexcept
 	{
+		if ((cork_ || !send_queue_.empty()) && socket_ != INVALID_SOCKET)
+		{
+			static_cast<void>(flush());
+		}
+
+		send_queue_.clear();
+		queued_bytes_ = 0;
+
+		if (cork_)
+		{
+			if (cork_->scheduled)
+			{
+				cork_->loop->cancel_flush(*cork_);
+			}
+
+			cork_->buffer.clear();
+			cork_->position = 0;
+		}
+
+		// The stack still owns these buffers, and shutting down would discard unsent data.
+		if (zero_copy_ && socket_ != INVALID_SOCKET)
+		{
+			close_zero_copy();
+		}
+
 		if (socket_ != INVALID_SOCKET)
 		{
 			shutdown(socket_, SD_BOTH);
@@ -266,6 +760,11 @@ namespace sws
 		return native_error_;
 	}
 
+	const SocketStatistics& Socket::statistics() const
+	{
+		return statistics_;
+	}
+
 	SocketError Socket::get_native_error()
 	{
 		return static_cast<SocketError>(WSAGetLastError());
@@ -288,6 +787,82 @@ namespace sws
 		}
 
 		enforce(blocking(blocking_) == SocketState::done);
+
+		if (apply_options(options_, native.ss_family) != SocketState::done)
+		{
+			throw SocketException("failed to apply socket options", native_error_);
+		}
+
+		if (zero_copy_ && apply_zero_copy_buffer() != SocketState::done)
+		{
+			throw SocketException("failed to apply socket options", native_error_);
+		}
+	}
+
+	SocketState Socket::apply_options(const SocketOptions& value, int family)
+	{
+		const auto set = [this](int level, int name, int option)
+		{
+			return setsockopt(socket_, level, name, reinterpret_cast<const char*>(&option), sizeof(option)) != SOCKET_ERROR;
+		};
+
+		if (value.send_buffer_size && !set(SOL_SOCKET, SO_SNDBUF, *value.send_buffer_size))
+		{
+			return get_error_state();
+		}
+
+		if (value.receive_buffer_size && !set(SOL_SOCKET, SO_RCVBUF, *value.receive_buffer_size))
+		{
+			return get_error_state();
+		}
+
+		if (value.reuse_address && !set(SOL_SOCKET, SO_REUSEADDR, *value.reuse_address))
+		{
+			return get_error_state();
+		}
+
+		if (value.type_of_service)
+		{
+			const bool result = family == AF_INET6
+				? set(IPPROTO_IPV6, IPV6_TCLASS, *value.type_of_service)
+				: set(IPPROTO_IP, IP_TOS, *value.type_of_service);
+
+			if (!result)
+			{
+				return get_error_state();
+			}
+		}
+
+		// The remaining options only exist for stream sockets.
+		if (protocol_ != Protocol::tcp)
+		{
+			return clear_error_state();
+		}
+
+		if (value.no_delay && !set(IPPROTO_TCP, TCP_NODELAY, *value.no_delay))
+		{
+			return get_error_state();
+		}
+
+		if (value.keep_alive && !set(SOL_SOCKET, SO_KEEPALIVE, *value.keep_alive))
+		{
+			return get_error_state();
+		}
+
+		if (value.quick_ack)
+		{
+			// 1 acknowledges every segment; 2 is the default delayed acknowledgement.
+			int frequency = *value.quick_ack ? 1 : 2;
+			DWORD bytes = 0;
+
+			if (WSAIoctl(socket_, SIO_TCP_SET_ACK_FREQUENCY, &frequency, sizeof(frequency),
+			             nullptr, 0, &bytes, nullptr, nullptr) == SOCKET_ERROR)
+			{
+				return get_error_state();
+			}
+		}
+
+		return clear_error_state();
 	}
 
 	void Socket::update_local_address()
@@ -347,29 +922,380 @@ namespace sws
 		return SocketState::done;
 	}
 
-	SocketState Socket::receive_datagram_packet(Packet& packet, int received)
+	SocketState Socket::receive_datagram_packet(Packet& packet, int received, const Address& address)
 	{
 		if (received == SOCKET_ERROR || !received)
 		{
 			return get_error_state();
 		}
 
-		enforce(static_cast<size_t>(received) >= sizeof(packetlen_t),
-		        "packet too small to be a packet");
+		if (ingress_limiter_ && !ingress_limiter_->admit(address, static_cast<size_t>(received)))
+		{
+			statistics_.add(Counter::rate_limited);
+			packet.clear();
+			return SocketState::in_progress;
+		}
 
 		uint8_t* data = datagram_->data();
-		const auto size = *reinterpret_cast<packetlen_t*>(data);
 
-		enforce(size == static_cast<packetlen_t>(received) - sizeof(packetlen_t),
-		        "packet contains malformed size");
+		if (checksum_)
+		{
+			uint32_t trailer = 0;
+
+			if (static_cast<size_t>(received) >= sizeof(packetlen_t) + checksum_size)
+			{
+				received -= static_cast<int>(checksum_size);
+				std::memcpy(&trailer, data + received, checksum_size);
+			}
+
+			// Corrupted or stray datagrams are dropped rather than parsed.
+			if (static_cast<size_t>(received) < sizeof(packetlen_t) ||
+			    crc32c(std::span<const uint8_t>(data, static_cast<size_t>(received))) != trailer)
+			{
+				statistics_.add(Counter::checksum_failures);
+				packet.clear();
+				return SocketState::in_progress;
+			}
+		}
+
+		if (static_cast<size_t>(received) < sizeof(packetlen_t) ||
+		    *reinterpret_cast<packetlen_t*>(data) != static_cast<packetlen_t>(received) - sizeof(packetlen_t))
+		{
+			statistics_.add(Counter::malformed_datagrams);
+			packet.clear();
+			return SocketState::in_progress;
+		}
 
 		packet.clear();
 		packet.resize(received);
 		packet.write_pos_ = 0;
 		packet.write_data(datagram_->data(), received, true);
+
+		statistics_.add(Counter::packets_received);
+		capture_packet(CaptureDirection::received, packet.data_, address);
+
 		return clear_error_state();
 	}
 
+	int Socket::send_checksummed(std::span<const uint8_t> data, const Address* address) const
+	{
+		// The trailer is sent from the stack rather than copying the packet to append it.
+		const uint32_t trailer = crc32c(data);
+
+		std::array<WSABUF, 2> buffers {};
+		buffers[0].buf = const_cast<CHAR*>(reinterpret_cast<const CHAR*>(data.data()));
+		buffers[0].len = static_cast<ULONG>(data.size());
+		buffers[1].buf = const_cast<CHAR*>(reinterpret_cast<const CHAR*>(&trailer));
+		buffers[1].len = static_cast<ULONG>(sizeof(trailer));
+
+		DWORD sent   = 0;
+		int   result = SOCKET_ERROR;
+
+		if (address)
+		{
+			const auto native_address = address->to_native();
+
+			result = WSASendTo(socket_, buffers.data(), static_cast<DWORD>(buffers.size()), &sent, 0,
+			                   reinterpret_cast<const sockaddr*>(&native_address),
+			                   static_cast<int>(address->native_size()), nullptr, nullptr);
+		}
+		else
+		{
+			result = WSASend(socket_, buffers.data(), static_cast<DWORD>(buffers.size()), &sent, 0, nullptr, nullptr);
+		}
+
+		if (result != SOCKET_ERROR)
+		{
+			result = static_cast<int>(sent);
+		}
+
+		record_send(result);
+		return result;
+	}
+
+	SocketState Socket::send_corked(Packet& packet)
+	{
+		Cork& cork = *cork_;
+
+		// Back-pressure: don't take more packets while a full buffer can't be sent.
+		if (cork.pending() >= cork.threshold)
+		{
+			const SocketState state = flush();
+
+			if (state != SocketState::done)
+			{
+				return state;
+			}
+		}
+
+		if (!cork.pending())
+		{
+			cork.buffer.clear();
+			cork.position = 0;
+			cork.start    = LatencyRecorder::enabled() ? timestamp_now() : 0;
+		}
+
+		const ptrdiff_t offset = packet.send_pos_ < 0 ? 0 : packet.send_pos_;
+		cork.buffer.insert(cork.buffer.end(), packet.data_.begin() + offset, packet.data_.end());
+
+		packet.send_reset();
+		statistics_.add(Counter::packets_sent);
+		capture_packet(CaptureDirection::sent, packet.data_, remote_address_);
+
+		if (cork.pending() >= cork.threshold)
+		{
+			const SocketState state = flush();
+
+			if (state != SocketState::done && state != SocketState::in_progress)
+			{
+				return state;
+			}
+		}
+
+		if (cork.loop && cork.pending() && !cork.scheduled)
+		{
+			cork.loop->schedule_flush(cork);
+		}
+
+		return clear_error_state();
+	}
+
+	SocketState Socket::send_queued()
+	{
+		// Queued packets are gathered into one native call, rather than one call each.
+		constexpr size_t max_gather = 16;
+
+		while (!send_queue_.empty())
+		{
+			std::array<WSABUF, max_gather> buffers {};
+			DWORD  count = 0;
+			size_t total = 0;
+
+			for (auto it = send_queue_.begin(); it != send_queue_.end() && count < max_gather; ++it)
+			{
+				const std::span<const uint8_t> data = it->packet.data();
+
+				buffers[count].buf = const_cast<CHAR*>(reinterpret_cast<const CHAR*>(data.data() + it->position));
+				buffers[count].len = static_cast<ULONG>(data.size() - it->position);
+
+				total += buffers[count].len;
+				++count;
+			}
+
+			DWORD sent = 0;
+
+			if (WSASend(socket_, buffers.data(), count, &sent, 0, nullptr, nullptr) == SOCKET_ERROR)
+			{
+				record_send(SOCKET_ERROR);
+				const SocketState state = get_error_state();
+
+				// On would_block, the queue is kept for the next send or flush.
+				if (state != SocketState::in_progress)
+				{
+					send_queue_.clear();
+					queued_bytes_ = 0;
+				}
+
+				return state;
+			}
+
+			record_send(static_cast<int>(sent));
+
+			if (!sent)
+			{
+				send_queue_.clear();
+				queued_bytes_ = 0;
+				return SocketState::closed;
+			}
+
+			if (sent < total)
+			{
+				statistics_.add(Counter::partial_sends);
+			}
+
+			queued_bytes_ -= sent;
+
+			for (size_t remaining = sent; remaining > 0;)
+			{
+				QueuedSend& queued = send_queue_.front();
+				const std::span<const uint8_t> data = queued.packet.data();
+				const size_t advance = std::min(remaining, data.size() - queued.position);
+
+				queued.position += advance;
+				remaining       -= advance;
+
+				if (queued.position < data.size())
+				{
+					break;
+				}
+
+				statistics_.add(Counter::packets_sent);
+				capture_packet(CaptureDirection::sent, data, remote_address_);
+
+				if (queued.start)
+				{
+					LatencyRecorder::record(LatencyMetric::send_queue, timestamp_now() - queued.start);
+				}
+
+				send_queue_.pop_front();
+			}
+		}
+
+		return clear_error_state();
+	}
+
+	SocketState Socket::send_zero_copy(Packet& packet)
+	{
+		ZeroCopy& zero_copy = *zero_copy_;
+		reap_zero_copy(false);
+
+		if (zero_copy.pending >= zero_copy.max_in_flight)
+		{
+			native_error_ = SocketError::would_block;
+			return SocketState::in_progress;
+		}
+
+		auto send = zero_copy.acquire();
+
+		const HANDLE event = send->overlapped.hEvent;
+		send->overlapped = {};
+		send->overlapped.hEvent = event;
+		WSAResetEvent(event);
+
+		// Take over the packet's buffer; the packet gets the buffer of an earlier send in return.
+		send->data.swap(packet.data_);
+
+		WSABUF buffer {};
+		buffer.len = static_cast<ULONG>(send->data.size());
+		buffer.buf = reinterpret_cast<CHAR*>(send->data.data());
+
+		DWORD sent = 0;
+
+		if (WSASend(socket_, &buffer, 1, &sent, 0, &send->overlapped, nullptr) == SOCKET_ERROR &&
+		    WSAGetLastError() != WSA_IO_PENDING)
+		{
+			record_send(SOCKET_ERROR);
+			const SocketState state = get_error_state();
+
+			send->data.swap(packet.data_);
+			zero_copy.spare.push_back(std::move(send));
+
+			return state;
+		}
+
+		record_send(static_cast<int>(buffer.len));
+		statistics_.add(Counter::packets_sent);
+		capture_packet(CaptureDirection::sent, send->data, remote_address_);
+
+		zero_copy.pending += buffer.len;
+		zero_copy.in_flight.push_back(std::move(send));
+
+		packet.clear();
+		return clear_error_state();
+	}
+
+	void Socket::reap_zero_copy(bool wait) noexcept
+	{
+		ZeroCopy& zero_copy = *zero_copy_;
+
+		while (!zero_copy.in_flight.empty())
+		{
+			auto& send = zero_copy.in_flight.front();
+
+			DWORD bytes = 0;
+			DWORD flags = 0;
+
+			// A failed send still completes; the error surfaces on the next call on the socket.
+			if (!WSAGetOverlappedResult(socket_, &send->overlapped, &bytes, wait ? TRUE : FALSE, &flags) &&
+			    WSAGetLastError() == WSA_IO_INCOMPLETE)
+			{
+				break;
+			}
+
+			zero_copy.pending -= send->data.size();
+			zero_copy.spare.push_back(std::move(send));
+			zero_copy.in_flight.pop_front();
+		}
+	}
+
+	void Socket::close_zero_copy() noexcept
+	{
+		ZeroCopy& zero_copy = *zero_copy_;
+
+		const auto deadline = std::chrono::steady_clock::now() + zero_copy_close_timeout;
+
+		// A peer which stopped reading would otherwise hold up the close forever.
+		while (!zero_copy.in_flight.empty())
+		{
+			const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+
+			if (remaining.count() <= 0 ||
+			    WSAWaitForMultipleEvents(1, &zero_copy.in_flight.front()->overlapped.hEvent, FALSE,
+			                             static_cast<DWORD>(remaining.count()), FALSE) != WSA_WAIT_EVENT_0)
+			{
+				break;
+			}
+
+			reap_zero_copy(false);
+		}
+
+		if (!zero_copy.in_flight.empty())
+		{
+			// Cancelled sends complete promptly, and their buffers are kept until they have.
+			CancelIoEx(reinterpret_cast<HANDLE>(socket_), nullptr);
+			reap_zero_copy(true);
+		}
+	}
+
+	size_t Socket::Cork::pending() const
+	{
+		return buffer.size() - position;
+	}
+
+	void Socket::capture_packet(CaptureDirection direction, std::span<const uint8_t> data, const Address& address) const
+	{
+		if (capture_)
+		{
+			capture_->capture(protocol_, direction, local_address_, address, data);
+		}
+	}
+
+	void Socket::record_send(int result) const
+	{
+		// Read before counting so that the native error is not disturbed by the first
+		// use of this thread's counters.
+		const bool would_block = result == SOCKET_ERROR && get_native_error() == SocketError::would_block;
+
+		statistics_.add(Counter::send_calls);
+
+		if (result > 0)
+		{
+			statistics_.add(Counter::bytes_sent, static_cast<uint64_t>(result));
+		}
+		else if (would_block)
+		{
+			statistics_.add(Counter::would_block);
+		}
+	}
+
+	void Socket::record_receive(int result) const
+	{
+		// Read before counting so that the native error is not disturbed by the first
+		// use of this thread's counters.
+		const bool would_block = result == SOCKET_ERROR && get_native_error() == SocketError::would_block;
+
+		statistics_.add(Counter::receive_calls);
+
+		if (result > 0)
+		{
+			statistics_.add(Counter::bytes_received, static_cast<uint64_t>(result));
+		}
+		else if (would_block)
+		{
+			statistics_.add(Counter::would_block);
+		}
+	}
+
 	bool Socket::blocking() const
 	{
 		return blocking_;
@@ -394,6 +1320,31 @@ namespace sws
 		return clear_error_state();
 	}
 
+	const SocketOptions& Socket::options() const
+	{
+		return options_;
+	}
+
+	SocketState Socket::options(const SocketOptions& value)
+	{
+		options_.merge(value);
+
+		if (socket_ == INVALID_SOCKET)
+		{
+			return clear_error_state();
+		}
+
+		sockaddr_storage native {};
+		socklen_t length = sizeof(native);
+
+		if (getsockname(socket_, reinterpret_cast<sockaddr*>(&native), &length) == SOCKET_ERROR)
+		{
+			native.ss_family = AF_INET;
+		}
+
+		return apply_options(value, native.ss_family);
+	}
+
 	Protocol Socket::protocol() const
 	{
 		return protocol_;
@@ -0,0 +1,53 @@
+#include "../include/sws/SocketOptions.h"
+
+namespace sws
+{
+	namespace
+	{
+		template <typename T>
+		void merge_option(std::optional<T>& target, const std::optional<T>& source)
+		{
+			if (source.has_value())
+			{
+				target = source;
+			}
+		}
+	}
+
+	SocketOptions& SocketOptions::merge(const SocketOptions& other)
+	{
+		merge_option(send_buffer_size, other.send_buffer_size);
+		merge_option(receive_buffer_size, other.receive_buffer_size);
+		merge_option(no_delay, other.no_delay);
+		merge_option(quick_ack, other.quick_ack);
+		merge_option(keep_alive, other.keep_alive);
+		merge_option(reuse_address, other.reuse_address);
+		merge_option(type_of_service, other.type_of_service);
+
+		return *this;
+	}
+
+	SocketOptions SocketOptions::low_latency()
+	{
+		SocketOptions result;
+
+		result.no_delay  = true;
+		result.quick_ack = true;
+
+		return result;
+	}
+
+	SocketOptions SocketOptions::high_throughput()
+	{
+		constexpr int buffer_size = 4 * 1024 * 1024;
+
+		SocketOptions result;
+
+		result.no_delay            = false;
+		result.quick_ack           = false;
+		result.send_buffer_size    = buffer_size;
+		result.receive_buffer_size = buffer_size;
+
+		return result;
+	}
+}
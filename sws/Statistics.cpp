@@ -0,0 +1,210 @@
+#include "../include/sws/Statistics.h"
+#include "../include/sws/ConcurrentQueue.h"
+
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+#include "thread_shards.h"
+
+namespace sws
+{
+	namespace
+	{
+		// Single writer: a relaxed load and store is enough and avoids a locked add.
+		void increment(std::atomic<uint64_t>& counter, uint64_t amount)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+
+		struct alignas(cache_line_size) CounterShard
+		{
+			std::array<std::atomic<uint64_t>, counter_count> counters {};
+
+			// Called with the shards' lock held, when the thread owning `other` exits.
+			void merge(const CounterShard& other)
+			{
+				for (size_t i = 0; i < counter_count; ++i)
+				{
+					increment(counters[i], other.counters[i].load(std::memory_order_relaxed));
+				}
+			}
+		};
+
+		constexpr std::array<std::string_view, counter_count> counter_names =
+		{
+			"bytes_sent",
+			"bytes_received",
+			"packets_sent",
+			"packets_received",
+			"send_calls",
+			"receive_calls",
+			"would_block",
+			"partial_sends",
+			"malformed_datagrams",
+			"checksum_failures",
+			"rate_limited"
+		};
+
+		constexpr std::array<std::string_view, counter_count> counter_help =
+		{
+			"Bytes sent.",
+			"Bytes received.",
+			"Packets sent.",
+			"Packets received.",
+			"Native send calls.",
+			"Native receive calls.",
+			"Native calls which would have blocked.",
+			"Native sends which accepted only part of a packet.",
+			"Datagrams rejected as malformed.",
+			"Datagrams dropped for a mismatched checksum.",
+			"Packets dropped for exceeding an ingress rate limit."
+		};
+	}
+
+	std::string_view to_string(Counter counter)
+	{
+		return counter_names[static_cast<size_t>(counter)];
+	}
+
+	uint64_t StatisticsSnapshot::operator[](Counter counter) const
+	{
+		return values[static_cast<size_t>(counter)];
+	}
+
+	StatisticsSnapshot& StatisticsSnapshot::operator+=(const StatisticsSnapshot& rhs)
+	{
+		for (size_t i = 0; i < counter_count; ++i)
+		{
+			values[i] += rhs.values[i];
+		}
+
+		return *this;
+	}
+
+	StatisticsSnapshot& StatisticsSnapshot::operator-=(const StatisticsSnapshot& rhs)
+	{
+		for (size_t i = 0; i < counter_count; ++i)
+		{
+			values[i] -= rhs.values[i];
+		}
+
+		return *this;
+	}
+
+	StatisticsSnapshot operator+(StatisticsSnapshot lhs, const StatisticsSnapshot& rhs)
+	{
+		return lhs += rhs;
+	}
+
+	StatisticsSnapshot operator-(StatisticsSnapshot lhs, const StatisticsSnapshot& rhs)
+	{
+		return lhs -= rhs;
+	}
+
+	SocketStatistics::SocketStatistics(const SocketStatistics& other)
+	{
+		*this = other;
+	}
+
+	SocketStatistics& SocketStatistics::operator=(const SocketStatistics& other)
+	{
+		for (size_t i = 0; i < counter_count; ++i)
+		{
+			counters_[i].store(other.counters_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		return *this;
+	}
+
+	void SocketStatistics::add(Counter counter, uint64_t amount)
+	{
+		const auto index = static_cast<size_t>(counter);
+
+		increment(counters_[index], amount);
+		increment(ThreadShards<CounterShard>::local().counters[index], amount);
+	}
+
+	uint64_t SocketStatistics::get(Counter counter) const
+	{
+		return counters_[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+	}
+
+	StatisticsSnapshot SocketStatistics::snapshot() const
+	{
+		StatisticsSnapshot result;
+
+		for (size_t i = 0; i < counter_count; ++i)
+		{
+			result.values[i] = counters_[i].load(std::memory_order_relaxed);
+		}
+
+		return result;
+	}
+
+	void SocketStatistics::reset()
+	{
+		for (auto& counter : counters_)
+		{
+			counter.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	StatisticsSnapshot global_statistics()
+	{
+		StatisticsSnapshot result;
+
+		ThreadShards<CounterShard>::for_each([&](const CounterShard& shard)
+		{
+			for (size_t i = 0; i < counter_count; ++i)
+			{
+				result.values[i] += shard.counters[i].load(std::memory_order_relaxed);
+			}
+		});
+
+		return result;
+	}
+
+	std::string to_prometheus(const StatisticsSnapshot& snapshot, std::string_view prefix)
+	{
+		std::ostringstream stream;
+
+		for (size_t i = 0; i < counter_count; ++i)
+		{
+			std::string name(prefix);
+
+			if (!name.empty())
+			{
+				name += '_';
+			}
+
+			name += counter_names[i];
+			name += "_total";
+
+			stream << "# HELP " << name << ' ' << counter_help[i] << '\n'
+			       << "# TYPE " << name << " counter\n"
+			       << name << ' ' << snapshot.values[i] << '\n';
+		}
+
+		return stream.str();
+	}
+
+	bool write_prometheus(const std::filesystem::path& path, const StatisticsSnapshot& snapshot, std::string_view prefix)
+	{
+		auto temporary = path;
+		temporary += ".tmp";
+
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+			if (!file || !(file << to_prometheus(snapshot, prefix)) || !file.flush())
+			{
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporary, path, error);
+		return !error;
+	}
+}
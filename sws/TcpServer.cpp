@@ -0,0 +1,150 @@
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#include "../include/sws/TcpServer.h"
+#include "../include/sws/enforce.h"
+
+#include <algorithm>
+
+namespace sws
+{
+	TcpServer::TcpServer(size_t worker_count, int backlog, bool pin_threads)
+		: listener_(false),
+		  worker_count_(worker_count ? worker_count : std::max(1u, std::thread::hardware_concurrency())),
+		  backlog_(backlog),
+		  pin_threads_(pin_threads)
+	{
+	}
+
+	TcpServer::~TcpServer()
+	{
+		stop();
+	}
+
+	SocketState TcpServer::start(const Address& address, AcceptHandler handler)
+	{
+		enforce(workers_.empty(), "Server is already running.");
+		enforce(static_cast<bool>(handler), "An accept handler is required.");
+
+		SocketState result = listener_.bind(address);
+
+		if (result != SocketState::done)
+		{
+			return result;
+		}
+
+		result = listener_.listen(backlog_);
+
+		if (result != SocketState::done)
+		{
+			listener_.close();
+			return result;
+		}
+
+		handler_ = std::move(handler);
+
+		for (size_t i = 0; i < worker_count_; ++i)
+		{
+			auto worker = std::make_unique<Worker>();
+			EventLoop& loop = worker->loop;
+
+			loop.add(listener_, PollEvents::read, [this, &loop](PollEvents)
+			{
+				accept_connections(loop);
+			});
+
+			worker->thread = std::thread([&loop]
+			{
+				loop.run();
+			});
+
+			if (pin_threads_)
+			{
+				pin_thread(worker->thread, i);
+			}
+
+			workers_.push_back(std::move(worker));
+		}
+
+		return SocketState::done;
+	}
+
+	void TcpServer::stop()
+	{
+		for (auto& worker : workers_)
+		{
+			worker->loop.stop();
+		}
+
+		for (auto& worker : workers_)
+		{
+			if (worker->thread.joinable())
+			{
+				worker->thread.join();
+			}
+		}
+
+		workers_.clear();
+		listener_.close();
+	}
+
+	size_t TcpServer::worker_count() const
+	{
+		return worker_count_;
+	}
+
+	EventLoop& TcpServer::loop(size_t index)
+	{
+		return workers_.at(index)->loop;
+	}
+
+	TcpSocket& TcpServer::listener()
+	{
+		return listener_;
+	}
+
+	const Address& TcpServer::local_address() const
+	{
+		return listener_.local_address();
+	}
+
+	SocketError TcpServer::native_error() const
+	{
+		return listener_.native_error();
+	}
+
+	void TcpServer::accept_connections(EventLoop& loop)
+	{
+		// Called concurrently from every worker; only the native socket of
+		// the listener may be touched here, never its error state.
+		for (size_t i = 0; i < accept_batch; ++i)
+		{
+			const NativeSocket sock = ::accept(listener_.socket_, nullptr, nullptr);
+
+			if (sock == INVALID_SOCKET)
+			{
+				// A pending connection was reset before it could be accepted.
+				if (Socket::get_native_error() == SocketError::connection_reset)
+				{
+					continue;
+				}
+
+				// would_block: another worker took it, or the queue is empty.
+				return;
+			}
+
+			TcpSocket socket(false);
+			socket.adopt(sock, listener_);
+
+			handler_(loop, std::move(socket));
+		}
+	}
+
+	void TcpServer::pin_thread(std::thread& thread, size_t processor)
+	{
+		const size_t bits = sizeof(DWORD_PTR) * 8;
+		const auto mask = static_cast<DWORD_PTR>(1) << (processor % bits);
+
+		SetThreadAffinityMask(thread.native_handle(), mask);
+	}
+}
@@ -1,7 +1,45 @@
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <MSWSock.h>
+
 #include "../include/sws/TcpSocket.h"
+#include "../include/sws/enforce.h"
+#include "../include/sws/Histogram.h"
+#include "../include/sws/SocketException.h"
+
+#include <algorithm>
+#include <climits>
+#include <system_error>
 
 namespace sws
 {
+	namespace
+	{
+		// TransmitFile is only reachable through an extension function pointer.
+		LPFN_TRANSMITFILE get_transmit_file(NativeSocket socket)
+		{
+			static const LPFN_TRANSMITFILE function = [socket]
+			{
+				GUID guid = WSAID_TRANSMITFILE;
+				LPFN_TRANSMITFILE result = nullptr;
+				DWORD bytes = 0;
+
+				if (WSAIoctl(socket, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid),
+				             &result, sizeof(result), &bytes, nullptr, nullptr) == SOCKET_ERROR)
+				{
+					return LPFN_TRANSMITFILE(nullptr);
+				}
+
+				return result;
+			}();
+
+			return function;
+		}
+
+		// Largest number of bytes TransmitFile accepts in one call.
+		constexpr uint64_t max_transmit_size = INT_MAX - 1;
+	}
+
 	TcpSocket::TcpSocket()
 		: Socket(Protocol::tcp, true)
 	{
@@ -12,9 +50,9 @@ namespace sws
 	{
 	}
 
-	SocketState TcpSocket::listen()
+	SocketState TcpSocket::listen(int backlog)
 	{
-		if (::listen(socket_, SOMAXCONN) == SOCKET_ERROR)
+		if (::listen(socket_, backlog) == SOCKET_ERROR)
 		{
 			return get_error_state();
 		}
@@ -32,12 +70,128 @@ namespace sws
 		}
 
 		s = TcpSocket(blocking_);
+		s.adopt(sock, *this);
+
+		return clear_error_state();
+	}
+
+	SocketState TcpSocket::send_file(FileTransfer& file)
+	{
+		enforce(file.is_open(), "File transfer has no open file.");
+
+		const LatencyTimer timer(LatencyMetric::send_call);
+
+		if (file.done())
+		{
+			return clear_error_state();
+		}
+
+		// Anything corked or queued was sent before the file.
+		if (cork_ || !send_queue_.empty())
+		{
+			const SocketState state = flush();
+
+			if (state != SocketState::done)
+			{
+				return state;
+			}
+		}
+
+		return blocking_ ? transmit_file(file) : send_mapped(file);
+	}
+
+	SocketState TcpSocket::transmit_file(FileTransfer& file)
+	{
+		const LPFN_TRANSMITFILE transmit = get_transmit_file(socket_);
+
+		if (!transmit)
+		{
+			return send_mapped(file);
+		}
+
+		// The offset to transmit from is passed through the overlapped structure;
+		// waiting on its event keeps the call blocking.
+		WSAOVERLAPPED overlapped {};
+		overlapped.hEvent = WSACreateEvent();
+
+		if (overlapped.hEvent == WSA_INVALID_EVENT)
+		{
+			throw SocketException("WSACreateEvent failed", get_native_error());
+		}
+
+		SocketState state = SocketState::done;
+
+		while (!file.done())
+		{
+			const auto length = static_cast<DWORD>(std::min(file.remaining(), max_transmit_size));
+
+			overlapped.Offset     = static_cast<DWORD>(file.position());
+			overlapped.OffsetHigh = static_cast<DWORD>(file.position() >> 32);
+			WSAResetEvent(overlapped.hEvent);
+
+			DWORD sent  = 0;
+			DWORD flags = 0;
+
+			if ((!transmit(socket_, file.file_, length, 0, &overlapped, nullptr, 0) && WSAGetLastError() != WSA_IO_PENDING) ||
+			    !WSAGetOverlappedResult(socket_, &overlapped, &sent, TRUE, &flags))
+			{
+				record_send(SOCKET_ERROR);
+				state = get_error_state();
+				break;
+			}
+
+			if (!sent)
+			{
+				state = SocketState::closed;
+				break;
+			}
+
+			record_send(static_cast<int>(sent));
+			file.advance(sent);
+		}
+
+		WSACloseEvent(overlapped.hEvent);
+
+		if (state != SocketState::done)
+		{
+			return state;
+		}
+
+		return clear_error_state();
+	}
+
+	SocketState TcpSocket::send_mapped(FileTransfer& file)
+	{
+		while (!file.done())
+		{
+			if (!file.map())
+			{
+				throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "Failed to map file for transfer");
+			}
 
-		s.socket_ = sock;
-		s.connected_ = true;
+			const uint64_t available = file.view_offset_ + file.view_size_ - file.position();
+			const auto length = static_cast<int>(std::min<uint64_t>(available, INT_MAX));
 
-		s.blocking(blocking_);
-		s.update_addresses();
+			const int sent = send(file.view_ + (file.position() - file.view_offset_), length);
+
+			// On would_block, the transfer keeps its position so the next call resumes from it.
+			if (sent == SOCKET_ERROR)
+			{
+				return get_error_state();
+			}
+
+			if (!sent)
+			{
+				return SocketState::closed;
+			}
+
+			if (sent < length)
+			{
+				statistics_.add(Counter::partial_sends);
+			}
+
+			file.advance(static_cast<uint64_t>(sent));
+		}
 
 		return clear_error_state();
 	}
@@ -109,4 +263,20 @@ namespace sws
 	{
 		return receive_all(data.data(), static_cast<int>(data.size()));
 	}
+
+	void TcpSocket::adopt(NativeSocket socket, const TcpSocket& listener)
+	{
+		options_         = listener.options_;
+		capture_         = listener.capture_;
+		ingress_limiter_ = listener.ingress_limiter_;
+
+		socket_ = socket;
+		connected_ = true;
+
+		blocking(blocking_);
+		update_addresses();
+
+		// Best effort, like the blocking state above; the connection is usable either way.
+		static_cast<void>(apply_options(options_, local_address_.family == AddressFamily::inet6 ? AF_INET6 : AF_INET));
+	}
 }
@@ -0,0 +1,456 @@
+#include "../include/sws/TimerWheel.h"
+#include "../include/sws/enforce.h"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace sws
+{
+	namespace
+	{
+		constexpr uint64_t slot_mask = TimerWheel::level_slots - 1;
+
+		constexpr size_t shift(size_t level)
+		{
+			return TimerWheel::level_bits * level;
+		}
+	}
+
+	bool TimerId::valid() const
+	{
+		return index != UINT32_MAX;
+	}
+
+	TimerWheel::TimerWheel(clock::duration resolution, clock::time_point start)
+		: resolution_(resolution),
+		  origin_(start)
+	{
+		enforce(resolution.count() > 0, "Timer resolution must be positive.");
+
+		for (auto& level : levels_)
+		{
+			level.heads.fill(nil);
+		}
+	}
+
+	TimerId TimerWheel::schedule(clock::duration delay, Callback callback)
+	{
+		return schedule_at(clock::now() + delay, std::move(callback));
+	}
+
+	TimerId TimerWheel::schedule_at(clock::time_point when, Callback callback)
+	{
+		enforce(static_cast<bool>(callback), "A timer callback is required.");
+
+		const uint32_t index = allocate();
+		Node& node = nodes_[index];
+
+		node.callback = std::move(callback);
+		node.expiry   = std::max(to_tick(when), current_ + 1);
+		node.state    = NodeState::armed;
+
+		link(index);
+		++armed_;
+
+		return { index, node.generation };
+	}
+
+	bool TimerWheel::reschedule(TimerId id, clock::duration delay)
+	{
+		return reschedule_at(id, clock::now() + delay);
+	}
+
+	bool TimerWheel::reschedule_at(TimerId id, clock::time_point when)
+	{
+		Node* node = get(id);
+
+		if (!node)
+		{
+			return false;
+		}
+
+		if (node->state == NodeState::armed)
+		{
+			unlink(id.index);
+		}
+		else
+		{
+			// rescheduled from its own callback
+			node->state = NodeState::armed;
+			++armed_;
+		}
+
+		node->expiry = std::max(to_tick(when), current_ + 1);
+		link(id.index);
+
+		return true;
+	}
+
+	bool TimerWheel::cancel(TimerId id)
+	{
+		Node* node = get(id);
+
+		if (!node)
+		{
+			return false;
+		}
+
+		if (node->state == NodeState::armed)
+		{
+			unlink(id.index);
+			--armed_;
+		}
+
+		if (node->dispatching)
+		{
+			// Released once the callback returns, even if it rescheduled itself first.
+			node->state = NodeState::cancelled;
+			return true;
+		}
+
+		release(id.index);
+
+		return true;
+	}
+
+	bool TimerWheel::armed(TimerId id) const
+	{
+		const Node* node = get(id);
+		return node && node->state == NodeState::armed;
+	}
+
+	size_t TimerWheel::advance(clock::time_point now)
+	{
+		if (now < origin_)
+		{
+			return 0;
+		}
+
+		const auto target = static_cast<uint64_t>((now - origin_) / resolution_);
+		size_t fired = 0;
+
+		while (current_ < target)
+		{
+			if (!armed_)
+			{
+				current_ = target;
+				break;
+			}
+
+			const uint64_t next = current_ + 1;
+
+			if (!(next & slot_mask))
+			{
+				// Start of a new rotation; pull the next slot of each coarser
+				// level down for as long as that level is also wrapping around.
+				current_ = next;
+
+				for (size_t level = 1; level < level_count; ++level)
+				{
+					cascade(level);
+
+					if ((next >> shift(level)) & slot_mask)
+					{
+						break;
+					}
+				}
+
+				fired += fire(next);
+				continue;
+			}
+
+			// Skip straight to the next occupied slot in this rotation, if any.
+			const uint64_t  rotation = next & ~slot_mask;
+			const ptrdiff_t slot     = next_occupied(0, static_cast<size_t>(next & slot_mask));
+
+			if (slot < 0)
+			{
+				current_ = std::min(target, rotation + slot_mask);
+				continue;
+			}
+
+			const uint64_t due = rotation + static_cast<uint64_t>(slot);
+
+			if (due > target)
+			{
+				current_ = target;
+				break;
+			}
+
+			current_ = due;
+			fired += fire(due);
+		}
+
+		return fired;
+	}
+
+	TimerWheel::clock::time_point TimerWheel::next_expiry() const
+	{
+		if (!armed_)
+		{
+			return clock::time_point::max();
+		}
+
+		// The first level gives exact expiries; coarser levels give the tick at
+		// which their next occupied slot cascades, which is never later.
+		uint64_t earliest = UINT64_MAX;
+
+		for (size_t level = 0; level < level_count; ++level)
+		{
+			const auto& occupied = levels_[level].occupied;
+
+			if (std::none_of(occupied.begin(), occupied.end(), [](uint64_t bits) { return bits != 0; }))
+			{
+				continue;
+			}
+
+			const uint64_t position = (current_ >> shift(level)) + 1;
+			const uint64_t rotation = position & ~slot_mask;
+			uint64_t slot = 0;
+
+			if (position & slot_mask)
+			{
+				const ptrdiff_t found = next_occupied(level, static_cast<size_t>(position & slot_mask));
+
+				// Slots behind the current position belong to the next rotation.
+				slot = found < 0 ? level_slots : static_cast<uint64_t>(found);
+			}
+
+			earliest = std::min(earliest, (rotation + slot) << shift(level));
+		}
+
+		return from_tick(earliest);
+	}
+
+	size_t TimerWheel::size() const
+	{
+		return armed_;
+	}
+
+	bool TimerWheel::empty() const
+	{
+		return !armed_;
+	}
+
+	uint64_t TimerWheel::to_tick(clock::time_point when) const
+	{
+		if (when <= origin_)
+		{
+			return 0;
+		}
+
+		// Round up so that timers never fire early.
+		const auto elapsed = when - origin_;
+		return static_cast<uint64_t>((elapsed + resolution_ - clock::duration(1)) / resolution_);
+	}
+
+	TimerWheel::clock::time_point TimerWheel::from_tick(uint64_t tick) const
+	{
+		return origin_ + resolution_ * static_cast<clock::rep>(tick);
+	}
+
+	TimerWheel::Node* TimerWheel::get(TimerId id)
+	{
+		return const_cast<Node*>(std::as_const(*this).get(id));
+	}
+
+	const TimerWheel::Node* TimerWheel::get(TimerId id) const
+	{
+		if (id.index >= nodes_.size())
+		{
+			return nullptr;
+		}
+
+		const Node& node = nodes_[id.index];
+
+		if (node.generation != id.generation ||
+		    (node.state != NodeState::armed && node.state != NodeState::firing))
+		{
+			return nullptr;
+		}
+
+		return &node;
+	}
+
+	uint32_t TimerWheel::allocate()
+	{
+		if (!free_.empty())
+		{
+			const uint32_t index = free_.back();
+			free_.pop_back();
+			return index;
+		}
+
+		enforce(nodes_.size() < nil, "Too many timers.");
+
+		nodes_.emplace_back();
+		return static_cast<uint32_t>(nodes_.size() - 1);
+	}
+
+	void TimerWheel::release(uint32_t index)
+	{
+		Node& node = nodes_[index];
+
+		node.callback = nullptr;
+		node.state    = NodeState::free;
+		++node.generation;
+
+		free_.push_back(index);
+	}
+
+	void TimerWheel::link(uint32_t index)
+	{
+		Node& node = nodes_[index];
+		const uint64_t delta = node.expiry - current_;
+
+		size_t level = 0;
+
+		while (level < level_count - 1 && delta >= (uint64_t(1) << shift(level + 1)))
+		{
+			++level;
+		}
+
+		size_t slot;
+
+		if (delta >= (uint64_t(1) << shift(level_count)))
+		{
+			// Beyond the range of the wheel; park it in the last slot of the
+			// top level to be re-linked when that slot cascades.
+			slot = static_cast<size_t>(((current_ >> shift(level)) + slot_mask) & slot_mask);
+		}
+		else
+		{
+			slot = static_cast<size_t>((node.expiry >> shift(level)) & slot_mask);
+		}
+
+		Level& target = levels_[level];
+
+		node.slot = static_cast<uint16_t>(level * level_slots + slot);
+		node.prev = nil;
+		node.next = target.heads[slot];
+
+		if (node.next != nil)
+		{
+			nodes_[node.next].prev = index;
+		}
+
+		target.heads[slot] = index;
+		target.occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+	}
+
+	void TimerWheel::unlink(uint32_t index)
+	{
+		Node& node = nodes_[index];
+
+		Level& level = levels_[node.slot / level_slots];
+		const size_t slot = node.slot % level_slots;
+
+		if (node.prev != nil)
+		{
+			nodes_[node.prev].next = node.next;
+		}
+		else
+		{
+			level.heads[slot] = node.next;
+		}
+
+		if (node.next != nil)
+		{
+			nodes_[node.next].prev = node.prev;
+		}
+
+		if (level.heads[slot] == nil)
+		{
+			level.occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+		}
+
+		node.prev = nil;
+		node.next = nil;
+	}
+
+	void TimerWheel::cascade(size_t level)
+	{
+		Level& source = levels_[level];
+		const auto slot = static_cast<size_t>((current_ >> shift(level)) & slot_mask);
+
+		uint32_t index = std::exchange(source.heads[slot], nil);
+		source.occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+
+		while (index != nil)
+		{
+			const uint32_t next = nodes_[index].next;
+			link(index);
+			index = next;
+		}
+	}
+
+	size_t TimerWheel::fire(uint64_t tick)
+	{
+		const auto slot = static_cast<size_t>(tick & slot_mask);
+		size_t fired = 0;
+
+		// Callbacks may cancel timers in this slot, but can't add to it since
+		// new expiries are always later than the current tick.
+		uint32_t index;
+
+		while ((index = levels_[0].heads[slot]) != nil)
+		{
+			unlink(index);
+
+			nodes_[index].state       = NodeState::firing;
+			nodes_[index].dispatching = true;
+			--armed_;
+			++fired;
+
+			try
+			{
+				nodes_[index].callback();
+			}
+			catch (...)
+			{
+				finish(index);
+				throw;
+			}
+
+			finish(index);
+		}
+
+		return fired;
+	}
+
+	void TimerWheel::finish(uint32_t index)
+	{
+		// A timer rescheduled by its callback stays armed; anything else is done with.
+		nodes_[index].dispatching = false;
+
+		const NodeState state = nodes_[index].state;
+
+		if (state == NodeState::firing || state == NodeState::cancelled)
+		{
+			release(index);
+		}
+	}
+
+	ptrdiff_t TimerWheel::next_occupied(size_t level, size_t from) const
+	{
+		const auto& occupied = levels_[level].occupied;
+
+		for (size_t word = from / 64; word < occupied.size(); ++word)
+		{
+			uint64_t bits = occupied[word];
+
+			if (word == from / 64)
+			{
+				bits &= ~uint64_t(0) << (from % 64);
+			}
+
+			if (bits)
+			{
+				return static_cast<ptrdiff_t>(word * 64 + std::countr_zero(bits));
+			}
+		}
+
+		return -1;
+	}
+}
@@ -0,0 +1,91 @@
+#include "../include/sws/TokenBucket.h"
+#include "../include/sws/enforce.h"
+
+#include <algorithm>
+
+namespace sws
+{
+	TokenBucket::TokenBucket(double rate, double burst)
+		: rate_(rate),
+		  burst_(burst),
+		  tokens_(burst),
+		  last_(clock::now())
+	{
+		enforce(rate >= 0.0, "token bucket rate must be non-negative");
+		enforce(burst >= 0.0, "token bucket burst must be non-negative");
+	}
+
+	void TokenBucket::refill(clock::time_point now)
+	{
+		if (now <= last_)
+		{
+			return;
+		}
+
+		const std::chrono::duration<double> elapsed = now - last_;
+
+		tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+		last_   = now;
+	}
+
+	bool TokenBucket::try_consume(double amount, clock::time_point now)
+	{
+		if (unlimited())
+		{
+			return true;
+		}
+
+		refill(now);
+
+		// Amounts larger than the burst size are allowed through once the bucket
+		// is full; the bucket then goes into debt so the long-term rate holds.
+		if (tokens_ < std::min(amount, burst_))
+		{
+			return false;
+		}
+
+		tokens_ -= amount;
+		return true;
+	}
+
+	TokenBucket::clock::duration TokenBucket::time_until(double amount, clock::time_point now) const
+	{
+		if (unlimited())
+		{
+			return clock::duration::zero();
+		}
+
+		const std::chrono::duration<double> elapsed = now > last_ ? now - last_ : clock::duration::zero();
+
+		const double available = std::min(burst_, tokens_ + elapsed.count() * rate_);
+		const double required  = std::min(amount, burst_);
+
+		if (available >= required)
+		{
+			return clock::duration::zero();
+		}
+
+		const std::chrono::duration<double> wait((required - available) / rate_);
+		return std::chrono::ceil<clock::duration>(wait);
+	}
+
+	double TokenBucket::rate() const
+	{
+		return rate_;
+	}
+
+	double TokenBucket::burst() const
+	{
+		return burst_;
+	}
+
+	double TokenBucket::tokens() const
+	{
+		return tokens_;
+	}
+
+	bool TokenBucket::unlimited() const
+	{
+		return rate_ <= 0.0;
+	}
+}
@@ -1,8 +1,57 @@
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <WS2tcpip.h>
+#include <MSWSock.h>
+#include <mstcpip.h>
+
 #include "../include/sws/UdpSocket.h"
+#include "../include/sws/enforce.h"
+#include "../include/sws/Histogram.h"
 #include "../include/sws/Packet.h"
 
+#include <cstring>
+
 namespace sws
 {
+	namespace
+	{
+		// WSARecvMsg is only reachable through an extension function pointer.
+		LPFN_WSARECVMSG get_recvmsg(NativeSocket socket)
+		{
+			static const LPFN_WSARECVMSG function = [socket]
+			{
+				GUID guid = WSAID_WSARECVMSG;
+				LPFN_WSARECVMSG result = nullptr;
+				DWORD bytes = 0;
+
+				if (WSAIoctl(socket, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid),
+				             &result, sizeof(result), &bytes, nullptr, nullptr) == SOCKET_ERROR)
+				{
+					return LPFN_WSARECVMSG(nullptr);
+				}
+
+				return result;
+			}();
+
+			return function;
+		}
+
+		// Same conversion as std::chrono::steady_clock, so that the result
+		// can be compared with sws::timestamp_now().
+		uint64_t ticks_to_nanoseconds(uint64_t ticks)
+		{
+			static const uint64_t frequency = []
+			{
+				LARGE_INTEGER value {};
+				QueryPerformanceFrequency(&value);
+				return static_cast<uint64_t>(value.QuadPart);
+			}();
+
+			constexpr uint64_t period = 1'000'000'000;
+			return (ticks / frequency) * period + (ticks % frequency) * period / frequency;
+		}
+	}
+
 	UdpSocket::UdpSocket()
 		: Socket(Protocol::udp, true)
 	{
@@ -18,12 +67,15 @@ namespace sws
 		const auto native_address = address.to_native();
 		const auto size = static_cast<int>(address.native_size());
 
-		return sendto(socket_,
-		              reinterpret_cast<const char*>(data),
-		              length,
-		              0,
-		              reinterpret_cast<const sockaddr*>(&native_address),
-		              size);
+		const int result = sendto(socket_,
+		                          reinterpret_cast<const char*>(data),
+		                          length,
+		                          0,
+		                          reinterpret_cast<const sockaddr*>(&native_address),
+		                          size);
+
+		record_send(result);
+		return result;
 	}
 
 	int UdpSocket::send_to(std::span<const uint8_t> data, const Address& address) const
@@ -39,6 +91,7 @@ namespace sws
 		auto ptr = reinterpret_cast<sockaddr*>(&native);
 
 		const int result = recvfrom(socket_, reinterpret_cast<char*>(data), length, 0, ptr, &size);
+		record_receive(result);
 
 		if (result != SOCKET_ERROR)
 		{
@@ -53,25 +106,260 @@ namespace sws
 		return receive_from(data.data(), static_cast<int>(data.size()), address);
 	}
 
+	int UdpSocket::receive_from(std::span<uint8_t> data, Address& address, uint64_t& timestamp) const
+	{
+		timestamp = 0;
+
+		const LPFN_WSARECVMSG recvmsg = get_recvmsg(socket_);
+
+		if (!recvmsg)
+		{
+			return receive_from(data, address);
+		}
+
+		sockaddr_storage native {};
+		alignas(WSACMSGHDR) char control[WSA_CMSG_SPACE(sizeof(UINT64))] {};
+
+		WSABUF buffer {};
+		buffer.len = static_cast<ULONG>(data.size());
+		buffer.buf = reinterpret_cast<CHAR*>(data.data());
+
+		WSAMSG message {};
+		message.name          = reinterpret_cast<sockaddr*>(&native);
+		message.namelen       = sizeof(native);
+		message.lpBuffers     = &buffer;
+		message.dwBufferCount = 1;
+		message.Control.len   = sizeof(control);
+		message.Control.buf   = control;
+
+		DWORD received = 0;
+		const int result = recvmsg(socket_, &message, &received, nullptr, nullptr) == SOCKET_ERROR
+			? SOCKET_ERROR
+			: static_cast<int>(received);
+
+		record_receive(result);
+
+		if (result == SOCKET_ERROR)
+		{
+			return result;
+		}
+
+		address = Address::from_native(message.name);
+
+		for (auto header = WSA_CMSG_FIRSTHDR(&message); header; header = WSA_CMSG_NXTHDR(&message, header))
+		{
+			if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SO_TIMESTAMP)
+			{
+				UINT64 ticks = 0;
+				std::memcpy(&ticks, WSA_CMSG_DATA(header), sizeof(ticks));
+				timestamp = ticks_to_nanoseconds(ticks);
+			}
+		}
+
+		return result;
+	}
+
 	SocketState UdpSocket::send_to(const Packet& packet, const Address& address)
 	{
+		const LatencyTimer timer(LatencyMetric::send_call);
+
 		if (packet.empty())
 		{
 			return clear_error_state();
 		}
 
-		const int sent = send_to(packet.data(), address);
+		const int sent = checksum_ ? send_checksummed(packet.data(), &address) : send_to(packet.data(), address);
 
 		if (!sent || sent == SOCKET_ERROR)
 		{
 			return get_error_state();
 		}
 
+		statistics_.add(Counter::packets_sent);
+		capture_packet(CaptureDirection::sent, packet.data(), address);
+
 		return clear_error_state();
 	}
 
 	SocketState UdpSocket::receive_from(Packet& packet, Address& address)
 	{
-		return receive_datagram_packet(packet, receive_from(*datagram_, address));
+		const LatencyTimer timer(LatencyMetric::receive_call);
+
+		return receive_datagram_packet(packet, receive_from(*datagram_, address), address);
+	}
+
+	SocketState UdpSocket::receive_from(Packet& packet, Address& address, uint64_t& timestamp)
+	{
+		const LatencyTimer timer(LatencyMetric::receive_call);
+
+		return receive_datagram_packet(packet, receive_from(*datagram_, address, timestamp), address);
+	}
+
+	bool UdpSocket::checksum() const
+	{
+		return checksum_;
+	}
+
+	void UdpSocket::checksum(bool value)
+	{
+		checksum_ = value;
+	}
+
+	bool UdpSocket::receive_timestamps() const
+	{
+		return receive_timestamps_;
+	}
+
+	SocketState UdpSocket::receive_timestamps(bool value)
+	{
+		enforce(is_open(), "Socket must be bound or connected before enabling timestamps.");
+
+		TIMESTAMPING_CONFIG config {};
+		config.Flags = value ? TIMESTAMPING_FLAG_RX : 0;
+
+		DWORD bytes = 0;
+
+		if (WSAIoctl(socket_, SIO_TIMESTAMPING, &config, sizeof(config), nullptr, 0, &bytes, nullptr, nullptr) == SOCKET_ERROR)
+		{
+			return get_error_state();
+		}
+
+		receive_timestamps_ = value;
+		return clear_error_state();
+	}
+
+	SocketState UdpSocket::join_group(const Address& group, uint32_t interface_index)
+	{
+		return membership(group, interface_index, true);
+	}
+
+	SocketState UdpSocket::leave_group(const Address& group, uint32_t interface_index)
+	{
+		return membership(group, interface_index, false);
+	}
+
+	int UdpSocket::multicast_hops() const
+	{
+		return multicast_hops_;
+	}
+
+	SocketState UdpSocket::multicast_hops(int value)
+	{
+		enforce(is_open(), "Socket must be bound or connected before setting multicast options.");
+
+		const DWORD option = static_cast<DWORD>(value);
+		const bool inet6 = native_family() == AF_INET6;
+
+		if (setsockopt(socket_, inet6 ? IPPROTO_IPV6 : IPPROTO_IP, inet6 ? IPV6_MULTICAST_HOPS : IP_MULTICAST_TTL,
+		               reinterpret_cast<const char*>(&option), sizeof(option)) == SOCKET_ERROR)
+		{
+			return get_error_state();
+		}
+
+		multicast_hops_ = value;
+		return clear_error_state();
+	}
+
+	bool UdpSocket::multicast_loopback() const
+	{
+		return multicast_loopback_;
+	}
+
+	SocketState UdpSocket::multicast_loopback(bool value)
+	{
+		enforce(is_open(), "Socket must be bound or connected before setting multicast options.");
+
+		const DWORD option = value ? 1 : 0;
+		const bool inet6 = native_family() == AF_INET6;
+
+		if (setsockopt(socket_, inet6 ? IPPROTO_IPV6 : IPPROTO_IP, inet6 ? IPV6_MULTICAST_LOOP : IP_MULTICAST_LOOP,
+		               reinterpret_cast<const char*>(&option), sizeof(option)) == SOCKET_ERROR)
+		{
+			return get_error_state();
+		}
+
+		multicast_loopback_ = value;
+		return clear_error_state();
+	}
+
+	uint32_t UdpSocket::multicast_interface() const
+	{
+		return multicast_interface_;
+	}
+
+	SocketState UdpSocket::multicast_interface(uint32_t interface_index)
+	{
+		enforce(is_open(), "Socket must be bound or connected before setting multicast options.");
+
+		int result;
+
+		if (native_family() == AF_INET6)
+		{
+			const DWORD option = interface_index;
+			result = setsockopt(socket_, IPPROTO_IPV6, IPV6_MULTICAST_IF, reinterpret_cast<const char*>(&option), sizeof(option));
+		}
+		else
+		{
+			// IPv4 takes an interface address, or an index in network byte order in the form 0.0.0.x
+			const DWORD option = htonl(interface_index);
+			result = setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char*>(&option), sizeof(option));
+		}
+
+		if (result == SOCKET_ERROR)
+		{
+			return get_error_state();
+		}
+
+		multicast_interface_ = interface_index;
+		return clear_error_state();
+	}
+
+	int UdpSocket::native_family() const
+	{
+		sockaddr_storage native {};
+		socklen_t length = sizeof(native);
+
+		if (getsockname(socket_, reinterpret_cast<sockaddr*>(&native), &length) == SOCKET_ERROR)
+		{
+			return AF_INET;
+		}
+
+		return native.ss_family;
+	}
+
+	SocketState UdpSocket::membership(const Address& group, uint32_t interface_index, bool join)
+	{
+		enforce(is_open(), "Socket must be bound before joining or leaving a multicast group.");
+
+		const sockaddr_storage native = group.to_native();
+		enforce(native.ss_family == native_family(), "Multicast group must be of the same address family as the socket.");
+
+		int result;
+
+		if (native.ss_family == AF_INET6)
+		{
+			ipv6_mreq request {};
+			request.ipv6mr_multiaddr = reinterpret_cast<const sockaddr_in6*>(&native)->sin6_addr;
+			request.ipv6mr_interface = interface_index;
+
+			result = setsockopt(socket_, IPPROTO_IPV6, join ? IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP,
+			                    reinterpret_cast<const char*>(&request), sizeof(request));
+		}
+		else
+		{
+			ip_mreq request {};
+			request.imr_multiaddr = reinterpret_cast<const sockaddr_in*>(&native)->sin_addr;
+			request.imr_interface.s_addr = htonl(interface_index);
+
+			result = setsockopt(socket_, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+			                    reinterpret_cast<const char*>(&request), sizeof(request));
+		}
+
+		if (result == SOCKET_ERROR)
+		{
+			return get_error_state();
+		}
+
+		return clear_error_state();
 	}
 }
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace sws
+{
+	/**
+	 * \brief Process-wide set of per-thread instances of \p T
+	 *
+	 * Each thread only ever writes its own shard, so shards can be updated with
+	 * plain relaxed loads and stores. Readers visit every shard under a lock and
+	 * merge them.
+	 *
+	 * When a thread exits, its shard is merged into a shared retired shard and
+	 * then freed, so that merged totals never go backwards and threads which come
+	 * and go don't leak.
+	 *
+	 * \tparam T Shard type with a \c merge(const T&) member. Should be aligned to a cache line.
+	 */
+	template <typename T>
+	class ThreadShards
+	{
+		std::mutex                      mutex_;
+		std::vector<std::unique_ptr<T>> shards_;
+		std::unique_ptr<T>              retired_ = std::make_unique<T>();
+
+		// Retires the shard of the thread it belongs to when that thread exits.
+		struct Retirer
+		{
+			T*& shard;
+
+			~Retirer()
+			{
+				instance().retire(std::exchange(shard, nullptr));
+			}
+		};
+
+	public:
+		/**
+		 * \brief Gets the calling thread's shard, creating it on first use.
+		 */
+		static T& local()
+		{
+			// A plain pointer, so that it can still be read while the thread's destructors run.
+			thread_local T* shard = nullptr;
+
+			if (!shard)
+			{
+				shard = attach(shard);
+			}
+
+			return *shard;
+		}
+
+		/**
+		 * \brief Invokes \p function with every shard, including the one retired threads were merged into.
+		 */
+		template <typename Function>
+		static void for_each(Function&& function)
+		{
+			auto& self = instance();
+			std::lock_guard lock(self.mutex_);
+
+			function(std::as_const(*self.retired_));
+
+			for (const auto& shard : self.shards_)
+			{
+				function(std::as_const(*shard));
+			}
+		}
+
+	private:
+		static ThreadShards& instance()
+		{
+			// Intentionally leaked; threads may still record during static destruction.
+			static auto* shards = new ThreadShards();
+			return *shards;
+		}
+
+		static T* attach(T*& slot)
+		{
+			// Constructed once per thread; a shard created after it has run,
+			// by another thread-local's destructor, is kept rather than retired.
+			thread_local Retirer retirer { slot };
+
+			return instance().add();
+		}
+
+		T* add()
+		{
+			std::lock_guard lock(mutex_);
+			return shards_.emplace_back(std::make_unique<T>()).get();
+		}
+
+		void retire(T* shard)
+		{
+			if (!shard)
+			{
+				return;
+			}
+
+			std::unique_ptr<T> owned;
+
+			{
+				std::lock_guard lock(mutex_);
+
+				const auto it = std::find_if(shards_.begin(), shards_.end(), [&](const auto& entry) { return entry.get() == shard; });
+
+				if (it == shards_.end())
+				{
+					return;
+				}
+
+				// Merged under the lock so that readers see the counts either here or there, never both or neither.
+				retired_->merge(*shard);
+
+				owned = std::move(*it);
+				*it   = std::move(shards_.back());
+				shards_.pop_back();
+			}
+		}
+	};
+}